@@ -0,0 +1,85 @@
+// Frustum culling throughput of every SphereCuller kernel, single threaded and on the shared pool.
+// Usage: cullingbenchmark [spheres count] [iterations]
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "sphereculler.h"
+#include "threadpool.h"
+
+namespace
+{
+	double measureMilliseconds(SphereCuller& culler, const Frustum& frustum, std::vector<unsigned int>& visible,
+		ThreadPool* threadPool, int iterations)
+	{
+		// Warm up caches and the task result lists
+		culler.Cull(frustum, visible, threadPool);
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+			culler.Cull(frustum, visible, threadPool);
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t spheresCount = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	const int iterations = argc > 2 ? std::stoi(argv[2]) : 50;
+
+	std::cout << "Culling " << spheresCount << " spheres, " << iterations << " iterations\n";
+	std::cout << "  Worker threads: " << ThreadPool::Shared().GetWorkersCount() << '\n';
+
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> positionRange(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> radiusRange(0.5f, 10.0f);
+
+	SphereCuller culler;
+	culler.Resize(spheresCount);
+	for (size_t i = 0; i < spheresCount; i++)
+		culler.Set(i, { glm::vec3(positionRange(gen), positionRange(gen), positionRange(gen)), radiusRange(gen) });
+
+	Camera camera(75, 16.0f / 9.0f);
+	camera.SetRotation(glm::vec2(-136.0f, 21.0f));
+	const Frustum frustum = Frustum::FromMatrix(camera.GetProjectionMatrix() * camera.GetMatrix());
+
+	std::vector<unsigned int> reference;
+	culler.SetKernel(SphereCuller::Kernel::Scalar);
+	culler.Cull(frustum, reference);
+	std::cout << "  Visible: " << reference.size() << '\n';
+
+	std::vector<unsigned int> visible;
+	bool allMatch = true;
+	for (const SphereCuller::Kernel kernel : { SphereCuller::Kernel::Scalar, SphereCuller::Kernel::Sse, SphereCuller::Kernel::Avx2 })
+	{
+		const char* name = SphereCuller::GetKernelName(kernel);
+		if (!SphereCuller::IsKernelSupported(kernel))
+		{
+			std::cout << "  " << name << ": not supported\n";
+			continue;
+		}
+
+		culler.SetKernel(kernel);
+		for (ThreadPool* threadPool : { static_cast<ThreadPool*>(nullptr), &ThreadPool::Shared() })
+		{
+			const double milliseconds = measureMilliseconds(culler, frustum, visible, threadPool, iterations);
+			const bool matches = visible == reference;
+			allMatch &= matches;
+
+			std::cout << "  " << name << (threadPool ? " threaded" : " single") << ": "
+				<< milliseconds << "ms, "
+				<< static_cast<double>(spheresCount) / milliseconds / 1000.0 << "M spheres/s"
+				<< (matches ? "" : " MISMATCH") << '\n';
+		}
+	}
+
+	return allMatch ? 0 : 1;
+}
@@ -0,0 +1,421 @@
+// CPU cost of the hot paths that do not need a GPU: model loading, uniform caching, light uploads and
+// matrix math. The GL functions are replaced by stubs, so no context is created and only the CPU side
+// is measured. Runs from a directory containing resources, like the application.
+// Usage: microbenchmarks [benchmark name filter] [minimum seconds per benchmark] [output json]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "entity.h"
+#include "material.h"
+#include "objparser.h"
+#include "shaderprogram.h"
+
+namespace
+{
+	const void* volatile s_sink = nullptr;
+
+	// Keeps the compiler from dropping a result that is never read
+	template <typename T>
+	void doNotOptimize(const T& value)
+	{
+		s_sink = &value;
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+	}
+
+	// Loop state of a single run, in the spirit of benchmark::State
+	class State
+	{
+	public:
+		explicit State(long long iterations) : m_remaining(iterations) {}
+
+		bool KeepRunning() { return m_remaining-- > 0; }
+
+	private:
+		long long m_remaining;
+	};
+
+	struct Benchmark
+	{
+		std::string name;
+		std::function<void(State&)> function;
+	};
+
+	struct BenchmarkResult
+	{
+		std::string name;
+		long long iterations;
+		double nanoseconds;
+	};
+
+	std::vector<Benchmark>& getBenchmarks()
+	{
+		static std::vector<Benchmark> s_benchmarks;
+		return s_benchmarks;
+	}
+
+	void registerBenchmark(std::string name, std::function<void(State&)> function)
+	{
+		getBenchmarks().push_back({ std::move(name), std::move(function) });
+	}
+
+	double runSeconds(const Benchmark& benchmark, long long iterations)
+	{
+		State state(iterations);
+		const auto start = std::chrono::high_resolution_clock::now();
+		benchmark.function(state);
+		const auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double>(end - start).count();
+	}
+
+	// Grows the iteration count until a run takes at least minSeconds, the last run is reported
+	BenchmarkResult runBenchmark(const Benchmark& benchmark, double minSeconds)
+	{
+		long long iterations = 1;
+		double seconds = runSeconds(benchmark, iterations);
+		while (seconds < minSeconds && iterations < 1000000000)
+		{
+			// Aim a bit past the target from the current rate, but never grow more than 10x at once
+			const double estimate = seconds > 0.0 ? minSeconds * 1.4 / seconds : 10.0;
+			iterations = std::max(iterations + 1, static_cast<long long>(static_cast<double>(iterations) * std::min(estimate, 10.0)));
+			seconds = runSeconds(benchmark, iterations);
+		}
+
+		const double nanoseconds = seconds * 1e9 / static_cast<double>(iterations);
+		std::cout << std::left << std::setw(48) << benchmark.name << std::right
+			<< std::setw(16) << std::fixed << std::setprecision(1) << nanoseconds << " ns"
+			<< std::setw(14) << iterations << '\n';
+
+		return { benchmark.name, iterations, nanoseconds };
+	}
+
+	bool writeResults(const std::string& path, const std::vector<BenchmarkResult>& results)
+	{
+		std::ofstream stream(path);
+		if (!stream.is_open())
+		{
+			std::cout << "Could not open file " << path << '\n';
+			return false;
+		}
+
+		stream << "{\n  \"benchmarks\": [";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const BenchmarkResult& result = results[i];
+			stream << (i == 0 ? "\n" : ",\n");
+			stream << "    { \"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+				<< ", \"nanoseconds\": " << result.nanoseconds << " }";
+		}
+		stream << "\n  ]\n}\n";
+		return stream.good();
+	}
+
+	// Stands in for std::cout while loading, which reports progress for every model
+	class NullBuffer : public std::streambuf
+	{
+	protected:
+		int overflow(int c) override { return c; }
+	};
+
+	// GL function table that accepts every call the measured code makes and does nothing
+	template <typename Proc>
+	struct StubCall;
+
+	template <typename Result, typename... Args>
+	struct StubCall<Result (APIENTRYP)(Args...)>
+	{
+		static Result APIENTRY Call(Args...) { return Result(); }
+	};
+
+	unsigned int s_nextObjectId = 1;
+	int s_nextUniformLocation = 0;
+
+	GLuint APIENTRY stubCreateShader(GLenum) { return s_nextObjectId++; }
+	GLuint APIENTRY stubCreateProgram() { return s_nextObjectId++; }
+
+	void APIENTRY stubGenObjects(GLsizei count, GLuint* ids)
+	{
+		for (GLsizei i = 0; i < count; i++)
+			ids[i] = s_nextObjectId++;
+	}
+
+	void APIENTRY stubGetShaderiv(GLuint, GLenum, GLint* params) { *params = GL_TRUE; }
+	GLint APIENTRY stubGetUniformLocation(GLuint, const GLchar*) { return s_nextUniformLocation++; }
+
+#define STUB_GL_CALL(name) glad_##name = &StubCall<decltype(glad_##name)>::Call
+
+	void installGlStubs()
+	{
+		glad_glCreateShader = &stubCreateShader;
+		glad_glCreateProgram = &stubCreateProgram;
+		glad_glGenBuffers = &stubGenObjects;
+		glad_glGenVertexArrays = &stubGenObjects;
+		glad_glGenTextures = &stubGenObjects;
+		glad_glGetShaderiv = &stubGetShaderiv;
+		glad_glGetUniformLocation = &stubGetUniformLocation;
+
+		STUB_GL_CALL(glShaderSource);
+		STUB_GL_CALL(glCompileShader);
+		STUB_GL_CALL(glGetShaderInfoLog);
+		STUB_GL_CALL(glAttachShader);
+		STUB_GL_CALL(glLinkProgram);
+		STUB_GL_CALL(glDeleteShader);
+		STUB_GL_CALL(glDeleteProgram);
+		STUB_GL_CALL(glUseProgram);
+
+		STUB_GL_CALL(glUniform1i);
+		STUB_GL_CALL(glUniform1ui);
+		STUB_GL_CALL(glUniform1f);
+		STUB_GL_CALL(glUniform2fv);
+		STUB_GL_CALL(glUniform3fv);
+		STUB_GL_CALL(glUniform4fv);
+		STUB_GL_CALL(glUniformMatrix3fv);
+		STUB_GL_CALL(glUniformMatrix4fv);
+
+		STUB_GL_CALL(glBindBuffer);
+		STUB_GL_CALL(glBindVertexArray);
+		STUB_GL_CALL(glBufferData);
+		STUB_GL_CALL(glEnableVertexAttribArray);
+		STUB_GL_CALL(glVertexAttribPointer);
+		STUB_GL_CALL(glDeleteBuffers);
+		STUB_GL_CALL(glDeleteVertexArrays);
+
+		STUB_GL_CALL(glActiveTexture);
+		STUB_GL_CALL(glBindTexture);
+	}
+
+	ShaderProgram compileStubShader()
+	{
+		std::streambuf* coutBuffer = std::cout.rdbuf();
+		NullBuffer nullBuffer;
+		std::cout.rdbuf(&nullBuffer);
+		ShaderProgram shader = ShaderProgram::Compile("", "");
+		std::cout.rdbuf(coutBuffer);
+		return shader;
+	}
+
+	void registerObjParser()
+	{
+		std::vector<std::filesystem::path> models;
+		if (std::filesystem::is_directory("resources/models"))
+		{
+			for (const auto& entry : std::filesystem::directory_iterator("resources/models"))
+			{
+				if (entry.path().extension() == ".obj")
+					models.push_back(entry.path());
+			}
+		}
+		std::sort(models.begin(), models.end());
+
+		if (models.empty())
+			std::cout << "No models found in resources/models, skipping LoadFromFile\n";
+
+		for (const std::filesystem::path& path : models)
+		{
+			registerBenchmark("ObjParser::LoadFromFile/" + path.filename().string(), [path](State& state)
+				{
+					std::streambuf* coutBuffer = std::cout.rdbuf();
+					NullBuffer nullBuffer;
+					std::cout.rdbuf(&nullBuffer);
+					while (state.KeepRunning())
+					{
+						Model model = ObjParser::LoadFromFile(path.string());
+						doNotOptimize(model);
+					}
+					std::cout.rdbuf(coutBuffer);
+				});
+		}
+
+		// Typical vertex, face and face corner lines
+		const std::pair<const char*, std::pair<std::string, char>> lines[] = {
+			{ "vertex", { "v 0.437500 0.164062 0.765625", ' ' } },
+			{ "face", { "f 47/1/1 1/2/1 3/3/1 45/4/1", ' ' } },
+			{ "faceCorner", { "47/12/1", '/' } }
+		};
+		for (const auto& [name, line] : lines)
+		{
+			registerBenchmark(std::string("ObjParser::TokenizeString/") + name, [line](State& state)
+				{
+					while (state.KeepRunning())
+						doNotOptimize(ObjParser::TokenizeString(line.first, line.second));
+				});
+		}
+	}
+
+	void registerShaderProgram()
+	{
+		// Same value every time, the common case of a uniform that did not change since the last draw
+		registerBenchmark("ShaderProgram::SetFloat/cached", [](State& state)
+			{
+				ShaderProgram shader = compileStubShader();
+				const std::string name = "material.shininess";
+				while (state.KeepRunning())
+					shader.SetFloat(name, 32.0f);
+			});
+
+		registerBenchmark("ShaderProgram::SetVector3/cached", [](State& state)
+			{
+				ShaderProgram shader = compileStubShader();
+				const std::string name = "pointLights[3].position";
+				while (state.KeepRunning())
+					shader.SetVector3(name, glm::vec3(1.0f, 2.0f, 3.0f));
+			});
+
+		registerBenchmark("ShaderProgram::SetVector3/changed", [](State& state)
+			{
+				ShaderProgram shader = compileStubShader();
+				const std::string name = "pointLights[3].position";
+				float x = 0.0f;
+				while (state.KeepRunning())
+					shader.SetVector3(name, glm::vec3(x += 1.0f, 2.0f, 3.0f));
+			});
+
+		registerBenchmark("ShaderProgram::SetMat4/cached", [](State& state)
+			{
+				ShaderProgram shader = compileStubShader();
+				const std::string name = "model";
+				const glm::mat4 value(2.0f);
+				while (state.KeepRunning())
+					shader.SetMat4(name, value);
+			});
+
+		registerBenchmark("ShaderProgram::SetMat4/changed", [](State& state)
+			{
+				ShaderProgram shader = compileStubShader();
+				const std::string name = "model";
+				glm::mat4 value(1.0f);
+				while (state.KeepRunning())
+				{
+					value[3][0] += 1.0f;
+					shader.SetMat4(name, value);
+				}
+			});
+
+		// Name built per call, like Material::ApplySuns does
+		registerBenchmark("ShaderProgram::SetFloat/builtName", [](State& state)
+			{
+				ShaderProgram shader = compileStubShader();
+				while (state.KeepRunning())
+					shader.SetFloat("spotLights[" + std::to_string(7) + "].outerCutoff", 0.9f);
+			});
+	}
+
+	void registerMaterial()
+	{
+		// Material keeps pointers to the shaders, so they live as long as the program
+		static ShaderProgram s_shader = compileStubShader();
+
+		// The point and spot lights are read from LightClusters' buffers, only the suns go through uniforms
+		for (const int lightsCount : { 0, 1, 10 })
+		{
+			const std::string name = "Material::Use/" + std::to_string(lightsCount) + " of each light";
+			registerBenchmark(name, [lightsCount](State& state)
+				{
+					const Material material(&s_shader, nullptr);
+
+					std::vector<Sun> suns(lightsCount);
+					std::vector<PointLight> pointLights(lightsCount);
+					std::vector<SpotLight> spotLights(lightsCount);
+					for (int i = 0; i < lightsCount; i++)
+					{
+						const float offset = static_cast<float>(i);
+						suns[i].direction = glm::normalize(glm::vec3(offset, -1.0f, 0.5f));
+						pointLights[i].position = glm::vec3(offset, 5.0f, 0.0f);
+						spotLights[i].position = glm::vec3(0.0f, 5.0f, offset);
+					}
+
+					while (state.KeepRunning())
+						material.Use(suns, pointLights, spotLights);
+				});
+		}
+	}
+
+	void registerTransforms()
+	{
+		static ShaderProgram s_shader = compileStubShader();
+
+		for (const float scaleIncrease : { 0.0f, 0.05f })
+		{
+			const std::string name = std::string("Entity::ApplyPositionAndRotation") + (scaleIncrease != 0.0f ? "/highlight" : "");
+			registerBenchmark(name, [scaleIncrease](State& state)
+				{
+					// Two entities drawn in turn with the same shader, so every call uploads
+					std::vector<Entity> entities;
+					for (int i = 0; i < 2; i++)
+					{
+						entities.emplace_back(nullptr, Material(&s_shader, nullptr));
+						entities.back().SetPosition(glm::vec3(static_cast<float>(i) * 10.0f, 0.0f, -5.0f));
+						entities.back().SetRotation(glm::vec3(15.0f, 30.0f * static_cast<float>(i), 0.0f));
+						entities.back().SetScale(glm::vec3(1.0f + static_cast<float>(i)));
+						entities.back().SetWorldMatrix(entities.back().GetLocalMatrix());
+					}
+
+					size_t next = 0;
+					while (state.KeepRunning())
+					{
+						entities[next].ApplyPositionAndRotation(s_shader, scaleIncrease);
+						next ^= 1;
+					}
+				});
+		}
+
+		registerBenchmark("Camera::GetMatrix", [](State& state)
+			{
+				Camera camera(75.0f, 16.0f / 9.0f);
+				camera.SetPosition(glm::vec3(100.0f, 20.0f, 120.0f));
+				float yaw = 0.0f;
+				while (state.KeepRunning())
+				{
+					camera.SetRotation(glm::vec2(yaw += 0.1f, 21.0f));
+					doNotOptimize(camera.GetMatrix());
+				}
+			});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const std::string filter = argc > 1 ? argv[1] : "";
+	const double minSeconds = argc > 2 ? std::stod(argv[2]) : 0.5;
+	const std::string outputPath = argc > 3 ? argv[3] : "";
+
+	installGlStubs();
+
+	registerObjParser();
+	registerShaderProgram();
+	registerMaterial();
+	registerTransforms();
+
+	std::cout << std::left << std::setw(48) << "Benchmark" << std::right
+		<< std::setw(19) << "Time" << std::setw(14) << "Iterations" << '\n';
+	std::cout << std::string(81, '-') << '\n';
+
+	std::vector<BenchmarkResult> results;
+	for (const Benchmark& benchmark : getBenchmarks())
+	{
+		if (benchmark.name.find(filter) != std::string::npos)
+			results.push_back(runBenchmark(benchmark, minSeconds));
+	}
+
+	if (!outputPath.empty())
+	{
+		if (!writeResults(outputPath, results))
+			return -1;
+		std::cout << "Results written to " << outputPath << '\n';
+	}
+
+	return 0;
+}
@@ -0,0 +1,676 @@
+// Renders parameterised scenes offscreen along scripted camera paths with a fixed timestep and
+// writes frame times, GL call counts and triangles per scene, and the asset load time, to a JSON
+// file to compare builds.
+// Usage: scenebenchmark [output json] [frames per scene] [scene name filter]
+// Runs from the directory holding shaders/ and resources/, like the app.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "camerapath.h"
+#include "entity.h"
+#include "entitylights.h"
+#include "fileutils.h"
+#include "gbuffer.h"
+#include "glcallcounter.h"
+#include "headlesscontext.h"
+#include "lightclusters.h"
+#include "material.h"
+#include "model.h"
+#include "objparser.h"
+#include "occlusionculler.h"
+#include "profiler.h"
+#include "scatter.h"
+#include "scene.h"
+#include "shaderprogram.h"
+#include "shadowcascades.h"
+#include "texture.h"
+
+#include "sun.h"
+#include "pointlight.h"
+#include "spotlight.h"
+
+namespace
+{
+	constexpr int width = 1280;
+	constexpr int height = 720;
+	constexpr float deltaTime = 1.0f / 60.0f;
+	constexpr int warmupFrames = 10;
+
+	struct Assets
+	{
+		ShaderProgram shader;
+		ShaderProgram highlightShader;
+		ShaderProgram cullInstancesShader;
+		ShaderProgram buildDepthPyramidShader;
+		ShaderProgram lightClustersShader;
+		ShaderProgram deferredLightingShader;
+		ShaderProgram shadowDepthShader;
+
+		Model cube;
+		Model ground;
+		Model grass;
+		Model monkey;
+		Model screen;
+
+		Texture containerColor;
+		Texture containerSpecular;
+		Texture groundColor;
+		Texture groundSpecular;
+		Texture grassColor;
+	};
+
+	struct BenchmarkScene
+	{
+		Scene scene;
+		std::vector<Scatter> scatters;
+		std::vector<Sun> suns;
+		std::vector<PointLight> pointLights;
+		std::vector<SpotLight> spotLights;
+		CameraPath path{ {}, 1.0f };
+	};
+
+	struct SceneDefinition
+	{
+		std::string name;
+		std::function<void(Assets& assets, BenchmarkScene& benchmarkScene)> build;
+		// Draws into the G-buffer and lights it in a screen pass, see GBuffer
+		bool deferred = false;
+		// Forward shading with per entity light lists, see EntityLights
+		bool entityLights = false;
+		// Cascaded shadow maps of the sun, see ShadowCascades
+		bool shadows = false;
+	};
+
+	struct SceneResult
+	{
+		std::string name;
+		FrameTimeSummary cpu;
+		FrameTimeSummary gpu;
+		double drawCalls = 0.0;
+		double dispatches = 0.0;
+		double stateChanges = 0.0;
+		double uniformUploads = 0.0;
+		double triangles = 0.0;
+	};
+
+	// Color, entity id and depth like the app's offscreen framebuffer
+	struct RenderTarget
+	{
+		unsigned int framebuffer = 0;
+		unsigned int colorTexture = 0;
+		unsigned int entityTexture = 0;
+		unsigned int depthStencilTexture = 0;
+
+		RenderTarget()
+		{
+			glGenFramebuffers(1, &framebuffer);
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			const GLenum attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+			glDrawBuffers(2, attachments);
+
+			colorTexture = CreateTexture(GL_RGB8, GL_COLOR_ATTACHMENT0);
+			entityTexture = CreateTexture(GL_R32I, GL_COLOR_ATTACHMENT1);
+			depthStencilTexture = CreateTexture(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL_ATTACHMENT);
+		}
+
+		~RenderTarget()
+		{
+			const unsigned int textures[] = { colorTexture, entityTexture, depthStencilTexture };
+			glDeleteTextures(3, textures);
+			glDeleteFramebuffers(1, &framebuffer);
+		}
+
+		[[nodiscard]] bool IsComplete() const
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		}
+
+	private:
+		static unsigned int CreateTexture(GLenum format, GLenum attachment)
+		{
+			unsigned int texture;
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+			return texture;
+		}
+	};
+
+	Sun defaultSun()
+	{
+		return {
+			.direction = glm::vec3(1.0, -1, 0),
+			.ambient = glm::vec3(0.02f),
+			.diffuse = glm::vec3(0.3f),
+			.specular = glm::vec3(0.5f)
+		};
+	}
+
+	// Weaves around and over a square area, looking across it
+	CameraPath flyover(glm::vec2 min, glm::vec2 max, float groundHeight, float duration)
+	{
+		const glm::vec2 center = (min + max) * 0.5f;
+		const glm::vec2 extent = (max - min) * 0.5f;
+		const float height = groundHeight + glm::max(extent.x, extent.y) * 0.15f + 5.0f;
+
+		std::vector<CameraPath::Key> keys;
+		constexpr int keysCount = 8;
+		for (int i = 0; i < keysCount; i++)
+		{
+			const float angle = static_cast<float>(i) / keysCount * glm::two_pi<float>();
+			const float radius = (i % 2 == 0) ? 1.1f : 0.4f;
+			const glm::vec2 position = center + glm::vec2(glm::cos(angle), glm::sin(angle)) * extent * radius;
+			const glm::vec2 target = center + glm::vec2(glm::cos(angle + 2.0f), glm::sin(angle + 2.0f)) * extent * 0.3f;
+			keys.push_back({ glm::vec3(position.x, height * ((i % 3 == 0) ? 1.5f : 1.0f), position.y), glm::vec3(target.x, groundHeight, target.y) });
+		}
+
+		return CameraPath(std::move(keys), duration);
+	}
+
+	void addGround(Assets& assets, Scene& scene, glm::vec2 min, glm::vec2 max, float groundHeight)
+	{
+		Material groundMaterial(&assets.shader, &assets.highlightShader);
+		groundMaterial.SetShininess(16);
+		groundMaterial.SetDiffuseMap(&assets.groundColor);
+		groundMaterial.SetSpecularMap(&assets.groundSpecular);
+
+		// ground.obj spans 20 units
+		Entity ground(&assets.ground, groundMaterial);
+		const glm::vec2 center = (min + max) * 0.5f;
+		ground.SetPosition(glm::vec3(center.x, groundHeight, center.y));
+		ground.SetScale(glm::vec3((max.x - min.x) / 20.0f, 1.0f, (max.y - min.y) / 20.0f));
+		scene.Add(std::move(ground));
+	}
+
+	// Spinning cubes on a square grid 20 units apart
+	glm::vec2 addCubes(Assets& assets, Scene& scene, size_t count)
+	{
+		Material material(&assets.shader, &assets.highlightShader);
+		material.SetDiffuseMap(&assets.containerColor);
+		material.SetSpecularMap(&assets.containerSpecular);
+
+		const size_t side = static_cast<size_t>(glm::ceil(glm::sqrt(static_cast<float>(count))));
+		Entity prototype(&assets.cube, material);
+		prototype.SetScale(glm::vec3(5));
+		scene.SpawnMany(prototype, count,
+			[side](Entity& e, size_t index) {
+				const int i = static_cast<int>(index / side);
+				const int j = static_cast<int>(index % side);
+				float value = static_cast<float>(i + j) / 2.0f;
+
+				e.SetPosition(glm::vec3(i * 20, 0, j * 20));
+				e.SetUpdateFunc(
+					[value](Entity* e, float deltaTime) mutable {
+						e->SetRotation(glm::vec3(value * 6.0, value * 8.0f, value * 10.0f));
+						value += 2.0f * deltaTime;
+					});
+			});
+
+		return glm::vec2(static_cast<float>(side) * 20.0f);
+	}
+
+	SceneDefinition cubesScene(size_t count)
+	{
+		return { "cubes_" + std::to_string(count), [count](Assets& assets, BenchmarkScene& s) {
+			const glm::vec2 size = addCubes(assets, s.scene, count);
+			addGround(assets, s.scene, glm::vec2(-20.0f), size, -15.0f);
+			s.suns = { defaultSun() };
+			s.path = flyover(glm::vec2(-20.0f), size, -15.0f, 20.0f);
+		} };
+	}
+
+	SceneDefinition grassScene(unsigned int count)
+	{
+		return { "grass_" + std::to_string(count), [count](Assets& assets, BenchmarkScene& s) {
+			const glm::vec2 min(-75.0f);
+			const glm::vec2 max(275.0f);
+			addGround(assets, s.scene, min, max, -15.0f);
+
+			Material grassMaterial(&assets.shader, &assets.highlightShader);
+			grassMaterial.SetDiffuseMap(&assets.grassColor);
+			grassMaterial.SetShininess(8);
+			grassMaterial.SetBillboard(true);
+
+			Scatter& grass = s.scatters.emplace_back(&assets.grass, grassMaterial);
+			grass.SetLayers({ glm::vec3(0, 135, 0), glm::vec3(0, 45, 0) });
+			grass.SetFadeDistance(120.0f, 160.0f);
+			grass.SetCullingShader(&assets.cullInstancesShader);
+			grass.Generate(min, max, -15.0f, count, [](glm::vec2) { return 1.0f; }, glm::vec2(4.0f, 7.0f), 1);
+
+			s.suns = { defaultSun() };
+			s.path = flyover(min, max, -15.0f, 20.0f);
+		} };
+	}
+
+	SceneDefinition monkeysScene(size_t count)
+	{
+		return { "monkeys_" + std::to_string(count), [count](Assets& assets, BenchmarkScene& s) {
+			Material material(&assets.shader, &assets.highlightShader);
+			material.SetColor(glm::vec3(0.6f, 0.4f, 0.25f));
+			material.SetShininess(32);
+
+			const size_t side = static_cast<size_t>(glm::ceil(glm::sqrt(static_cast<float>(count))));
+			Entity prototype(&assets.monkey, material);
+			prototype.SetScale(glm::vec3(4));
+			s.scene.SpawnMany(prototype, count,
+				[side](Entity& e, size_t index) {
+					e.SetPosition(glm::vec3(static_cast<float>(index / side) * 15.0f, -9.0f, static_cast<float>(index % side) * 15.0f));
+					e.SetRotation(glm::vec3(0.0f, static_cast<float>(index * 37 % 360), 0.0f));
+				});
+
+			const glm::vec2 size(static_cast<float>(side) * 15.0f);
+			addGround(assets, s.scene, glm::vec2(-15.0f), size, -15.0f);
+			s.suns = { defaultSun() };
+			s.path = flyover(glm::vec2(-15.0f), size, -15.0f, 20.0f);
+		} };
+	}
+
+	// The cube grid lit by a row of bright point and spot lights that reach across most of it
+	SceneDefinition lightsScene(size_t cubesCount, int lightsCount)
+	{
+		return { "lights_" + std::to_string(lightsCount), [cubesCount, lightsCount](Assets& assets, BenchmarkScene& s) {
+			const glm::vec2 size = addCubes(assets, s.scene, cubesCount);
+			addGround(assets, s.scene, glm::vec2(-20.0f), size, -15.0f);
+
+			s.suns = { defaultSun() };
+			for (int i = 0; i < lightsCount; i++)
+			{
+				const float x = (static_cast<float>(i) + 0.5f) / static_cast<float>(lightsCount) * size.x;
+				const glm::vec3 color(0.5f + 0.5f * glm::sin(static_cast<float>(i)), 0.5f + 0.5f * glm::cos(static_cast<float>(i)), 1.0f);
+
+				s.pointLights.push_back({
+					.position = glm::vec3(x, -9.5f, size.y * 0.3f),
+					.diffuse = color * 40.0f,
+					.specular = color * 40.0f,
+					.constant = 1.0f,
+					.linear = 0.8f,
+					.quadratic = 0.01f,
+				});
+				s.spotLights.push_back({
+					.position = glm::vec3(x, 25.0f, size.y * 0.7f),
+					.direction = glm::vec3(0.3f, -1.0f, 0.0f),
+					.diffuse = color * 40.0f,
+					.specular = color * 40.0f,
+					.constant = 1.0f,
+					.linear = 0.8f,
+					.quadratic = 0.01f,
+					.innerCutoff = glm::cos(glm::radians(15.0f)),
+					.outerCutoff = glm::cos(glm::radians(25.0f))
+				});
+			}
+
+			s.path = flyover(glm::vec2(-20.0f), size, -15.0f, 20.0f);
+		} };
+	}
+
+	// The cube grid lit by a grid of dim point lights, each only reaching the cubes around it
+	SceneDefinition manyLightsScene(size_t cubesCount, int lightsCount)
+	{
+		return { "many_lights_" + std::to_string(lightsCount), [cubesCount, lightsCount](Assets& assets, BenchmarkScene& s) {
+			const glm::vec2 size = addCubes(assets, s.scene, cubesCount);
+			addGround(assets, s.scene, glm::vec2(-20.0f), size, -15.0f);
+
+			s.suns = { defaultSun() };
+			const int side = static_cast<int>(glm::ceil(glm::sqrt(static_cast<float>(lightsCount))));
+			for (int i = 0; i < lightsCount; i++)
+			{
+				const glm::vec2 position = (glm::vec2(i / side, i % side) + 0.5f) / static_cast<float>(side) * (size + 20.0f) - 20.0f;
+				const glm::vec3 color(0.5f + 0.5f * glm::sin(static_cast<float>(i)), 0.5f + 0.5f * glm::cos(static_cast<float>(i)), 1.0f);
+
+				s.pointLights.push_back({
+					.position = glm::vec3(position.x, -12.0f, position.y),
+					.diffuse = color * 4.0f,
+					.specular = color * 4.0f,
+					.constant = 1.0f,
+					.linear = 0.7f,
+					.quadratic = 1.8f,
+				});
+			}
+
+			s.path = flyover(glm::vec2(-20.0f), size, -15.0f, 20.0f);
+		} };
+	}
+
+	SceneDefinition deferred(SceneDefinition definition)
+	{
+		definition.name += "_deferred";
+		definition.deferred = true;
+		return definition;
+	}
+
+	SceneDefinition entityLightLists(SceneDefinition definition)
+	{
+		definition.name += "_entity_lights";
+		definition.entityLights = true;
+		return definition;
+	}
+
+	SceneDefinition shadowed(SceneDefinition definition)
+	{
+		definition.name += "_shadows";
+		definition.shadows = true;
+		return definition;
+	}
+
+	SceneResult runScene(const SceneDefinition& definition, Assets& assets, const RenderTarget& target, int frames)
+	{
+		BenchmarkScene benchmarkScene;
+		definition.build(assets, benchmarkScene);
+		Scene& scene = benchmarkScene.scene;
+		scene.SetOcclusionCulling(true);
+
+		Camera camera(75, static_cast<float>(width) / height);
+		OcclusionCuller occlusionCuller(&assets.buildDepthPyramidShader, &assets.cullInstancesShader);
+		LightClusters lightClusters(&assets.lightClustersShader);
+		EntityLights entityLights;
+		entityLights.SetEnabled(definition.entityLights);
+		scene.SetEntityLights(&entityLights);
+		GBuffer gBuffer(&assets.deferredLightingShader);
+		ShadowCascades shadowCascades(&assets.shadowDepthShader);
+		shadowCascades.SetEnabled(definition.shadows);
+		std::vector<const Scatter*> scatters;
+		for (const Scatter& scatter : benchmarkScene.scatters)
+			scatters.push_back(&scatter);
+		if (definition.deferred)
+			gBuffer.Resize(width, height, target.colorTexture, target.entityTexture, target.depthStencilTexture);
+		Profiler profiler;
+		std::vector<EntityHandle> occludedEntities;
+
+		unsigned int primitivesQuery;
+		glGenQueries(1, &primitivesQuery);
+
+		std::vector<float> cpuFrameTimes;
+		std::vector<float> gpuFrameTimes;
+		GlCallCounts totals;
+		unsigned long long triangles = 0;
+
+		for (int frame = 0; frame < warmupFrames + frames; frame++)
+		{
+			GlCallCounter::Reset();
+			profiler.BeginFrame();
+
+			glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+			glEnable(GL_DEPTH_TEST);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+			int noEntity = -1;
+			glClearBufferiv(GL_COLOR, 1, &noEntity);
+
+			{
+				ProfileScope scope(profiler, "Update", false);
+				benchmarkScene.path.Apply(camera, static_cast<float>(frame) * deltaTime);
+				scene.Update(deltaTime);
+
+				if (occlusionCuller.FetchOccluded(occludedEntities))
+					scene.SetOccludedEntities(occludedEntities);
+			}
+
+			{
+				ProfileScope scope(profiler, "Light clusters");
+				lightClusters.Update(camera, width, height, benchmarkScene.pointLights, benchmarkScene.spotLights);
+				lightClusters.Apply(assets.shader);
+			}
+
+			{
+				ProfileScope scope(profiler, "Entity lights", false);
+				entityLights.Update(scene, benchmarkScene.pointLights, benchmarkScene.spotLights, lightClusters.GetIntensityCutoff());
+			}
+
+			{
+				ProfileScope scope(profiler, "Shadows");
+				shadowCascades.Render(camera, benchmarkScene.suns, scene, scatters);
+				shadowCascades.Apply(assets.shader);
+				shadowCascades.Apply(assets.deferredLightingShader);
+				glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+				glViewport(0, 0, width, height);
+			}
+
+			if (definition.deferred)
+				gBuffer.BeginGeometryPass();
+			GBuffer::SetGeometryPass(assets.shader, definition.deferred);
+
+			glBeginQuery(GL_PRIMITIVES_GENERATED, primitivesQuery);
+			{
+				ProfileScope scope(profiler, "Scene draw");
+				scene.Draw(camera, benchmarkScene.suns, benchmarkScene.pointLights, benchmarkScene.spotLights);
+			}
+			{
+				ProfileScope scope(profiler, "Scatter draw");
+				for (Scatter& scatter : benchmarkScene.scatters)
+				{
+					scatter.SetOcclusionCuller(&occlusionCuller);
+					scatter.Draw(camera, benchmarkScene.suns, benchmarkScene.pointLights, benchmarkScene.spotLights);
+				}
+			}
+			glEndQuery(GL_PRIMITIVES_GENERATED);
+
+			if (definition.deferred)
+			{
+				ProfileScope scope(profiler, "Deferred lighting");
+				gBuffer.Light(camera, lightClusters, benchmarkScene.suns, benchmarkScene.pointLights.size(), benchmarkScene.spotLights.size(), assets.screen);
+				glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+			}
+
+			{
+				ProfileScope scope(profiler, "Occlusion");
+				occlusionCuller.BuildPyramid(target.depthStencilTexture, width, height, camera.GetProjectionMatrix() * camera.GetMatrix());
+				occlusionCuller.Test(scene.GetOcclusionCandidates(), scene.GetOcclusionCandidateSpheres());
+			}
+
+			{
+				ProfileScope scope(profiler, "Finish", false);
+				glFinish();
+			}
+			profiler.EndFrame();
+
+			if (frame < warmupFrames)
+				continue;
+
+			GLuint64 primitives = 0;
+			glGetQueryObjectui64v(primitivesQuery, GL_QUERY_RESULT, &primitives);
+			triangles += primitives;
+
+			const GlCallCounts& counts = GlCallCounter::Get();
+			totals.drawCalls += counts.drawCalls;
+			totals.dispatches += counts.dispatches;
+			totals.stateChanges += counts.stateChanges;
+			totals.uniformUploads += counts.uniformUploads;
+
+			cpuFrameTimes.push_back(profiler.GetCpuFrameTime());
+			gpuFrameTimes.push_back(profiler.GetGpuFrameTime());
+		}
+
+		glDeleteQueries(1, &primitivesQuery);
+
+		const double measured = static_cast<double>(frames);
+		return {
+			.name = definition.name,
+			.cpu = SummarizeFrameTimes(cpuFrameTimes),
+			.gpu = SummarizeFrameTimes(gpuFrameTimes),
+			.drawCalls = static_cast<double>(totals.drawCalls) / measured,
+			.dispatches = static_cast<double>(totals.dispatches) / measured,
+			.stateChanges = static_cast<double>(totals.stateChanges) / measured,
+			.uniformUploads = static_cast<double>(totals.uniformUploads) / measured,
+			.triangles = static_cast<double>(triangles) / measured,
+		};
+	}
+
+	void writeSummary(std::ostream& stream, const FrameTimeSummary& summary)
+	{
+		stream << "{ \"mean\": " << summary.mean << ", \"min\": " << summary.min << ", \"p50\": " << summary.p50
+			<< ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << " }";
+	}
+
+	void writeString(std::ostream& stream, std::string_view text)
+	{
+		constexpr char hexDigits[] = "0123456789abcdef";
+
+		stream << '"';
+		for (const char character : text)
+		{
+			const auto code = static_cast<unsigned char>(character);
+			if (character == '"' || character == '\\')
+				stream << '\\' << character;
+			else if (code < 0x20)
+				stream << "\\u00" << hexDigits[code >> 4] << hexDigits[code & 0xf];
+			else
+				stream << character;
+		}
+		stream << '"';
+	}
+
+	bool writeResults(const std::string& path, const std::vector<SceneResult>& results, int frames, double loadSeconds)
+	{
+		std::ofstream stream(path);
+		if (!stream.is_open())
+		{
+			std::cout << "Could not open file " << path << '\n';
+			return false;
+		}
+
+		stream << "{\n";
+		stream << "  \"renderer\": ";
+		writeString(stream, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+		stream << ",\n";
+		stream << "  \"width\": " << width << ",\n  \"height\": " << height << ",\n";
+		stream << "  \"frames\": " << frames << ",\n  \"warmupFrames\": " << warmupFrames << ",\n";
+		stream << "  \"deltaTime\": " << deltaTime << ",\n";
+		stream << "  \"loadSeconds\": " << loadSeconds << ",\n";
+		stream << "  \"scenes\": [";
+
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const SceneResult& result = results[i];
+			stream << (i == 0 ? "\n" : ",\n");
+			stream << "    {\n      \"name\": ";
+			writeString(stream, result.name);
+			stream << ",\n";
+			stream << "      \"cpuFrameMs\": ";
+			writeSummary(stream, result.cpu);
+			stream << ",\n      \"gpuFrameMs\": ";
+			writeSummary(stream, result.gpu);
+			stream << ",\n      \"drawCalls\": " << result.drawCalls;
+			stream << ",\n      \"dispatches\": " << result.dispatches;
+			stream << ",\n      \"stateChanges\": " << result.stateChanges;
+			stream << ",\n      \"uniformUploads\": " << result.uniformUploads;
+			stream << ",\n      \"triangles\": " << result.triangles << "\n    }";
+		}
+
+		stream << "\n  ]\n}\n";
+		return stream.good();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const std::string outputPath = argc > 1 ? argv[1] : "scenebenchmark.json";
+	const int frames = argc > 2 ? std::max(std::stoi(argv[2]), 1) : 300;
+	const std::string filter = argc > 3 ? argv[3] : "";
+
+	HeadlessContext context = HeadlessContext::Create();
+	if (!context.IsValid())
+		return -1;
+
+	GlCallCounter::Install();
+	std::cout << "Renderer: " << glGetString(GL_RENDERER) << '\n';
+
+	std::vector<SceneResult> results;
+	double loadSeconds = 0.0;
+	{
+		const auto loadStart = std::chrono::steady_clock::now();
+		const std::string vertexShader = readFileAsString("shaders/vertexShader.glsl");
+		Assets assets{
+			.shader = ShaderProgram::Compile(vertexShader, readShaderSource("shaders/fragmentShader.glsl")),
+			.highlightShader = ShaderProgram::Compile(vertexShader, readFileAsString("shaders/highlightShader.glsl")),
+			.cullInstancesShader = ShaderProgram::CompileCompute(readFileAsString("shaders/cullInstances.glsl")),
+			.buildDepthPyramidShader = ShaderProgram::CompileCompute(readFileAsString("shaders/buildDepthPyramid.glsl")),
+			.lightClustersShader = ShaderProgram::CompileCompute(readFileAsString("shaders/lightClusters.glsl")),
+			.deferredLightingShader = ShaderProgram::Compile(readFileAsString("shaders/screenVertShader.glsl"), readShaderSource("shaders/deferredLighting.glsl")),
+			.shadowDepthShader = ShaderProgram::Compile(vertexShader, readFileAsString("shaders/shadowDepth.glsl")),
+			.cube = ObjParser::LoadFromFile("resources/models/cube.obj"),
+			.ground = ObjParser::LoadFromFile("resources/models/ground.obj"),
+			.grass = ObjParser::LoadFromFile("resources/models/grass.obj"),
+			.monkey = ObjParser::LoadFromFile("resources/models/monkey_smooth.obj", { .lodsCount = 4, .meshlets = true, .quantize = true }),
+			.screen = ObjParser::LoadFromFile("resources/models/screen.obj"),
+			.containerColor = Texture::LoadFromFile("resources/textures/container_color.png"),
+			.containerSpecular = Texture::LoadFromFile("resources/textures/container_specular.png"),
+			.groundColor = Texture::LoadFromFile("resources/textures/ground_color.jpg"),
+			.groundSpecular = Texture::LoadFromFile("resources/textures/ground_spec.jpg"),
+			.grassColor = Texture::LoadFromFile("resources/textures/grass.png", false),
+		};
+		loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+		std::cout << "Loaded assets in " << loadSeconds << "s\n";
+
+		const std::vector<SceneDefinition> definitions = {
+			cubesScene(1000),
+			cubesScene(10000),
+			grassScene(100000),
+			grassScene(400000),
+			monkeysScene(100),
+			monkeysScene(1000),
+			lightsScene(1000, 10),
+			manyLightsScene(1000, 256),
+			manyLightsScene(1000, 4096),
+			entityLightLists(lightsScene(1000, 10)),
+			entityLightLists(manyLightsScene(1000, 256)),
+			entityLightLists(manyLightsScene(1000, 4096)),
+			deferred(cubesScene(10000)),
+			deferred(lightsScene(1000, 10)),
+			deferred(manyLightsScene(1000, 256)),
+			deferred(manyLightsScene(1000, 4096)),
+			shadowed(cubesScene(10000)),
+			shadowed(grassScene(100000)),
+			shadowed(monkeysScene(1000)),
+		};
+
+		const RenderTarget target;
+		if (!target.IsComplete())
+		{
+			std::cout << "Failed creating the framebuffer!\n";
+			return -2;
+		}
+
+		glClearColor(160 / 7.0f / 255.0f, 217 / 7.0f / 255.0f, 239 / 7.0f / 255.0f, 1.0f);
+		glViewport(0, 0, width, height);
+		glEnable(GL_CULL_FACE);
+		glEnable(GL_STENCIL_TEST);
+		glCullFace(GL_BACK);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+		std::cout << "Running " << frames << " frames per scene at " << width << 'x' << height << '\n';
+		for (const SceneDefinition& definition : definitions)
+		{
+			if (!filter.empty() && definition.name.find(filter) == std::string::npos)
+				continue;
+
+			const SceneResult result = runScene(definition, assets, target, frames);
+			std::cout << "  " << result.name << ": " << result.cpu.mean << " ms mean, " << result.cpu.p50 << " ms p50, "
+				<< result.cpu.p99 << " ms p99, GPU " << result.gpu.mean << " ms, " << result.drawCalls << " draws, "
+				<< result.stateChanges << " state changes, " << result.triangles << " triangles\n";
+			results.push_back(result);
+		}
+	}
+
+	if (!writeResults(outputPath, results, frames, loadSeconds))
+		return -3;
+
+	std::cout << "Results written to " << outputPath << '\n';
+	return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+struct BoundingBox
+{
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+
+	[[nodiscard]] glm::vec3 Center() const { return (min + max) * 0.5f; }
+	[[nodiscard]] glm::vec3 Extents() const { return (max - min) * 0.5f; }
+};
+
+struct BoundingSphere
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+};
+
+// Box around the transformed corners of the box
+inline BoundingBox TransformBoundingBox(const BoundingBox& box, const glm::mat4& transform)
+{
+	const glm::vec3 center = glm::vec3(transform * glm::vec4(box.Center(), 1.0f));
+	const glm::vec3 extents = box.Extents();
+
+	const glm::mat3 absolute(glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2])));
+	const glm::vec3 newExtents = absolute * extents;
+
+	return { center - newExtents, center + newExtents };
+}
+
+// Conservative for non-uniform scale, the radius grows with the largest axis
+inline BoundingSphere TransformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& transform)
+{
+	const float maxScaleSquared = glm::max(
+		glm::max(glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])), glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1]))),
+		glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])));
+
+	return { glm::vec3(transform * glm::vec4(sphere.center, 1.0f)), sphere.radius * glm::sqrt(maxScaleSquared) };
+}
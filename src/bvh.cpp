@@ -0,0 +1,565 @@
+#include <algorithm>
+#include <limits>
+
+#include "bvh.h"
+
+namespace
+{
+	float SurfaceArea(const glm::vec3& min, const glm::vec3& max)
+	{
+		const glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool Overlaps(const glm::vec3& min, const glm::vec3& max, const BoundingBox& box)
+	{
+		return glm::all(glm::lessThanEqual(min, box.max)) && glm::all(glm::lessThanEqual(box.min, max));
+	}
+
+	bool Overlaps(const glm::vec3& min, const glm::vec3& max, const BoundingSphere& sphere)
+	{
+		const glm::vec3 closest = glm::clamp(sphere.center, min, max);
+		const glm::vec3 offset = sphere.center - closest;
+		return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+	}
+
+	// Slab test, entry is clamped to the ray origin
+	bool IntersectsRay(const glm::vec3& min, const glm::vec3& max,
+		const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& entry)
+	{
+		const glm::vec3 t1 = (min - origin) * inverseDirection;
+		const glm::vec3 t2 = (max - origin) * inverseDirection;
+		const glm::vec3 tNear = glm::min(t1, t2);
+		const glm::vec3 tFar = glm::max(t1, t2);
+
+		entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+		return entry <= exit;
+	}
+
+	// Returns false when the box is outside one of the planes in the mask.
+	// Planes the box is fully inside of are removed from the mask.
+	bool ClassifyFrustum(const glm::vec3& min, const glm::vec3& max, const Frustum& frustum, unsigned int& mask)
+	{
+		for (unsigned int i = 0; i < Frustum::PlanesCount; i++)
+		{
+			if (!(mask & (1u << i)))
+				continue;
+
+			const glm::vec4& plane = frustum.planes[i];
+			const glm::vec3 normal(plane);
+			const glm::vec3 positive(plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y, plane.z >= 0.0f ? max.z : min.z);
+			if (glm::dot(normal, positive) + plane.w < 0.0f)
+				return false;
+
+			const glm::vec3 negative(plane.x >= 0.0f ? min.x : max.x, plane.y >= 0.0f ? min.y : max.y, plane.z >= 0.0f ? min.z : max.z);
+			if (glm::dot(normal, negative) + plane.w >= 0.0f)
+				mask &= ~(1u << i);
+		}
+
+		return true;
+	}
+
+	constexpr unsigned int allPlanesMask = (1u << Frustum::PlanesCount) - 1;
+}
+
+void Bvh::Add(unsigned int item, const BoundingBox& bounds)
+{
+	if (item >= m_bounds.size())
+	{
+		m_bounds.resize(item + 1);
+		m_alive.resize(item + 1, 0);
+		m_itemPosition.resize(item + 1, NoPosition);
+	}
+
+	m_bounds[item] = bounds;
+	m_alive[item] = 1;
+	m_structureChanged = true;
+}
+
+void Bvh::Remove(unsigned int item)
+{
+	if (item >= m_alive.size() || !m_alive[item])
+		return;
+
+	m_alive[item] = 0;
+	m_structureChanged = true;
+}
+
+void Bvh::Clear()
+{
+	m_bounds.clear();
+	m_alive.clear();
+	m_itemPosition.clear();
+	m_moved.clear();
+	m_items.clear();
+	m_itemBounds.clear();
+	m_itemLeaf.clear();
+	m_nodes.clear();
+	m_nodeParent.clear();
+	m_nodeDirty.clear();
+	m_cost = 0.0f;
+	m_builtCost = 0.0f;
+	m_structureChanged = false;
+}
+
+void Bvh::SetBounds(unsigned int item, const BoundingBox& bounds)
+{
+	m_bounds[item] = bounds;
+
+	// A pending rebuild reads the new bounds anyway
+	if (!m_structureChanged && m_itemPosition[item] != NoPosition)
+		m_moved.push_back(item);
+}
+
+void Bvh::Update()
+{
+	if (m_structureChanged)
+	{
+		Build();
+		return;
+	}
+
+	if (m_moved.empty())
+		return;
+
+	Refit();
+
+	if (GetCost() > m_builtCost * RebuildCostRatio)
+		Build();
+}
+
+float Bvh::GetCost() const
+{
+	if (m_nodes.empty())
+		return 0.0f;
+
+	const float rootArea = SurfaceArea(m_nodes[0].min, m_nodes[0].max);
+	return rootArea > 0.0f ? m_cost / rootArea : 0.0f;
+}
+
+void Bvh::Build()
+{
+	std::vector<BuildItem> buildItems;
+	for (unsigned int item = 0; item < m_alive.size(); item++)
+	{
+		m_itemPosition[item] = NoPosition;
+		if (m_alive[item])
+			buildItems.push_back({ m_bounds[item], m_bounds[item].Center(), item });
+	}
+
+	m_nodes.clear();
+	m_nodes.reserve(buildItems.size() * 2);
+	if (!buildItems.empty())
+		BuildNode(0, static_cast<unsigned int>(buildItems.size()), 0, buildItems);
+
+	m_items.resize(buildItems.size());
+	m_itemBounds.resize(buildItems.size());
+	m_itemLeaf.resize(buildItems.size());
+	for (unsigned int position = 0; position < buildItems.size(); position++)
+	{
+		m_items[position] = buildItems[position].item;
+		m_itemBounds[position] = buildItems[position].bounds;
+		m_itemPosition[buildItems[position].item] = position;
+	}
+
+	m_nodeParent.assign(m_nodes.size(), NoPosition);
+	m_nodeDirty.assign(m_nodes.size(), 0);
+	m_cost = 0.0f;
+	for (unsigned int i = 0; i < m_nodes.size(); i++)
+	{
+		const Node& node = m_nodes[i];
+		m_cost += NodeCost(node);
+
+		if (node.IsLeaf())
+		{
+			for (unsigned int position = node.offset; position < node.offset + node.count; position++)
+				m_itemLeaf[position] = i;
+		}
+		else
+		{
+			m_nodeParent[i + 1] = i;
+			m_nodeParent[node.offset] = i;
+		}
+	}
+
+	m_builtCost = GetCost();
+	m_rebuildsCount++;
+	m_moved.clear();
+	m_structureChanged = false;
+}
+
+unsigned int Bvh::BuildNode(unsigned int begin, unsigned int end, unsigned int depth, std::vector<BuildItem>& buildItems)
+{
+	const unsigned int nodeIndex = static_cast<unsigned int>(m_nodes.size());
+	const unsigned int count = end - begin;
+
+	glm::vec3 min(std::numeric_limits<float>::max());
+	glm::vec3 max(std::numeric_limits<float>::lowest());
+	glm::vec3 centroidMin = min;
+	glm::vec3 centroidMax = max;
+	for (unsigned int i = begin; i < end; i++)
+	{
+		min = glm::min(min, buildItems[i].bounds.min);
+		max = glm::max(max, buildItems[i].bounds.max);
+		centroidMin = glm::min(centroidMin, buildItems[i].centroid);
+		centroidMax = glm::max(centroidMax, buildItems[i].centroid);
+	}
+
+	m_nodes.push_back({ min, begin, max, count });
+	if (count == 1)
+		return nodeIndex;
+
+	const glm::vec3 centroidExtent = centroidMax - centroidMin;
+	const float nodeArea = SurfaceArea(min, max);
+
+	int bestAxis = -1;
+	unsigned int bestSplit = 0;
+	float bestCost = std::numeric_limits<float>::max();
+
+	if (depth < MaxSahDepth && nodeArea > 0.0f)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (centroidExtent[axis] <= 0.0f)
+				continue;
+
+			struct Bin
+			{
+				glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+				glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+				unsigned int count = 0;
+			};
+			Bin bins[BinsCount];
+
+			const float scale = BinsCount / centroidExtent[axis];
+			for (unsigned int i = begin; i < end; i++)
+			{
+				const unsigned int bin = std::min(BinsCount - 1, static_cast<unsigned int>((buildItems[i].centroid[axis] - centroidMin[axis]) * scale));
+				bins[bin].min = glm::min(bins[bin].min, buildItems[i].bounds.min);
+				bins[bin].max = glm::max(bins[bin].max, buildItems[i].bounds.max);
+				bins[bin].count++;
+			}
+
+			// Areas and counts of everything right of each split, swept from the right
+			float rightArea[BinsCount];
+			unsigned int rightCount[BinsCount];
+			Bin right;
+			for (unsigned int bin = BinsCount - 1; bin > 0; bin--)
+			{
+				right.min = glm::min(right.min, bins[bin].min);
+				right.max = glm::max(right.max, bins[bin].max);
+				right.count += bins[bin].count;
+				rightArea[bin] = right.count ? SurfaceArea(right.min, right.max) : 0.0f;
+				rightCount[bin] = right.count;
+			}
+
+			Bin left;
+			for (unsigned int split = 1; split < BinsCount; split++)
+			{
+				left.min = glm::min(left.min, bins[split - 1].min);
+				left.max = glm::max(left.max, bins[split - 1].max);
+				left.count += bins[split - 1].count;
+				if (left.count == 0 || rightCount[split] == 0)
+					continue;
+
+				const float cost = TraversalCost + IntersectionCost *
+					(SurfaceArea(left.min, left.max) * left.count + rightArea[split] * rightCount[split]) / nodeArea;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+	}
+
+	const bool sahFound = bestAxis >= 0;
+	if (count <= MaxLeafItems && (!sahFound || bestCost >= IntersectionCost * count))
+		return nodeIndex;
+
+	unsigned int middle = begin;
+	if (sahFound)
+	{
+		const float scale = BinsCount / centroidExtent[bestAxis];
+		const auto it = std::partition(buildItems.begin() + begin, buildItems.begin() + end, [&](const BuildItem& item) {
+			return std::min(BinsCount - 1, static_cast<unsigned int>((item.centroid[bestAxis] - centroidMin[bestAxis]) * scale)) < bestSplit;
+		});
+		middle = static_cast<unsigned int>(it - buildItems.begin());
+	}
+
+	if (middle == begin || middle == end)
+	{
+		// No useful split, halve the items along the widest axis
+		const int axis = centroidExtent.x >= centroidExtent.y && centroidExtent.x >= centroidExtent.z ? 0 : (centroidExtent.y >= centroidExtent.z ? 1 : 2);
+		middle = begin + count / 2;
+		std::nth_element(buildItems.begin() + begin, buildItems.begin() + middle, buildItems.begin() + end, [axis](const BuildItem& a, const BuildItem& b) {
+			return a.centroid[axis] < b.centroid[axis];
+		});
+	}
+
+	BuildNode(begin, middle, depth + 1, buildItems);
+	const unsigned int rightChild = BuildNode(middle, end, depth + 1, buildItems);
+
+	m_nodes[nodeIndex].offset = rightChild;
+	m_nodes[nodeIndex].count = 0;
+	return nodeIndex;
+}
+
+void Bvh::Refit()
+{
+	for (const unsigned int item : m_moved)
+	{
+		const unsigned int position = m_itemPosition[item];
+		if (position == NoPosition)
+			continue;
+
+		m_itemBounds[position] = m_bounds[item];
+
+		// Stop at the first node another item already marked, everything above is marked too
+		for (unsigned int node = m_itemLeaf[position]; node != NoPosition && !m_nodeDirty[node]; node = m_nodeParent[node])
+		{
+			m_nodeDirty[node] = 1;
+			m_dirtyNodes.push_back(node);
+		}
+	}
+	m_moved.clear();
+
+	// Children always have larger indices than their parent
+	std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end(), std::greater<>());
+	for (const unsigned int node : m_dirtyNodes)
+	{
+		RefitNode(node);
+		m_nodeDirty[node] = 0;
+	}
+	m_dirtyNodes.clear();
+}
+
+void Bvh::RefitNode(unsigned int index)
+{
+	Node& node = m_nodes[index];
+	m_cost -= NodeCost(node);
+
+	if (node.IsLeaf())
+	{
+		node.min = m_itemBounds[node.offset].min;
+		node.max = m_itemBounds[node.offset].max;
+		for (unsigned int position = node.offset + 1; position < node.offset + node.count; position++)
+		{
+			node.min = glm::min(node.min, m_itemBounds[position].min);
+			node.max = glm::max(node.max, m_itemBounds[position].max);
+		}
+	}
+	else
+	{
+		const Node& left = m_nodes[index + 1];
+		const Node& right = m_nodes[node.offset];
+		node.min = glm::min(left.min, right.min);
+		node.max = glm::max(left.max, right.max);
+	}
+
+	m_cost += NodeCost(node);
+}
+
+float Bvh::NodeCost(const Node& node) const
+{
+	return SurfaceArea(node.min, node.max) * (node.IsLeaf() ? IntersectionCost * node.count : TraversalCost);
+}
+
+void Bvh::AppendSubtree(unsigned int index, std::vector<unsigned int>& items) const
+{
+	// Items of a subtree are contiguous, from its leftmost to its rightmost leaf
+	unsigned int first = index;
+	while (!m_nodes[first].IsLeaf())
+		first++;
+
+	unsigned int last = index;
+	while (!m_nodes[last].IsLeaf())
+		last = m_nodes[last].offset;
+
+	const unsigned int begin = m_nodes[first].offset;
+	const unsigned int end = m_nodes[last].offset + m_nodes[last].count;
+	items.insert(items.end(), m_items.begin() + begin, m_items.begin() + end);
+}
+
+void Bvh::QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& items) const
+{
+	if (m_nodes.empty())
+		return;
+
+	struct Entry
+	{
+		unsigned int node;
+		unsigned int mask;
+	};
+	Entry stack[MaxDepth];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = { 0, allPlanesMask };
+
+	while (stackSize > 0)
+	{
+		Entry entry = stack[--stackSize];
+
+		while (true)
+		{
+			const Node& node = m_nodes[entry.node];
+			if (!ClassifyFrustum(node.min, node.max, frustum, entry.mask))
+				break;
+
+			if (entry.mask == 0)
+			{
+				AppendSubtree(entry.node, items);
+				break;
+			}
+
+			if (node.IsLeaf())
+			{
+				for (unsigned int position = node.offset; position < node.offset + node.count; position++)
+				{
+					unsigned int itemMask = entry.mask;
+					if (ClassifyFrustum(m_itemBounds[position].min, m_itemBounds[position].max, frustum, itemMask))
+						items.push_back(m_items[position]);
+				}
+				break;
+			}
+
+			stack[stackSize++] = { node.offset, entry.mask };
+			entry.node++;
+		}
+	}
+}
+
+void Bvh::QuerySphere(const BoundingSphere& sphere, std::vector<unsigned int>& items) const
+{
+	if (m_nodes.empty())
+		return;
+
+	unsigned int stack[MaxDepth];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+		if (!Overlaps(node.min, node.max, sphere))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			for (unsigned int position = node.offset; position < node.offset + node.count; position++)
+			{
+				if (Overlaps(m_itemBounds[position].min, m_itemBounds[position].max, sphere))
+					items.push_back(m_items[position]);
+			}
+			continue;
+		}
+
+		stack[stackSize++] = node.offset;
+		stack[stackSize++] = static_cast<unsigned int>(&node - m_nodes.data()) + 1;
+	}
+}
+
+void Bvh::QueryBox(const BoundingBox& box, std::vector<unsigned int>& items) const
+{
+	if (m_nodes.empty())
+		return;
+
+	unsigned int stack[MaxDepth];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+		if (!Overlaps(node.min, node.max, box))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			for (unsigned int position = node.offset; position < node.offset + node.count; position++)
+			{
+				if (Overlaps(m_itemBounds[position].min, m_itemBounds[position].max, box))
+					items.push_back(m_items[position]);
+			}
+			continue;
+		}
+
+		stack[stackSize++] = node.offset;
+		stack[stackSize++] = static_cast<unsigned int>(&node - m_nodes.data()) + 1;
+	}
+}
+
+Bvh::RayHit Bvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, const ItemFilter& filter) const
+{
+	RayHit hit{ NoItem, maxDistance };
+	if (m_nodes.empty())
+		return hit;
+
+	const glm::vec3 inverseDirection = 1.0f / direction;
+
+	struct Entry
+	{
+		unsigned int node;
+		float distance;
+	};
+	Entry stack[MaxDepth];
+	unsigned int stackSize = 0;
+
+	float rootEntry;
+	if (!IntersectsRay(m_nodes[0].min, m_nodes[0].max, origin, inverseDirection, maxDistance, rootEntry))
+		return hit;
+	stack[stackSize++] = { 0, rootEntry };
+
+	while (stackSize > 0)
+	{
+		const Entry entry = stack[--stackSize];
+		// A closer hit was found since this node was pushed
+		if (entry.distance > hit.distance)
+			continue;
+
+		const Node& node = m_nodes[entry.node];
+		if (node.IsLeaf())
+		{
+			for (unsigned int position = node.offset; position < node.offset + node.count; position++)
+			{
+				float distance;
+				if (!IntersectsRay(m_itemBounds[position].min, m_itemBounds[position].max, origin, inverseDirection, hit.distance, distance))
+					continue;
+
+				if (filter && !filter(m_items[position]))
+					continue;
+
+				hit = { m_items[position], distance };
+			}
+			continue;
+		}
+
+		const unsigned int leftIndex = entry.node + 1;
+		const unsigned int rightIndex = node.offset;
+		float leftEntry, rightEntry;
+		const bool leftHit = IntersectsRay(m_nodes[leftIndex].min, m_nodes[leftIndex].max, origin, inverseDirection, hit.distance, leftEntry);
+		const bool rightHit = IntersectsRay(m_nodes[rightIndex].min, m_nodes[rightIndex].max, origin, inverseDirection, hit.distance, rightEntry);
+
+		// Push the farther child first so the nearer one is visited next
+		if (leftHit && rightHit)
+		{
+			if (leftEntry < rightEntry)
+			{
+				stack[stackSize++] = { rightIndex, rightEntry };
+				stack[stackSize++] = { leftIndex, leftEntry };
+			}
+			else
+			{
+				stack[stackSize++] = { leftIndex, leftEntry };
+				stack[stackSize++] = { rightIndex, rightEntry };
+			}
+		}
+		else if (leftHit)
+			stack[stackSize++] = { leftIndex, leftEntry };
+		else if (rightHit)
+			stack[stackSize++] = { rightIndex, rightEntry };
+	}
+
+	return hit;
+}
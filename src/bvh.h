@@ -0,0 +1,116 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "frustum.h"
+
+// Bounding volume hierarchy over axis aligned boxes of items identified by small integer ids.
+// The tree is built with the binned surface area heuristic and stored as a flat array in
+// depth-first order, so the left child always directly follows its parent. Moving items only
+// refit the nodes above them; the tree is rebuilt once items are added or removed or the refits
+// made it noticeably worse than a fresh build.
+class Bvh
+{
+public:
+	static constexpr unsigned int NoItem = ~0u;
+
+	struct RayHit
+	{
+		unsigned int item = NoItem;
+		float distance = 0.0f;
+	};
+
+	// Return false to ignore an item in a raycast
+	using ItemFilter = std::function<bool(unsigned int item)>;
+
+	void Add(unsigned int item, const BoundingBox& bounds);
+	void Remove(unsigned int item);
+	void Clear();
+
+	void SetBounds(unsigned int item, const BoundingBox& bounds);
+	[[nodiscard]] const BoundingBox& GetBounds(unsigned int item) const { return m_bounds[item]; }
+
+	// Brings the tree up to date with the changes since the last call
+	void Update();
+
+	// All queries append the ids of the items whose boxes pass the test
+	void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& items) const;
+	void QuerySphere(const BoundingSphere& sphere, std::vector<unsigned int>& items) const;
+	void QueryBox(const BoundingBox& box, std::vector<unsigned int>& items) const;
+	// Closest item box hit by the ray. The direction does not need to be normalized,
+	// distances are measured in multiples of it.
+	[[nodiscard]] RayHit Raycast(const glm::vec3& origin, const glm::vec3& direction,
+		float maxDistance, const ItemFilter& filter = {}) const;
+
+	[[nodiscard]] size_t Size() const { return m_items.size(); }
+	[[nodiscard]] size_t GetNodesCount() const { return m_nodes.size(); }
+	// Expected cost of a random query relative to a single box test, lower is better
+	[[nodiscard]] float GetCost() const;
+	[[nodiscard]] unsigned int GetRebuildsCount() const { return m_rebuildsCount; }
+
+private:
+	static constexpr unsigned int NoPosition = ~0u;
+	static constexpr unsigned int BinsCount = 16;
+	static constexpr unsigned int MaxLeafItems = 4;
+	// Deeper than this splits fall back to halving the items, which keeps the
+	// traversal stack bounded even for degenerate inputs
+	static constexpr unsigned int MaxSahDepth = 40;
+	static constexpr unsigned int MaxDepth = 64;
+	static constexpr float TraversalCost = 1.0f;
+	static constexpr float IntersectionCost = 1.0f;
+	static constexpr float RebuildCostRatio = 1.5f;
+
+	// 32 bytes, two nodes per cache line
+	struct Node
+	{
+		glm::vec3 min;
+		// First item position for leaves, right child index otherwise
+		unsigned int offset;
+		glm::vec3 max;
+		// Zero for inner nodes
+		unsigned int count;
+
+		[[nodiscard]] bool IsLeaf() const { return count != 0; }
+	};
+	static_assert(sizeof(Node) == 32);
+
+	struct BuildItem
+	{
+		BoundingBox bounds;
+		glm::vec3 centroid;
+		unsigned int item;
+	};
+
+	void Build();
+	unsigned int BuildNode(unsigned int begin, unsigned int end, unsigned int depth, std::vector<BuildItem>& buildItems);
+	void Refit();
+	void RefitNode(unsigned int index);
+	[[nodiscard]] float NodeCost(const Node& node) const;
+	void AppendSubtree(unsigned int index, std::vector<unsigned int>& items) const;
+
+	// Source of truth by item id
+	std::vector<BoundingBox> m_bounds;
+	std::vector<unsigned char> m_alive;
+	std::vector<unsigned int> m_itemPosition;
+	std::vector<unsigned int> m_moved;
+	bool m_structureChanged = false;
+
+	// Item data in leaf order, so a leaf reads a contiguous range
+	std::vector<unsigned int> m_items;
+	std::vector<BoundingBox> m_itemBounds;
+	std::vector<unsigned int> m_itemLeaf;
+
+	std::vector<Node> m_nodes;
+	std::vector<unsigned int> m_nodeParent;
+	std::vector<unsigned char> m_nodeDirty;
+	std::vector<unsigned int> m_dirtyNodes;
+
+	// Sum of the node costs before dividing by the root area
+	float m_cost = 0.0f;
+	float m_builtCost = 0.0f;
+	unsigned int m_rebuildsCount = 0;
+};
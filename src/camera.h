@@ -23,15 +23,43 @@ public:
 		return viewMatrix;
 	}
 
+	[[nodiscard]] glm::mat4 GetProjectionMatrix() const
+	{
+		return glm::perspective(glm::radians(m_fovY), m_aspectRatio, s_nearPlane, s_farPlane);
+	}
+
 	[[nodiscard]] glm::vec2 GetRotation() const { return m_rotation; }
 	void SetRotation(glm::vec2 rotation) { m_rotation = rotation; }
 
 	[[nodiscard]] glm::vec3 GetPosition() const { return m_position; }
 	void SetPosition(glm::vec3 position) { m_position = position; }
 
+	// Turns the camera towards target, yaw 0 looks down -z and positive pitch looks down
+	void LookAt(glm::vec3 target)
+	{
+		const glm::vec3 direction = glm::normalize(target - m_position);
+		m_rotation = glm::vec2(glm::degrees(glm::atan(direction.x, -direction.z)), glm::degrees(glm::asin(-direction.y)));
+	}
+
 	[[nodiscard]] float GetFovY() const { return m_fovY; }
 	void SetFovY(float fovY) { m_fovY = fovY; }
 
+	// Scale from distance to the projected size of a unit radius, see ProjectedSize
+	[[nodiscard]] float GetProjectedSizeScale() const { return 1.0f / glm::tan(glm::radians(m_fovY) * 0.5f); }
+
+	// Radius of the sphere over half the screen height, used to pick levels of detail
+	[[nodiscard]] float ProjectedSize(glm::vec3 center, float radius) const
+	{
+		const float distance = glm::distance(center, m_position);
+		if (distance <= radius)
+			return GetProjectedSizeScale();
+
+		return radius / distance * GetProjectedSizeScale();
+	}
+
+	[[nodiscard]] static float GetNearPlane() { return s_nearPlane; }
+	[[nodiscard]] static float GetFarPlane() { return s_farPlane; }
+
 	[[nodiscard]] float GetAspectRatio() const { return m_aspectRatio; }
 	void SetAspectRatio(float aspectRatio) { m_aspectRatio = aspectRatio; }
 
@@ -68,4 +96,7 @@ private:
 	glm::vec3 m_position = glm::vec3(0, 0, 0);
 	float m_fovY;
 	float m_aspectRatio;
+
+	static constexpr float s_nearPlane = 0.1f;
+	static constexpr float s_farPlane = 1000.0f;
 };
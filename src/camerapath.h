@@ -0,0 +1,64 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+// Closed Catmull-Rom spline through camera positions and the points they look at. It is
+// evaluated by time only, so the same timestep always reproduces the same frames.
+class CameraPath
+{
+public:
+	struct Key
+	{
+		glm::vec3 position;
+		glm::vec3 target;
+	};
+
+	// The keys are spread evenly over duration seconds, after which the path loops
+	CameraPath(std::vector<Key> keys, float duration) : m_keys(std::move(keys)), m_duration(duration) {}
+
+	void Apply(Camera& camera, float time) const
+	{
+		const Key key = Evaluate(time);
+		camera.SetPosition(key.position);
+		camera.LookAt(key.target);
+	}
+
+	[[nodiscard]] Key Evaluate(float time) const
+	{
+		if (m_keys.size() < 2)
+			return m_keys.empty() ? Key{ glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f) } : m_keys.front();
+
+		const int count = static_cast<int>(m_keys.size());
+		const float position = glm::fract(time / m_duration) * static_cast<float>(count);
+		const int segment = static_cast<int>(position);
+		const float t = position - static_cast<float>(segment);
+
+		const Key& k0 = m_keys[(segment + count - 1) % count];
+		const Key& k1 = m_keys[segment % count];
+		const Key& k2 = m_keys[(segment + 1) % count];
+		const Key& k3 = m_keys[(segment + 2) % count];
+
+		return {
+			CatmullRom(k0.position, k1.position, k2.position, k3.position, t),
+			CatmullRom(k0.target, k1.target, k2.target, k3.target, t)
+		};
+	}
+
+	[[nodiscard]] float GetDuration() const { return m_duration; }
+
+private:
+	[[nodiscard]] static glm::vec3 CatmullRom(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, float t)
+	{
+		const float t2 = t * t;
+		const float t3 = t2 * t;
+		return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+	}
+
+	std::vector<Key> m_keys;
+	float m_duration;
+};
@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -8,7 +10,8 @@ void Entity::Draw(const Camera& camera,
 	const std::vector<Sun>& suns,
 	const std::vector<PointLight>& pointLights,
 	const std::vector<SpotLight>& spotLights,
-	int id) const
+	int id,
+	std::span<const DrawElementsIndirectCommand> commands) const
 {
 	if (!m_model)
 		return;
@@ -18,54 +21,113 @@ void Entity::Draw(const Camera& camera,
 
 	ApplyPositionAndRotation(m_material.GetShader());
 	ApplyCamera(m_material.GetShader(), camera);
+	m_model->ApplyVertexFormat(m_material.GetShader());
 
 	if (m_highlighted)
 	{
+		// Marks the entity for the outline DrawHighlight draws around it
 		glStencilOp(GL_KEEP, GL_REPLACE, GL_REPLACE);
-		m_model->Draw();
-
+		DrawModel(commands);
 		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-		glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
-		glDepthRange(0, 0);
-
-		m_material.UseHighlight();
-		ApplyPositionAndRotation(m_material.GetHighlightShader(), .2f);
-		ApplyCamera(m_material.GetHighlightShader(), camera);
-		m_model->Draw();
-		glDepthRange(0, 1);
-
-		glStencilFunc(GL_ALWAYS, 1, 0xFF);
 	}
 	else
 	{
-		m_model->Draw();
+		DrawModel(commands);
 	}
 }
 
+void Entity::DrawHighlight(const Camera& camera) const
+{
+	if (!m_model || !m_highlighted)
+		return;
+
+	glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
+	glDepthRange(0, 0);
+
+	m_material.UseHighlight();
+	ApplyPositionAndRotation(m_material.GetHighlightShader(), .2f);
+	ApplyCamera(m_material.GetHighlightShader(), camera);
+	m_model->ApplyVertexFormat(m_material.GetHighlightShader());
+	m_model->Draw(m_lod);
+	glDepthRange(0, 1);
+
+	glStencilFunc(GL_ALWAYS, 1, 0xFF);
+}
+
+void Entity::DrawShadow(ShaderProgram& shader, unsigned int lod) const
+{
+	if (!m_model)
+		return;
+
+	m_material.UseShadow(shader);
+	ApplyPositionAndRotation(shader);
+	m_model->ApplyVertexFormat(shader);
+	m_model->Draw(lod);
+}
+
+void Entity::DrawModel(std::span<const DrawElementsIndirectCommand> commands) const
+{
+	if (commands.empty())
+		m_model->Draw(m_lod);
+	else
+		m_model->DrawCommands(commands);
+}
+
 void Entity::ApplyPositionAndRotation(ShaderProgram& shader, float scaleIncrease) const
 {
-	glm::mat4 modelMatrix =
-		glm::scale(
+	glm::mat4 modelMatrix = m_worldMatrix;
+	if (scaleIncrease != 0.0f)
+	{
+		// Grow by a fixed amount on every axis regardless of the entity's own scale
+		const glm::vec3 safeScale = glm::max(glm::abs(m_scale), glm::vec3(0.0001f));
+		modelMatrix = glm::scale(modelMatrix, (safeScale + glm::vec3(scaleIncrease)) / safeScale);
+	}
+
+	shader.SetMat4("model", modelMatrix);
+	shader.SetMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(modelMatrix))));
+}
+
+glm::mat4 Entity::GetLocalMatrix() const
+{
+	return glm::scale(
+		glm::rotate(
 			glm::rotate(
 				glm::rotate(
-					glm::rotate(
-						glm::translate(glm::mat4(1.0f), m_position),
-						glm::radians(m_rotation.y), glm::vec3(0.0f, 1.0f, 0.0f)),
-					glm::radians(m_rotation.z), glm::vec3(0.0f, 0.0f, 1.0f)
-				),
-				glm::radians(m_rotation.x), glm::vec3(1.0f, 0.0f, 0.0f)),
-			m_scale + glm::vec3(scaleIncrease));
+					glm::translate(glm::mat4(1.0f), m_position),
+					glm::radians(m_rotation.y), glm::vec3(0.0f, 1.0f, 0.0f)),
+				glm::radians(m_rotation.z), glm::vec3(0.0f, 0.0f, 1.0f)
+			),
+			glm::radians(m_rotation.x), glm::vec3(1.0f, 0.0f, 0.0f)),
+		m_scale);
+}
 
-	shader.SetMat4("model", modelMatrix);
+void Entity::SetLocalMatrix(const glm::mat4& local)
+{
+	m_position = glm::vec3(local[3]);
+	m_scale = glm::vec3(glm::length(glm::vec3(local[0])), glm::length(glm::vec3(local[1])), glm::length(glm::vec3(local[2])));
+
+	glm::mat3 rotation(glm::vec3(local[0]) / m_scale.x, glm::vec3(local[1]) / m_scale.y, glm::vec3(local[2]) / m_scale.z);
+	// A mirroring is kept in the scale, the rotation can't hold it
+	if (glm::determinant(rotation) < 0.0f)
+	{
+		m_scale.x = -m_scale.x;
+		rotation[0] = -rotation[0];
+	}
+
+	// Inverse of the Y, Z, X rotation order used by GetLocalMatrix
+	const float y = std::atan2(-rotation[0][2], rotation[0][0]);
+	const float z = std::atan2(rotation[0][1], std::sqrt(rotation[0][0] * rotation[0][0] + rotation[0][2] * rotation[0][2]));
+	const float x = std::atan2(std::sin(y) * rotation[1][0] + std::cos(y) * rotation[1][2],
+		std::sin(y) * rotation[2][0] + std::cos(y) * rotation[2][2]);
+	m_rotation = glm::degrees(glm::vec3(x, y, z));
+	m_transformDirty = true;
 }
 
 void Entity::ApplyCamera(ShaderProgram& shader, const Camera& camera) const
 {
 	shader.SetMat4("view", camera.GetMatrix());
 
-	glm::mat4 perspective =
-		glm::perspective(glm::radians(camera.GetFovY()), camera.GetAspectRatio(), 0.1f, 1000.0f);
-	shader.SetMat4("perspective", perspective);
+	shader.SetMat4("perspective", camera.GetProjectionMatrix());
 	shader.SetVector3("cameraPosition", camera.GetPosition());
 }
 
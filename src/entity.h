@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <optional>
+#include <span>
 #include <utility>
 
 #include "material.h"
@@ -17,47 +18,80 @@ public:
 	explicit Entity(const Model* model, Material material) :
 		m_model(model), m_material(std::move(material)), m_highlighted(false) {}
 
+	// Draws the given commands instead of the whole level when there are any, e.g. visible meshlets
 	void Draw(const Camera& camera,
 		const std::vector<Sun>& sun,
 		const std::vector<PointLight>& pointLight,
 		const std::vector<SpotLight>& spotLight,
-		int id) const;
+		int id,
+		std::span<const DrawElementsIndirectCommand> commands = {}) const;
+	// Outline around the stencil Draw left when highlighted, on top of everything as it writes depth 0
+	void DrawHighlight(const Camera& camera) const;
 
-	[[nodiscard]] Material GetMaterial() const { return m_material; }
-	void SetMaterial(Material newMaterial) { m_material = std::move(newMaterial); }
+	[[nodiscard]] const Material& GetMaterial() const { return m_material; }
+	// The world bounds depend on the model and billboarding, so both count as a transform change
+	void SetMaterial(Material newMaterial) { m_material = std::move(newMaterial); m_transformDirty = true; }
 
 	[[nodiscard]] const Model* GetModel() const { return m_model; }
-	void SwitchModel(const Model* newModel) { m_model = newModel; }
+	void SwitchModel(const Model* newModel) { m_model = newModel; m_lod = 0; m_transformDirty = true; }
 
-	void SetPosition(glm::vec3 position) { m_position = position; }
+	// Level of detail of the model to draw, picked by the scene every frame
+	void SetLod(unsigned int lod) { m_lod = lod; }
+	[[nodiscard]] unsigned int GetLod() const { return m_lod; }
+
+	// Position, rotation and scale are relative to the parent entity in the scene
+	void SetPosition(glm::vec3 position) { m_position = position; m_transformDirty = true; }
 	[[nodiscard]] glm::vec3 GetPosition() const { return m_position; }
 
-	void SetRotation(glm::vec3 rotation) { m_rotation = rotation; }
+	void SetRotation(glm::vec3 rotation) { m_rotation = rotation; m_transformDirty = true; }
 	[[nodiscard]] glm::vec3 GetRotation() const { return m_rotation; }
 
-	void SetScale(glm::vec3 scale) { m_scale = scale; }
+	void SetScale(glm::vec3 scale) { m_scale = scale; m_transformDirty = true; }
 	[[nodiscard]] glm::vec3 GetScale() const { return m_scale; }
 
+	[[nodiscard]] glm::mat4 GetLocalMatrix() const;
+	// Decomposes into position, rotation and scale, any shear is lost
+	void SetLocalMatrix(const glm::mat4& local);
+	[[nodiscard]] bool GetIsTransformDirty() const { return m_transformDirty; }
+	void ClearTransformDirty() { m_transformDirty = false; }
+
+	// Computed by the scene from the local matrices of the entity and its parents
+	[[nodiscard]] const glm::mat4& GetWorldMatrix() const { return m_worldMatrix; }
+	void SetWorldMatrix(const glm::mat4& worldMatrix) { m_worldMatrix = worldMatrix; }
+
 	void Update(float deltaTime);
 
 	void SetUpdateFunc(
 		std::function<void(Entity* entity, float deltaTime)> updateFunc);
 	[[nodiscard]] bool GetShouldUpdate() const { return m_shouldUpdate; }
 	void SetShouldUpdate(bool shouldUpdate) { m_shouldUpdate = shouldUpdate; }
+	// Runs an update function every frame, so its transform can't be cached from one frame to the next
+	[[nodiscard]] bool GetIsDynamic() const { return m_shouldUpdate && m_updateFunc && *m_updateFunc; }
 
 	void SetIsHighlighted(bool highlighted) { m_highlighted = highlighted; }
 	[[nodiscard]] bool GetIsHighlighted() const { return m_highlighted; }
 
-private:
+	// Draws the model's depth with a shadow map program at the given level rather than the camera's,
+	// see ShadowCascades
+	void DrawShadow(ShaderProgram& shader, unsigned int lod) const;
+
+	// Uploads the world matrix and its normal matrix, grown by scaleIncrease for the highlight outline
 	void ApplyPositionAndRotation(ShaderProgram& shader, float scaleIncrease = 0.0f) const;
+
+private:
+	void DrawModel(std::span<const DrawElementsIndirectCommand> commands) const;
 	void ApplyCamera(ShaderProgram& shader, const Camera& camera) const;
 
 	const Model* m_model;
 	Material m_material;
+	unsigned int m_lod = 0;
 
 	glm::vec3 m_position{};
 	glm::vec3 m_rotation{};
 	glm::vec3 m_scale = glm::vec3(1.0f, 1.0f, 1.0f);
+	bool m_transformDirty = true;
+
+	glm::mat4 m_worldMatrix = glm::mat4(1.0f);
 
 	std::optional<std::function<void(Entity* entity, float deltaTime)>> m_updateFunc;
 	bool m_shouldUpdate = true;
@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include "entitylights.h"
+#include "lightrange.h"
+
+void EntityLights::Update(const Scene& scene,
+	const std::vector<PointLight>& pointLights,
+	const std::vector<SpotLight>& spotLights,
+	float intensityCutoff)
+{
+	m_lists.assign(scene.Size(), LightList{});
+	m_indices.clear();
+	m_entries.clear();
+	m_litEntitiesCount = 0;
+	m_fallbackEntitiesCount = 0;
+	if (!m_enabled)
+		return;
+
+	// Lights ask the BVH for the entities they reach rather than every entity testing every light
+	const auto collect = [&](const BoundingSphere& bounds, unsigned int lightIndex, const SpotLight* spotLight, float range) {
+		m_queryResults.clear();
+		scene.QuerySphere(bounds, m_queryResults);
+		for (const EntityHandle handle : m_queryResults)
+		{
+			const int index = scene.IndexOf(handle);
+			if (index < 0)
+				continue;
+
+			if (spotLight && !IntersectsSpotLight(*spotLight, range, scene.GetCuller().Get(index)))
+				continue;
+
+			m_entries.push_back({ static_cast<unsigned int>(index), lightIndex });
+			LightList& list = m_lists[index];
+			(spotLight ? list.spotLightsCount : list.pointLightsCount)++;
+		}
+	};
+
+	for (size_t i = 0; i < pointLights.size(); i++)
+	{
+		const PointLight& light = pointLights[i];
+		const LightRange range = GetLightRange(light, intensityCutoff);
+		if (range.range > 0.0f)
+			collect({ light.position, range.range }, static_cast<unsigned int>(i), nullptr, range.range);
+	}
+
+	for (size_t i = 0; i < spotLights.size(); i++)
+	{
+		const SpotLight& light = spotLights[i];
+		const LightRange range = GetLightRange(light, intensityCutoff);
+		if (range.range > 0.0f)
+			collect(GetSpotLightBounds(light, range.range), static_cast<unsigned int>(i), &light, range.range);
+	}
+
+	// Counting sort by entity. The point lights were collected first, so every list keeps them
+	// ahead of its spot lights like the cluster lists do.
+	unsigned int first = 0;
+	for (LightList& list : m_lists)
+	{
+		list.first = first;
+		const unsigned int lightsCount = list.pointLightsCount + list.spotLightsCount;
+		first += lightsCount;
+		m_litEntitiesCount += lightsCount > 0;
+		m_fallbackEntitiesCount += lightsCount > MaxLightsPerEntity;
+	}
+
+	m_indices.resize(m_entries.size());
+	m_cursors.resize(m_lists.size());
+	for (size_t i = 0; i < m_lists.size(); i++)
+		m_cursors[i] = m_lists[i].first;
+	for (const Entry& entry : m_entries)
+		m_indices[m_cursors[entry.entityIndex]++] = entry.lightIndex;
+}
+
+void EntityLights::Apply(ShaderProgram& shader, size_t entityIndex) const
+{
+	const LightList list = entityIndex < m_lists.size() ? m_lists[entityIndex] : LightList{};
+	const unsigned int lightsCount = list.pointLightsCount + list.spotLightsCount;
+	const bool listed = m_enabled && lightsCount <= MaxLightsPerEntity;
+
+	shader.Use();
+	shader.SetInt("entityLights", listed);
+	if (!listed)
+		return;
+
+	shader.SetUint("entityPointLightsCount", list.pointLightsCount);
+	shader.SetUint("entitySpotLightsCount", list.spotLightsCount);
+	shader.SetUintArray("entityLightIndices", std::span(m_indices).subspan(list.first, lightsCount));
+}
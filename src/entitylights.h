@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+#include "pointlight.h"
+#include "scene.h"
+#include "shaderprogram.h"
+#include "spotlight.h"
+
+// Per entity light lists, worked out on the CPU. Every light's range is derived from its
+// attenuation, then the scene's BVH is asked for the entities whose bounds it reaches, and spot
+// lights are narrowed down to the entities touching their cone. The scene uploads the list of an
+// entity as uniforms right before drawing it, so its fragments only loop over the lights around
+// it. Scatters cover too much ground for a list of their own and keep using LightClusters.
+class EntityLights
+{
+public:
+	// Matches MAX_ENTITY_LIGHTS of lighting.glsl. Entities reached by more lights, like a large
+	// ground, fall back to the clusters rather than dropping some.
+	static constexpr unsigned int MaxLightsPerEntity = 32;
+
+	// Lists the lights reaching every entity of the scene. Call after the scene's Update, with the
+	// cutoff the lights were uploaded with so the ranges match the shaders' fade out.
+	void Update(const Scene& scene,
+		const std::vector<PointLight>& pointLights,
+		const std::vector<SpotLight>& spotLights,
+		float intensityCutoff);
+
+	// Uploads the list of the entity at the dense index to a program built from fragmentShader.glsl.
+	// While disabled, or when the list doesn't fit, the program goes back to clustered or all lights.
+	void Apply(ShaderProgram& shader, size_t entityIndex) const;
+
+	void SetEnabled(bool enabled) { m_enabled = enabled; }
+	[[nodiscard]] bool GetEnabled() const { return m_enabled; }
+
+	// Counters of the last Update, lights are counted once per entity they reach
+	[[nodiscard]] size_t GetListedLightsCount() const { return m_indices.size(); }
+	[[nodiscard]] size_t GetLitEntitiesCount() const { return m_litEntitiesCount; }
+	// Lit entities drawn with the clusters because their list doesn't fit
+	[[nodiscard]] size_t GetFallbackEntitiesCount() const { return m_fallbackEntitiesCount; }
+
+private:
+	struct LightList
+	{
+		unsigned int first = 0;
+		unsigned int pointLightsCount = 0;
+		unsigned int spotLightsCount = 0;
+	};
+
+	struct Entry
+	{
+		unsigned int entityIndex;
+		unsigned int lightIndex;
+	};
+
+	bool m_enabled = false;
+	// By dense entity index, into m_indices
+	std::vector<LightList> m_lists;
+	std::vector<unsigned int> m_indices;
+	size_t m_litEntitiesCount = 0;
+	size_t m_fallbackEntitiesCount = 0;
+
+	std::vector<Entry> m_entries;
+	std::vector<EntityHandle> m_queryResults;
+	std::vector<unsigned int> m_cursors;
+};
@@ -32,6 +32,26 @@ inline std::vector<std::string> readFileAsLines(const std::string& path) {
 	return result;
 }
 
+// Reads a shader and pastes in the files named by its #include "file" lines, which GLSL has no
+// support for. Included paths are relative to the including shader.
+inline std::string readShaderSource(const std::string& path) {
+	const std::string directory = path.substr(0, path.find_last_of('/') + 1);
+	const std::string include = "#include \"";
+
+	std::string source;
+	for (const std::string& line : readFileAsLines(path)) {
+		if (line.starts_with(include)) {
+			const size_t end = line.find('"', include.size());
+			source += readShaderSource(directory + line.substr(include.size(), end - include.size()));
+		}
+		else {
+			source += line;
+			source += '\n';
+		}
+	}
+	return source;
+}
+
 inline std::ifstream readFileAsStream(const std::string& path)
 {
 	std::ifstream stream(path);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+// Six planes pointing into the frustum, extracted from a view-projection matrix
+struct Frustum
+{
+	enum Plane { Left, Right, Bottom, Top, Near, Far, PlanesCount };
+
+	glm::vec4 planes[PlanesCount];
+
+	static Frustum FromMatrix(const glm::mat4& viewProjection)
+	{
+		const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		Frustum frustum{};
+		frustum.planes[Left] = row3 + row0;
+		frustum.planes[Right] = row3 - row0;
+		frustum.planes[Bottom] = row3 + row1;
+		frustum.planes[Top] = row3 - row1;
+		frustum.planes[Near] = row3 + row2;
+		frustum.planes[Far] = row3 - row2;
+
+		for (glm::vec4& plane : frustum.planes)
+			plane /= glm::length(glm::vec3(plane));
+
+		return frustum;
+	}
+
+	[[nodiscard]] bool Intersects(const BoundingSphere& sphere) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+				return false;
+		}
+
+		return true;
+	}
+
+	[[nodiscard]] bool Intersects(const BoundingBox& box) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			// Corner furthest along the plane normal
+			const glm::vec3 corner(
+				plane.x >= 0.0f ? box.max.x : box.min.x,
+				plane.y >= 0.0f ? box.max.y : box.min.y,
+				plane.z >= 0.0f ? box.max.z : box.min.z);
+
+			if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+				return false;
+		}
+
+		return true;
+	}
+};
@@ -0,0 +1,136 @@
+#include <string>
+
+#include <glad/glad.h>
+
+#include "gbuffer.h"
+
+namespace
+{
+	unsigned int createTexture(GLenum format, int width, int height)
+	{
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return texture;
+	}
+}
+
+GBuffer::~GBuffer()
+{
+	const unsigned int textures[] = { m_albedoTexture, m_normalTexture, m_specularTexture };
+	glDeleteTextures(3, textures);
+
+	const unsigned int framebuffers[] = { m_framebuffer, m_lightingFramebuffer };
+	glDeleteFramebuffers(2, framebuffers);
+}
+
+void GBuffer::Resize(int width, int height, unsigned int colorTexture, unsigned int entityTexture, unsigned int depthStencilTexture)
+{
+	if (width <= 0 || height <= 0)
+		return;
+
+	if (m_framebuffer == 0)
+	{
+		glGenFramebuffers(1, &m_framebuffer);
+		glGenFramebuffers(1, &m_lightingFramebuffer);
+	}
+	else
+	{
+		const unsigned int textures[] = { m_albedoTexture, m_normalTexture, m_specularTexture };
+		glDeleteTextures(3, textures);
+	}
+
+	m_size = glm::ivec2(width, height);
+	m_depthStencilTexture = depthStencilTexture;
+	m_albedoTexture = createTexture(GL_RGBA8, width, height);
+	m_normalTexture = createTexture(GL_RG16F, width, height);
+	m_specularTexture = createTexture(GL_RGBA8, width, height);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Locations of fragmentShader.glsl's outputs
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_albedoTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, entityTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, m_normalTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, m_specularTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthStencilTexture, 0);
+	const GLenum attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
+	glDrawBuffers(4, attachments);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_lightingFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool GBuffer::IsComplete() const
+{
+	if (m_framebuffer == 0)
+		return false;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, m_lightingFramebuffer);
+	complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return complete;
+}
+
+void GBuffer::SetGeometryPass(ShaderProgram& shader, bool geometryPass)
+{
+	shader.Use();
+	shader.SetInt("gBufferPass", geometryPass);
+}
+
+void GBuffer::BeginGeometryPass() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+}
+
+void GBuffer::Light(const Camera& camera, const LightClusters& lightClusters, const std::vector<Sun>& suns,
+	size_t pointLightsCount, size_t spotLightsCount, const Model& screen) const
+{
+	if (!m_lightingShader || m_lightingShader->GetId() == 0 || m_framebuffer == 0)
+		return;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_lightingFramebuffer);
+
+	const unsigned int textures[] = { m_albedoTexture, m_normalTexture, m_specularTexture, m_depthStencilTexture };
+	for (int i = 0; i < 4; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + TextureUnit + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	lightClusters.Apply(*m_lightingShader);
+	m_lightingShader->SetInt("albedoTexture", TextureUnit);
+	m_lightingShader->SetInt("normalTexture", TextureUnit + 1);
+	m_lightingShader->SetInt("specularTexture", TextureUnit + 2);
+	m_lightingShader->SetInt("depthTexture", TextureUnit + 3);
+	m_lightingShader->SetMat4("inverseViewProjection", glm::inverse(camera.GetProjectionMatrix() * camera.GetMatrix()));
+	m_lightingShader->SetVector3("cameraPosition", camera.GetPosition());
+	m_lightingShader->SetInt("pointLightsCount", static_cast<int>(pointLightsCount));
+	m_lightingShader->SetInt("spotLightsCount", static_cast<int>(spotLightsCount));
+
+	m_lightingShader->SetInt("sunsCount", static_cast<int>(suns.size()));
+	for (size_t i = 0; i < suns.size(); i++)
+	{
+		const Sun& sun = suns[i];
+		const std::string member = "suns[" + std::to_string(i) + "]";
+		m_lightingShader->SetVector3(member + ".direction", sun.direction);
+		m_lightingShader->SetVector3(member + ".ambient", sun.ambient);
+		m_lightingShader->SetVector3(member + ".diffuse", sun.diffuse);
+		m_lightingShader->SetVector3(member + ".specular", sun.specular);
+	}
+
+	// Every pixel is lit once, depth was already resolved by the geometry pass
+	glDisable(GL_DEPTH_TEST);
+	screen.Draw();
+	glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "lightclusters.h"
+#include "model.h"
+#include "shaderprogram.h"
+#include "sun.h"
+
+// Deferred shading. The scene is drawn into the G-buffer with fragmentShader.glsl writing albedo,
+// an octahedral normal and the specular strength and shininess instead of lighting, then a screen
+// pass lights every pixel once with the same lights and clusters as the forward path, whatever the
+// overdraw. The entity id and depth textures are shared with the forward framebuffer, so picking,
+// the highlight stencil and occlusion culling work the same in both paths.
+class GBuffer
+{
+public:
+	// First of the four texture units the G-buffer and depth textures get bound to for lighting,
+	// clear of the material maps and OcclusionCuller::TextureUnit
+	static constexpr int TextureUnit = 5;
+
+	explicit GBuffer(ShaderProgram* lightingShader) : m_lightingShader(lightingShader) {}
+	~GBuffer();
+
+	GBuffer(const GBuffer&) = delete;
+	GBuffer& operator=(const GBuffer&) = delete;
+
+	// Creates the G-buffer textures at the size of the forward framebuffer and attaches them together
+	// with its entity id and depth textures. Lighting writes to colorTexture.
+	void Resize(int width, int height, unsigned int colorTexture, unsigned int entityTexture, unsigned int depthStencilTexture);
+	[[nodiscard]] glm::ivec2 GetSize() const { return m_size; }
+	[[nodiscard]] bool IsComplete() const;
+
+	// Switches a program built from fragmentShader.glsl between lighting and writing the G-buffer
+	static void SetGeometryPass(ShaderProgram& shader, bool geometryPass);
+
+	// Binds the G-buffer framebuffer for the scene to be drawn into
+	void BeginGeometryPass() const;
+
+	// Lights the G-buffer into the color texture with the lights lightClusters uploaded this frame.
+	// Leaves the lighting framebuffer bound, it only holds the color texture.
+	void Light(const Camera& camera, const LightClusters& lightClusters, const std::vector<Sun>& suns,
+		size_t pointLightsCount, size_t spotLightsCount, const Model& screen) const;
+
+private:
+	ShaderProgram* m_lightingShader;
+	glm::ivec2 m_size = glm::ivec2(0);
+
+	unsigned int m_framebuffer = 0;
+	unsigned int m_lightingFramebuffer = 0;
+	unsigned int m_albedoTexture = 0;
+	unsigned int m_normalTexture = 0;
+	unsigned int m_specularTexture = 0;
+	unsigned int m_depthStencilTexture = 0;
+};
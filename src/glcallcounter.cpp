@@ -0,0 +1,425 @@
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glcallcounter.h"
+
+namespace
+{
+	GlCallCounts s_counts;
+	GlCallCounts s_lastFrameCounts;
+	bool s_installed = false;
+
+#if ENTITIES_GL_INSTRUMENTATION
+	std::vector<GlFunctionCalls> s_functionCalls;
+	std::vector<GlFunctionCalls> s_lastFrameFunctionCalls;
+
+	// What the hooked calls last set. Missing values are unknown, so a call setting them is never redundant.
+	struct ShadowState
+	{
+		std::optional<GLuint> program;
+		std::optional<GLuint> vertexArray;
+		std::optional<GLenum> activeTexture;
+		// Keyed by texture unit and target
+		std::map<std::pair<GLenum, GLenum>, GLuint> textures;
+		std::map<GLuint, std::tuple<GLuint, GLint, GLboolean, GLint, GLenum, GLenum>> imageTextures;
+		std::map<GLenum, GLuint> buffers;
+		std::map<std::pair<GLenum, GLuint>, GLuint> indexedBuffers;
+		std::optional<GLuint> drawFramebuffer;
+		std::optional<GLuint> readFramebuffer;
+		std::map<GLenum, bool> capabilities;
+		std::optional<GLenum> cullFace;
+		std::optional<GLboolean> depthMask;
+		std::optional<std::tuple<GLenum, GLint, GLuint>> stencilFunc;
+		std::optional<std::tuple<GLenum, GLenum, GLenum>> stencilOp;
+		std::optional<GLuint> stencilMask;
+		std::optional<std::tuple<GLint, GLint, GLsizei, GLsizei>> viewport;
+		// Keyed by program and location
+		std::map<std::pair<GLuint, GLint>, std::vector<std::byte>> uniforms;
+	};
+
+	ShadowState s_shadow;
+
+	// Sets the shadowed value and returns whether it already had it
+	template <typename T>
+	bool exchange(std::optional<T>& current, T value)
+	{
+		const bool same = current == value;
+		current = value;
+		return same;
+	}
+
+	template <typename Key, typename T>
+	bool exchange(std::map<Key, T>& current, const Key& key, T value)
+	{
+		const auto [it, inserted] = current.try_emplace(key, value);
+		if (inserted)
+			return false;
+
+		const bool same = it->second == value;
+		it->second = std::move(value);
+		return same;
+	}
+
+	void forgetUniforms(GLuint program)
+	{
+		s_shadow.uniforms.erase(
+			s_shadow.uniforms.lower_bound({ program, std::numeric_limits<GLint>::min() }),
+			s_shadow.uniforms.upper_bound({ program, std::numeric_limits<GLint>::max() }));
+	}
+
+	// Decide whether a call is redundant and shadow what it sets, before it is forwarded
+	namespace track
+	{
+		bool useProgram(GLuint program)
+		{
+			return exchange(s_shadow.program, program);
+		}
+
+		bool bindVertexArray(GLuint vertexArray)
+		{
+			if (exchange(s_shadow.vertexArray, vertexArray))
+				return true;
+
+			// The index buffer binding is part of the vertex array
+			s_shadow.buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+			return false;
+		}
+
+		bool activeTexture(GLenum unit)
+		{
+			return exchange(s_shadow.activeTexture, unit);
+		}
+
+		bool bindTexture(GLenum target, GLuint texture)
+		{
+			if (!s_shadow.activeTexture)
+				return false;
+
+			return exchange(s_shadow.textures, { *s_shadow.activeTexture, target }, texture);
+		}
+
+		bool bindImageTexture(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format)
+		{
+			return exchange(s_shadow.imageTextures, unit, { texture, level, layered, layer, access, format });
+		}
+
+		bool bindBuffer(GLenum target, GLuint buffer)
+		{
+			return exchange(s_shadow.buffers, target, buffer);
+		}
+
+		bool bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+		{
+			// Binding an indexed target binds the generic one as well
+			s_shadow.buffers[target] = buffer;
+			return exchange(s_shadow.indexedBuffers, { target, index }, buffer);
+		}
+
+		bool bindFramebuffer(GLenum target, GLuint framebuffer)
+		{
+			if (target == GL_DRAW_FRAMEBUFFER)
+				return exchange(s_shadow.drawFramebuffer, framebuffer);
+			if (target == GL_READ_FRAMEBUFFER)
+				return exchange(s_shadow.readFramebuffer, framebuffer);
+
+			const bool sameDraw = exchange(s_shadow.drawFramebuffer, framebuffer);
+			const bool sameRead = exchange(s_shadow.readFramebuffer, framebuffer);
+			return sameDraw && sameRead;
+		}
+
+		bool enable(GLenum capability)
+		{
+			return exchange(s_shadow.capabilities, capability, true);
+		}
+
+		bool disable(GLenum capability)
+		{
+			return exchange(s_shadow.capabilities, capability, false);
+		}
+
+		bool cullFace(GLenum mode)
+		{
+			return exchange(s_shadow.cullFace, mode);
+		}
+
+		bool depthMask(GLboolean flag)
+		{
+			return exchange(s_shadow.depthMask, flag);
+		}
+
+		bool stencilFunc(GLenum func, GLint ref, GLuint mask)
+		{
+			return exchange(s_shadow.stencilFunc, { func, ref, mask });
+		}
+
+		bool stencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass)
+		{
+			return exchange(s_shadow.stencilOp, { stencilFail, depthFail, depthPass });
+		}
+
+		bool stencilMask(GLuint mask)
+		{
+			return exchange(s_shadow.stencilMask, mask);
+		}
+
+		bool viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+		{
+			return exchange(s_shadow.viewport, { x, y, width, height });
+		}
+
+		bool uniform(GLint location, const void* value, size_t size)
+		{
+			// GL ignores writes to -1, so they are always wasted
+			if (location == -1)
+				return true;
+			if (!s_shadow.program)
+				return false;
+
+			const auto* bytes = static_cast<const std::byte*>(value);
+			return exchange(s_shadow.uniforms, { *s_shadow.program, location }, std::vector<std::byte>(bytes, bytes + size));
+		}
+
+		template <typename T>
+		bool uniformScalar(GLint location, T value)
+		{
+			return uniform(location, &value, sizeof(value));
+		}
+
+		template <int Components>
+		bool uniformVector(GLint location, GLsizei count, const GLfloat* value)
+		{
+			return uniform(location, value, sizeof(GLfloat) * Components * count);
+		}
+
+		bool uniformUintArray(GLint location, GLsizei count, const GLuint* value)
+		{
+			return uniform(location, value, sizeof(GLuint) * count);
+		}
+
+		template <int Components>
+		bool uniformMatrix(GLint location, GLsizei count, GLboolean, const GLfloat* value)
+		{
+			return uniform(location, value, sizeof(GLfloat) * Components * count);
+		}
+
+		// Deleted objects are unbound and their names reused, so forget everything shadowed of their kind
+		bool deleteTextures(GLsizei, const GLuint*)
+		{
+			s_shadow.textures.clear();
+			s_shadow.imageTextures.clear();
+			return false;
+		}
+
+		bool deleteBuffers(GLsizei, const GLuint*)
+		{
+			s_shadow.buffers.clear();
+			s_shadow.indexedBuffers.clear();
+			return false;
+		}
+
+		bool deleteVertexArrays(GLsizei, const GLuint*)
+		{
+			s_shadow.vertexArray.reset();
+			s_shadow.buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+			return false;
+		}
+
+		bool deleteFramebuffers(GLsizei, const GLuint*)
+		{
+			s_shadow.drawFramebuffer.reset();
+			s_shadow.readFramebuffer.reset();
+			return false;
+		}
+
+		bool deleteProgram(GLuint program)
+		{
+			if (s_shadow.program == program)
+				s_shadow.program.reset();
+			forgetUniforms(program);
+			return false;
+		}
+
+		// Linking resets every uniform to its default
+		bool linkProgram(GLuint program)
+		{
+			forgetUniforms(program);
+			return false;
+		}
+	}
+#endif
+
+	// One instance per hooked function, identified by its glad pointer. Without a counter the
+	// call is only tracked, e.g. deletes that invalidate the shadowed state.
+	template <typename Proc, Proc* GladPointer, unsigned long long GlCallCounts::* Counter, auto Tracker = nullptr>
+	struct CountedCall;
+
+	template <typename Result, typename... Args, Result (APIENTRYP* GladPointer)(Args...), unsigned long long GlCallCounts::* Counter, auto Tracker>
+	struct CountedCall<Result (APIENTRYP)(Args...), GladPointer, Counter, Tracker>
+	{
+		static inline Result (APIENTRYP s_original)(Args...) = nullptr;
+		static inline size_t s_index = 0;
+
+		static Result APIENTRY Call(Args... args)
+		{
+			if constexpr (Counter != nullptr)
+				++(s_counts.*Counter);
+
+#if ENTITIES_GL_INSTRUMENTATION
+			bool redundant = false;
+			if constexpr (!std::is_same_v<decltype(Tracker), std::nullptr_t>)
+				redundant = Tracker(args...);
+
+			if constexpr (Counter != nullptr)
+			{
+				GlFunctionCalls& calls = s_functionCalls[s_index];
+				++calls.calls;
+				if (redundant)
+				{
+					++calls.redundant;
+					++(Counter == &GlCallCounts::uniformUploads ? s_counts.redundantUniformUploads : s_counts.redundantStateChanges);
+				}
+			}
+#endif
+
+			return s_original(args...);
+		}
+
+		static void Install([[maybe_unused]] const char* name)
+		{
+			if (s_original || !*GladPointer)
+				return;
+
+			s_original = *GladPointer;
+			*GladPointer = &Call;
+
+#if ENTITIES_GL_INSTRUMENTATION
+			if constexpr (Counter != nullptr)
+			{
+				s_index = s_functionCalls.size();
+				s_functionCalls.push_back({ name });
+			}
+#endif
+		}
+	};
+}
+
+#define COUNT_GL_CALL(name, counter) \
+	CountedCall<decltype(glad_##name), &glad_##name, &GlCallCounts::counter>::Install(#name)
+
+#if ENTITIES_GL_INSTRUMENTATION
+#define TRACK_GL_CALL(name, counter, tracker) \
+	CountedCall<decltype(glad_##name), &glad_##name, &GlCallCounts::counter, &track::tracker>::Install(#name)
+#define SHADOW_GL_CALL(name, tracker) \
+	CountedCall<decltype(glad_##name), &glad_##name, nullptr, &track::tracker>::Install(#name)
+#else
+#define TRACK_GL_CALL(name, counter, tracker) \
+	CountedCall<decltype(glad_##name), &glad_##name, &GlCallCounts::counter>::Install(#name)
+#define SHADOW_GL_CALL(name, tracker)
+#endif
+
+void GlCallCounter::Install()
+{
+	COUNT_GL_CALL(glDrawArrays, drawCalls);
+	COUNT_GL_CALL(glDrawArraysInstanced, drawCalls);
+	COUNT_GL_CALL(glDrawElements, drawCalls);
+	COUNT_GL_CALL(glDrawElementsBaseVertex, drawCalls);
+	COUNT_GL_CALL(glDrawElementsInstanced, drawCalls);
+	COUNT_GL_CALL(glDrawElementsInstancedBaseVertex, drawCalls);
+	COUNT_GL_CALL(glDrawElementsIndirect, drawCalls);
+	COUNT_GL_CALL(glMultiDrawElementsIndirect, drawCalls);
+
+	COUNT_GL_CALL(glDispatchCompute, dispatches);
+
+	TRACK_GL_CALL(glUseProgram, stateChanges, useProgram);
+	TRACK_GL_CALL(glBindVertexArray, stateChanges, bindVertexArray);
+	TRACK_GL_CALL(glActiveTexture, stateChanges, activeTexture);
+	TRACK_GL_CALL(glBindTexture, stateChanges, bindTexture);
+	TRACK_GL_CALL(glBindImageTexture, stateChanges, bindImageTexture);
+	TRACK_GL_CALL(glBindBuffer, stateChanges, bindBuffer);
+	TRACK_GL_CALL(glBindBufferBase, stateChanges, bindBufferBase);
+	TRACK_GL_CALL(glBindFramebuffer, stateChanges, bindFramebuffer);
+	TRACK_GL_CALL(glEnable, stateChanges, enable);
+	TRACK_GL_CALL(glDisable, stateChanges, disable);
+	TRACK_GL_CALL(glCullFace, stateChanges, cullFace);
+	TRACK_GL_CALL(glDepthMask, stateChanges, depthMask);
+	TRACK_GL_CALL(glStencilFunc, stateChanges, stencilFunc);
+	TRACK_GL_CALL(glStencilOp, stateChanges, stencilOp);
+	TRACK_GL_CALL(glStencilMask, stateChanges, stencilMask);
+	TRACK_GL_CALL(glViewport, stateChanges, viewport);
+
+	TRACK_GL_CALL(glUniform1i, uniformUploads, uniformScalar<GLint>);
+	TRACK_GL_CALL(glUniform1ui, uniformUploads, uniformScalar<GLuint>);
+	TRACK_GL_CALL(glUniform1f, uniformUploads, uniformScalar<GLfloat>);
+	TRACK_GL_CALL(glUniform1uiv, uniformUploads, uniformUintArray);
+	TRACK_GL_CALL(glUniform2fv, uniformUploads, uniformVector<2>);
+	TRACK_GL_CALL(glUniform3fv, uniformUploads, uniformVector<3>);
+	TRACK_GL_CALL(glUniform4fv, uniformUploads, uniformVector<4>);
+	TRACK_GL_CALL(glUniformMatrix3fv, uniformUploads, uniformMatrix<9>);
+	TRACK_GL_CALL(glUniformMatrix4fv, uniformUploads, uniformMatrix<16>);
+
+	SHADOW_GL_CALL(glDeleteTextures, deleteTextures);
+	SHADOW_GL_CALL(glDeleteBuffers, deleteBuffers);
+	SHADOW_GL_CALL(glDeleteVertexArrays, deleteVertexArrays);
+	SHADOW_GL_CALL(glDeleteFramebuffers, deleteFramebuffers);
+	SHADOW_GL_CALL(glDeleteProgram, deleteProgram);
+	SHADOW_GL_CALL(glLinkProgram, linkProgram);
+
+	s_installed = true;
+}
+
+bool GlCallCounter::IsInstalled()
+{
+	return s_installed;
+}
+
+const GlCallCounts& GlCallCounter::Get()
+{
+	return s_counts;
+}
+
+void GlCallCounter::Reset()
+{
+	s_counts = {};
+
+#if ENTITIES_GL_INSTRUMENTATION
+	for (GlFunctionCalls& calls : s_functionCalls)
+	{
+		calls.calls = 0;
+		calls.redundant = 0;
+	}
+#endif
+}
+
+void GlCallCounter::EndFrame()
+{
+	s_lastFrameCounts = s_counts;
+#if ENTITIES_GL_INSTRUMENTATION
+	s_lastFrameFunctionCalls = s_functionCalls;
+#endif
+
+	Reset();
+}
+
+const GlCallCounts& GlCallCounter::GetLastFrame()
+{
+	return s_lastFrameCounts;
+}
+
+#if ENTITIES_GL_INSTRUMENTATION
+std::span<const GlFunctionCalls> GlCallCounter::GetFunctionCalls()
+{
+	return s_functionCalls;
+}
+
+std::span<const GlFunctionCalls> GlCallCounter::GetLastFrameFunctionCalls()
+{
+	return s_lastFrameFunctionCalls;
+}
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <span>
+
+// Per function counts and redundant call detection shadow the GL state on every call, which is
+// too slow to ship. On by default in debug builds, define as 0 or 1 to override.
+#ifndef ENTITIES_GL_INSTRUMENTATION
+#ifdef NDEBUG
+#define ENTITIES_GL_INSTRUMENTATION 0
+#else
+#define ENTITIES_GL_INSTRUMENTATION 1
+#endif
+#endif
+
+// GL calls made since the last Reset
+struct GlCallCounts
+{
+	// Draws of any kind, an indirect multi draw counts once
+	unsigned long long drawCalls = 0;
+	unsigned long long dispatches = 0;
+	// Program, vertex array, texture, buffer and framebuffer binds and fixed function state
+	unsigned long long stateChanges = 0;
+	unsigned long long uniformUploads = 0;
+
+	// Only counted with ENTITIES_GL_INSTRUMENTATION, see GlFunctionCalls::redundant
+	unsigned long long redundantStateChanges = 0;
+	unsigned long long redundantUniformUploads = 0;
+};
+
+#if ENTITIES_GL_INSTRUMENTATION
+// Calls of a single GL function since the last Reset
+struct GlFunctionCalls
+{
+	const char* name;
+	unsigned long long calls = 0;
+	// Calls that bound what was already bound, set state to its current value or wrote a
+	// uniform with the value it already had
+	unsigned long long redundant = 0;
+};
+#endif
+
+// Counts GL calls by swapping the glad function pointers for wrappers that count and
+// forward. Install once after the GL functions are loaded, it only costs an increment per call.
+// Calls made through another loader, like the ImGui backend's, are not seen.
+class GlCallCounter
+{
+public:
+	static void Install();
+	[[nodiscard]] static bool IsInstalled();
+
+	[[nodiscard]] static const GlCallCounts& Get();
+	static void Reset();
+
+	// Keeps the counts so far as the last frame's and resets
+	static void EndFrame();
+	[[nodiscard]] static const GlCallCounts& GetLastFrame();
+
+#if ENTITIES_GL_INSTRUMENTATION
+	// In the order the functions were hooked, including the ones never called
+	[[nodiscard]] static std::span<const GlFunctionCalls> GetFunctionCalls();
+	[[nodiscard]] static std::span<const GlFunctionCalls> GetLastFrameFunctionCalls();
+#endif
+};
@@ -0,0 +1,157 @@
+#include <iostream>
+#include <utility>
+
+#include <glad/glad.h>
+
+#ifdef ENTITIES_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+#include "headlesscontext.h"
+
+HeadlessContext::~HeadlessContext()
+{
+	Release();
+}
+
+HeadlessContext::HeadlessContext(HeadlessContext&& other) noexcept :
+	m_display(std::exchange(other.m_display, nullptr)),
+	m_context(std::exchange(other.m_context, nullptr)),
+	m_window(std::exchange(other.m_window, nullptr))
+{
+}
+
+HeadlessContext& HeadlessContext::operator=(HeadlessContext&& other) noexcept
+{
+	if (this != &other)
+	{
+		Release();
+		m_display = std::exchange(other.m_display, nullptr);
+		m_context = std::exchange(other.m_context, nullptr);
+		m_window = std::exchange(other.m_window, nullptr);
+	}
+
+	return *this;
+}
+
+#ifdef ENTITIES_EGL
+
+HeadlessContext HeadlessContext::Create()
+{
+	HeadlessContext result;
+
+	// The surfaceless platform needs no display server, fall back to the default one elsewhere
+	EGLDisplay display = EGL_NO_DISPLAY;
+	const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (getPlatformDisplay)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+	{
+		std::cout << "Failed initializing EGL\n";
+		return result;
+	}
+	result.m_display = display;
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "EGL does not support desktop OpenGL\n";
+		return result;
+	}
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 6,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	// No config needed as nothing is ever drawn to an EGL surface (EGL_KHR_no_config_context)
+	const EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT)
+	{
+		std::cout << "Failed creating an OpenGL 4.6 core EGL context\n";
+		return result;
+	}
+
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cout << "Failed making the EGL context current\n";
+		eglDestroyContext(display, context);
+		return result;
+	}
+
+	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+	{
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, context);
+		return result;
+	}
+
+	result.m_context = context;
+	return result;
+}
+
+void HeadlessContext::Release()
+{
+	if (m_context)
+	{
+		eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(m_display, m_context);
+	}
+	if (m_display)
+		eglTerminate(m_display);
+
+	m_context = nullptr;
+	m_display = nullptr;
+}
+
+#else
+
+HeadlessContext HeadlessContext::Create()
+{
+	HeadlessContext result;
+
+	if (!glfwInit())
+		return result;
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(1, 1, "Headless", nullptr, nullptr);
+	if (!window)
+	{
+		std::cout << "Failed creating a hidden window\n";
+		glfwTerminate();
+		return result;
+	}
+	result.m_window = window;
+
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+		return result;
+
+	result.m_context = window;
+	return result;
+}
+
+void HeadlessContext::Release()
+{
+	if (m_window)
+	{
+		glfwDestroyWindow(m_window);
+		glfwTerminate();
+	}
+
+	m_window = nullptr;
+	m_context = nullptr;
+}
+
+#endif
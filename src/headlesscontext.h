@@ -0,0 +1,29 @@
+#pragma once
+
+struct GLFWwindow;
+
+// OpenGL 4.6 core context without anything on screen, for benchmark runs on build machines.
+// Built with ENTITIES_EGL it is a surfaceless EGL context, which Mesa can create without a
+// display server or a GPU (llvmpipe), otherwise it belongs to a hidden GLFW window.
+// Rendering has to go to a framebuffer object, the default framebuffer may not exist.
+class HeadlessContext
+{
+public:
+	HeadlessContext() = default;
+	~HeadlessContext();
+
+	HeadlessContext(HeadlessContext&& other) noexcept;
+	HeadlessContext& operator= (HeadlessContext&& other) noexcept;
+
+	// Makes the context current and loads the GL functions, check IsValid for failure
+	static HeadlessContext Create();
+
+	[[nodiscard]] bool IsValid() const { return m_context != nullptr; }
+
+private:
+	void Release();
+
+	void* m_display = nullptr;
+	void* m_context = nullptr;
+	GLFWwindow* m_window = nullptr;
+};
@@ -0,0 +1,173 @@
+#include <algorithm>
+
+#include <glad/glad.h>
+
+#include "lightclusters.h"
+
+namespace
+{
+	// Match the local size and bindings of lightClusters.glsl and fragmentShader.glsl
+	constexpr unsigned int clusterGroupSize = 64;
+	constexpr unsigned int pointLightsBinding = 3;
+	constexpr unsigned int spotLightsBinding = 4;
+	constexpr unsigned int boundsBinding = 5;
+	constexpr unsigned int gridBinding = 6;
+	constexpr unsigned int indicesBinding = 7;
+
+	static_assert(LightClusters::ClustersCount % clusterGroupSize == 0);
+
+	// std430 layouts of PointLight and SpotLight in fragmentShader.glsl
+	struct GpuPointLight
+	{
+		glm::vec3 position;
+		float range;
+		glm::vec3 diffuse;
+		float constant;
+		glm::vec3 specular;
+		float linear;
+		float quadratic;
+		float cutoffAttenuation;
+		float padding[2] = {};
+	};
+	static_assert(sizeof(GpuPointLight) == 64);
+
+	struct GpuSpotLight
+	{
+		glm::vec3 position;
+		float range;
+		glm::vec3 direction;
+		float constant;
+		glm::vec3 diffuse;
+		float linear;
+		glm::vec3 specular;
+		float quadratic;
+		float innerCutoff;
+		float outerCutoff;
+		float cutoffAttenuation;
+		float padding = 0.0f;
+	};
+	static_assert(sizeof(GpuSpotLight) == 80);
+
+	template<typename T>
+	void upload(unsigned int buffer, size_t& capacity, const std::vector<T>& data)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		if (capacity == 0 || data.size() > capacity)
+		{
+			capacity = std::max({ data.size(), capacity * 2, size_t(1) });
+			glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(T), nullptr, GL_STREAM_DRAW);
+		}
+
+		if (!data.empty())
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, data.size() * sizeof(T), data.data());
+	}
+}
+
+LightClusters::~LightClusters()
+{
+	const unsigned int buffers[] = { m_pointLightBuffer, m_spotLightBuffer, m_boundsBuffer, m_gridBuffer, m_indexBuffer };
+	glDeleteBuffers(5, buffers);
+}
+
+void LightClusters::Update(const Camera& camera, int width, int height,
+	const std::vector<PointLight>& pointLights,
+	const std::vector<SpotLight>& spotLights)
+{
+	m_screenSize = glm::vec2(std::max(width, 1), std::max(height, 1));
+
+	if (m_pointLightBuffer == 0)
+	{
+		glGenBuffers(1, &m_pointLightBuffer);
+		glGenBuffers(1, &m_spotLightBuffer);
+		glGenBuffers(1, &m_boundsBuffer);
+		glGenBuffers(1, &m_gridBuffer);
+		glGenBuffers(1, &m_indexBuffer);
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_gridBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, ClustersCount * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_indexBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, ClustersCount * MaxLightsPerCluster * sizeof(unsigned int), nullptr, GL_DYNAMIC_COPY);
+	}
+
+	// Lights are shaded in world space and binned in view space
+	const glm::mat4 view = camera.GetMatrix();
+	std::vector<GpuPointLight> gpuPointLights;
+	std::vector<GpuSpotLight> gpuSpotLights;
+	std::vector<glm::vec4> bounds;
+	gpuPointLights.reserve(pointLights.size());
+	gpuSpotLights.reserve(spotLights.size());
+	bounds.reserve(pointLights.size() + spotLights.size());
+
+	for (const PointLight& light : pointLights)
+	{
+		const LightRange range = GetLightRange(light, m_intensityCutoff);
+		gpuPointLights.push_back({
+			.position = light.position,
+			.range = range.range,
+			.diffuse = light.diffuse,
+			.constant = light.constant,
+			.specular = light.specular,
+			.linear = light.linear,
+			.quadratic = light.quadratic,
+			.cutoffAttenuation = range.cutoffAttenuation,
+		});
+		bounds.push_back(glm::vec4(glm::vec3(view * glm::vec4(light.position, 1.0f)), range.range));
+	}
+
+	for (const SpotLight& light : spotLights)
+	{
+		const LightRange range = GetLightRange(light, m_intensityCutoff);
+		gpuSpotLights.push_back({
+			.position = light.position,
+			.range = range.range,
+			.direction = light.direction,
+			.constant = light.constant,
+			.diffuse = light.diffuse,
+			.linear = light.linear,
+			.specular = light.specular,
+			.quadratic = light.quadratic,
+			.innerCutoff = light.innerCutoff,
+			.outerCutoff = light.outerCutoff,
+			.cutoffAttenuation = range.cutoffAttenuation,
+		});
+		const BoundingSphere cone = GetSpotLightBounds(light, range.range);
+		bounds.push_back(glm::vec4(glm::vec3(view * glm::vec4(cone.center, 1.0f)), cone.radius));
+	}
+
+	upload(m_pointLightBuffer, m_pointCapacity, gpuPointLights);
+	upload(m_spotLightBuffer, m_spotCapacity, gpuSpotLights);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, pointLightsBinding, m_pointLightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, spotLightsBinding, m_spotLightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, gridBinding, m_gridBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, indicesBinding, m_indexBuffer);
+
+	if (!m_enabled || !m_clusterShader || m_clusterShader->GetId() == 0)
+		return;
+
+	upload(m_boundsBuffer, m_boundsCapacity, bounds);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, boundsBinding, m_boundsBuffer);
+
+	const glm::mat4 projection = camera.GetProjectionMatrix();
+	m_clusterShader->Use();
+	m_clusterShader->SetUint("pointLightsCount", static_cast<unsigned int>(pointLights.size()));
+	m_clusterShader->SetUint("spotLightsCount", static_cast<unsigned int>(spotLights.size()));
+	m_clusterShader->SetVector2("projectionScale", glm::vec2(projection[0][0], projection[1][1]));
+	m_clusterShader->SetFloat("nearPlane", Camera::GetNearPlane());
+	m_clusterShader->SetFloat("farPlane", Camera::GetFarPlane());
+
+	glDispatchCompute(ClustersCount / clusterGroupSize, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void LightClusters::Apply(ShaderProgram& shader) const
+{
+	shader.Use();
+	shader.SetInt("clusteredLights", m_enabled && m_clusterShader && m_clusterShader->GetId() != 0);
+	shader.SetInt("showLightClusters", m_showHeatmap);
+	shader.SetVector2("clusterScreenSize", m_screenSize);
+	shader.SetFloat("nearPlane", Camera::GetNearPlane());
+	shader.SetFloat("farPlane", Camera::GetFarPlane());
+}
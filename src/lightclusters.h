@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "lightrange.h"
+#include "shaderprogram.h"
+#include "pointlight.h"
+#include "spotlight.h"
+
+// Clustered forward shading. The view frustum is split into froxels, screen tiles sliced
+// exponentially in depth, and a compute pass lists the point and spot lights whose range reaches
+// into each of them. The fragment shader only loops over the lights of the cluster it falls in,
+// so the cost of a pixel depends on the lights around it rather than on every light in the scene.
+// Suns light everything and stay uniforms of the material.
+class LightClusters
+{
+public:
+	// Match lightClusters.glsl and fragmentShader.glsl
+	static constexpr glm::uvec3 GridSize{ 16, 9, 24 };
+	static constexpr unsigned int ClustersCount = GridSize.x * GridSize.y * GridSize.z;
+	// Lights past this in a cluster are left out of it
+	static constexpr unsigned int MaxLightsPerCluster = 128;
+
+	explicit LightClusters(ShaderProgram* clusterShader) : m_clusterShader(clusterShader) {}
+	~LightClusters();
+
+	LightClusters(const LightClusters&) = delete;
+	LightClusters& operator=(const LightClusters&) = delete;
+
+	// Uploads the lights, bins them into the clusters of the camera's frustum when enabled and binds
+	// the buffers read by fragmentShader.glsl. Call once a frame before drawing, width and height
+	// are the size of the framebuffer drawn to.
+	void Update(const Camera& camera, int width, int height,
+		const std::vector<PointLight>& pointLights,
+		const std::vector<SpotLight>& spotLights);
+
+	// Sets the cluster uniforms of a program built from fragmentShader.glsl
+	void Apply(ShaderProgram& shader) const;
+
+	// Without clustering every fragment loops over every light
+	void SetEnabled(bool enabled) { m_enabled = enabled; }
+	[[nodiscard]] bool GetEnabled() const { return m_enabled; }
+
+	// Attenuated intensity at which the lights' ranges end, see GetLightRange. Lower cutoffs light
+	// further at the cost of more lights per cluster.
+	void SetIntensityCutoff(float intensityCutoff) { m_intensityCutoff = intensityCutoff; }
+	[[nodiscard]] float GetIntensityCutoff() const { return m_intensityCutoff; }
+
+	// Tints the image by the number of lights in each cluster
+	void SetShowHeatmap(bool showHeatmap) { m_showHeatmap = showHeatmap; }
+	[[nodiscard]] bool GetShowHeatmap() const { return m_showHeatmap; }
+
+private:
+	ShaderProgram* m_clusterShader;
+	bool m_enabled = true;
+	bool m_showHeatmap = false;
+	float m_intensityCutoff = DefaultLightIntensityCutoff;
+	glm::vec2 m_screenSize = glm::vec2(1.0f);
+
+	unsigned int m_pointLightBuffer = 0;
+	unsigned int m_spotLightBuffer = 0;
+	unsigned int m_boundsBuffer = 0;
+	unsigned int m_gridBuffer = 0;
+	unsigned int m_indexBuffer = 0;
+	size_t m_pointCapacity = 0;
+	size_t m_spotCapacity = 0;
+	size_t m_boundsCapacity = 0;
+};
@@ -0,0 +1,79 @@
+#include <algorithm>
+
+#include "lightrange.h"
+
+namespace
+{
+	// Range of lights that don't fade with distance, still small enough to square in a float
+	constexpr float unboundedRange = 1e18f;
+
+	LightRange getRange(glm::vec3 diffuse, glm::vec3 specular, float constant, float linear, float quadratic, float intensityCutoff)
+	{
+		const glm::vec3 brightest = glm::max(diffuse, specular);
+		const float intensity = std::max({ brightest.x, brightest.y, brightest.z });
+		if (intensity <= 0.0f || intensityCutoff <= 0.0f)
+			return { intensity <= 0.0f ? 0.0f : unboundedRange, 0.0f };
+
+		// Solve intensity / (constant + linear * d + quadratic * d * d) = cutoff
+		const float cutoffAttenuation = intensityCutoff / intensity;
+		const float c = constant - 1.0f / cutoffAttenuation;
+		if (c >= 0.0f)
+			return { 0.0f, cutoffAttenuation };
+		if (quadratic > 0.0f)
+			return { (-linear + glm::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic), cutoffAttenuation };
+		if (linear > 0.0f)
+			return { -c / linear, cutoffAttenuation };
+
+		return { unboundedRange, 0.0f };
+	}
+}
+
+LightRange GetLightRange(const PointLight& light, float intensityCutoff)
+{
+	return getRange(light.diffuse, light.specular, light.constant, light.linear, light.quadratic, intensityCutoff);
+}
+
+LightRange GetLightRange(const SpotLight& light, float intensityCutoff)
+{
+	return getRange(light.diffuse, light.specular, light.constant, light.linear, light.quadratic, intensityCutoff);
+}
+
+BoundingSphere GetSpotLightBounds(const SpotLight& light, float range)
+{
+	if (light.outerCutoff <= 0.0f || glm::dot(light.direction, light.direction) == 0.0f)
+		return { light.position, range };
+
+	const glm::vec3 direction = glm::normalize(light.direction);
+	if (light.outerCutoff < glm::sqrt(0.5f))
+	{
+		// Past 45 degrees the sphere through the rim of the cap holds the apex too
+		const float sine = glm::sqrt(1.0f - light.outerCutoff * light.outerCutoff);
+		return { light.position + direction * range * light.outerCutoff, range * sine };
+	}
+
+	const float radius = range / (2.0f * light.outerCutoff);
+	return { light.position + direction * radius, radius };
+}
+
+bool IntersectsSpotLight(const SpotLight& light, float range, const BoundingSphere& sphere)
+{
+	const glm::vec3 offset = sphere.center - light.position;
+	const float distanceSquared = glm::dot(offset, offset);
+	if (distanceSquared > (range + sphere.radius) * (range + sphere.radius))
+		return false;
+
+	// Wider than a half space, only the range counts
+	if (light.outerCutoff <= 0.0f || glm::dot(light.direction, light.direction) == 0.0f)
+		return true;
+
+	// Distance from the center to the cone's side, negative inside the cone
+	const glm::vec3 direction = glm::normalize(light.direction);
+	const float along = glm::dot(offset, direction);
+	const float across = glm::sqrt(std::max(distanceSquared - along * along, 0.0f));
+	const float sine = glm::sqrt(1.0f - std::min(light.outerCutoff * light.outerCutoff, 1.0f));
+	if (light.outerCutoff * across - sine * along > sphere.radius)
+		return false;
+
+	// In front of the apex and short of the range along the axis
+	return along >= -sphere.radius && along <= range + sphere.radius;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "bounds.h"
+#include "pointlight.h"
+#include "spotlight.h"
+
+// Attenuated intensity at which a light's range ends by default, a step of an 8 bit color channel
+constexpr float DefaultLightIntensityCutoff = 1.0f / 256.0f;
+
+// Distance at which the light's brightest channel attenuates to the intensity cutoff, and the
+// attenuation there. Shaders subtract it so the light fades out at its range instead of being cut off.
+struct LightRange
+{
+	float range;
+	float cutoffAttenuation;
+};
+
+[[nodiscard]] LightRange GetLightRange(const PointLight& light, float intensityCutoff);
+[[nodiscard]] LightRange GetLightRange(const SpotLight& light, float intensityCutoff);
+
+// Smallest sphere around the spot light's cone, capped at its range
+[[nodiscard]] BoundingSphere GetSpotLightBounds(const SpotLight& light, float range);
+
+// Whether the sphere reaches into the spot light's cone capped at its range
+[[nodiscard]] bool IntersectsSpotLight(const SpotLight& light, float range, const BoundingSphere& sphere);
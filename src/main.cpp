@@ -1,7 +1,9 @@
+#include <cctype>
 #include <string>
 #include <vector>
-#include <random>
 #include <chrono>
+#include <algorithm>
+#include <random>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -17,6 +19,16 @@
 #include "material.h"
 #include "texture.h"
 #include "entity.h"
+#include "scatter.h"
+#include "scene.h"
+#include "occlusionculler.h"
+#include "lightclusters.h"
+#include "entitylights.h"
+#include "gbuffer.h"
+#include "shadowcascades.h"
+#include "profiler.h"
+#include "headlesscontext.h"
+#include "glcallcounter.h"
 
 #include "sun.h"
 #include "pointlight.h"
@@ -28,7 +40,8 @@
 
 using namespace std::chrono_literals;
 
-constexpr int maxLights = 10;
+// Suns are uniforms of the material, point and spot lights are only limited by LightClusters::MaxLightsPerCluster
+constexpr int maxSuns = 10;
 
 constexpr int windowWidth = 900;
 constexpr int windowHeight = windowWidth * (9.0f / 16.0f);
@@ -43,25 +56,60 @@ void handleMouseButton(GLFWwindow* window, int button, int action, int mods);
 void handleKey(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 void handleCameraMovement(GLFWwindow* window, float deltaTime);
+void followCameraPath(float time);
+void printHeadlessStats(const Profiler& profiler, const std::vector<float>& cpuFrameTimes, const std::vector<float>& gpuFrameTimes, double seconds);
 
 void initImGui(GLFWwindow* window);
-void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial);
+void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial, Profiler& profiler);
 void endFrameImGui();
 void cleanupImGui();
 bool imGuiMenuOpen = false;
 
 Camera mainCam(75, static_cast<float>(windowWidth) / windowHeight);
-std::vector<Entity> entities;
-
+Scene scene;
+// Lists of the lights reaching each entity, no GPU resources of its own
+EntityLights entityLights;
+
+// Set with --headless [frames]: renders that many frames along a fixed camera path into the
+// offscreen framebuffer, with a fixed timestep and no window, then prints timing stats
+bool headless = false;
+int headlessFrames = 600;
+constexpr float headlessDeltaTime = 1.0f / 60.0f;
+// Frames left out of the stats while caches, queries and the occlusion results settle
+constexpr int headlessWarmupFrames = 10;
+
+int framebufferWidth = windowWidth;
+int framebufferHeight = windowHeight;
 unsigned int framebuffer;
 unsigned int colorTexture;
 unsigned int entityTexture;
-unsigned int depthStencilBufferObject;
-
-int selectedEntity = 0;
+unsigned int depthStencilTexture;
+
+EntityHandle selectedEntity;
+bool gpuInstanceCulling = true;
+bool lodSelection = true;
+bool showDepthPyramid = false;
+int depthPyramidLevel = 0;
+int depthPyramidLevelsCount = 1;
 int selectedSun = 0;
 int selectedPointLight = 0;
 int selectedSpotLight = 0;
+bool showUncalledGlCalls = false;
+bool clusteredLights = true;
+bool showLightClusters = false;
+bool entityLightLists = false;
+float lightIntensityCutoff = DefaultLightIntensityCutoff;
+bool sunShadows = true;
+bool showShadowCascades = false;
+float shadowDistance = 250.0f;
+// Counters of the last shadow pass, see ShadowCascades
+unsigned int shadowCascadesRendered = 0;
+unsigned int shadowDynamicCasters = 0;
+// Set with --deferred or in the debug menu, see GBuffer
+bool deferredShading = false;
+// GPU frame times of both render paths, averaged over the frames drawn with each
+float forwardGpuFrameTime = 0.0f;
+float deferredGpuFrameTime = 0.0f;
 
 std::vector<Sun> suns = {
 	{
@@ -108,44 +156,69 @@ std::vector<SpotLight> spotLights = {
 	}
 };
 
-int main()
+int main(int argc, char** argv)
 {
-	std::random_device rd;
-	std::mt19937 gen(rd());
-
-	if (!glfwInit())
-		return -1;
-
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--headless")
+		{
+			headless = true;
+			if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+				headlessFrames = std::max(std::stoi(argv[++i]), 1);
+		}
+		else if (std::string(argv[i]) == "--deferred")
+			deferredShading = true;
+	}
 
-	GLFWwindow* window = glfwCreateWindow(windowWidth, windowHeight, "Hello again", nullptr, nullptr);
-	if (!window)
+	GLFWwindow* window = nullptr;
+	HeadlessContext headlessContext;
+	if (headless)
 	{
-		glfwTerminate();
-		return -2;
+		headlessContext = HeadlessContext::Create();
+		if (!headlessContext.IsValid())
+			return -3;
 	}
+	else
+	{
+		if (!glfwInit())
+			return -1;
 
-	glfwMakeContextCurrent(window);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
-	{
-		glfwTerminate();
-		return -3;
+		window = glfwCreateWindow(windowWidth, windowHeight, "Hello again", nullptr, nullptr);
+		if (!window)
+		{
+			glfwTerminate();
+			return -2;
+		}
+
+		glfwMakeContextCurrent(window);
+
+		if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+		{
+			glfwTerminate();
+			return -3;
+		}
+
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		if (glfwRawMouseMotionSupported())
+			glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
 	}
 
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-	if (glfwRawMouseMotionSupported())
-		glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+#if ENTITIES_GL_INSTRUMENTATION
+	GlCallCounter::Install();
+#endif
 
 	{
 		std::string vertexShader = readFileAsString("shaders/vertexShader.glsl");
-		std::string fragmentShader = readFileAsString("shaders/fragmentShader.glsl");
+		std::string fragmentShader = readShaderSource("shaders/fragmentShader.glsl");
 		std::string highlightFragmentShader = readFileAsString("shaders/highlightShader.glsl");
 
 		ShaderProgram sp = ShaderProgram::Compile(vertexShader, fragmentShader);
 		ShaderProgram hs = ShaderProgram::Compile(vertexShader, highlightFragmentShader);
+		ShaderProgram cullInstancesShader = ShaderProgram::CompileCompute(readFileAsString("shaders/cullInstances.glsl"));
 		Model model = ObjParser::LoadFromFile("resources/models/cube.obj");
 		const Texture textureColor = Texture::LoadFromFile("resources/textures/container_color.png");
 		const Texture textureSpecular = Texture::LoadFromFile("resources/textures/container_specular.png");
@@ -153,24 +226,21 @@ int main()
 		material.SetDiffuseMap(&textureColor);
 		material.SetSpecularMap(&textureSpecular);
 
-		for (int i = 0; i < 10; i++)
-		{
-			for (int j = 0; j < 10; j++)
-			{
+		Entity cubePrototype(&model, material);
+		cubePrototype.SetScale(glm::vec3(5));
+		scene.SpawnMany(cubePrototype, 10 * 10,
+			[](Entity& e, size_t index) {
+				const int i = static_cast<int>(index / 10);
+				const int j = static_cast<int>(index % 10);
 				float value = static_cast<float>(i + j) / 2.0f;
 
-				Entity e(&model, material);
 				e.SetPosition(glm::vec3(i * 20, 0, j * 20));
-				e.SetScale(glm::vec3(5));
 				e.SetUpdateFunc(
 					[value](Entity* e, float deltaTime) mutable {
 						e->SetRotation(glm::vec3(value * 6.0, value * 8.0f, value * 10.0f));
 						value += 2.0f * deltaTime;
 					});
-
-				entities.push_back(std::move(e));
-			}
-		}
+			});
 
 		const Model groundModel = ObjParser::LoadFromFile("resources/models/ground.obj");
 		const Texture groundTexture = Texture::LoadFromFile("resources/textures/ground_color.jpg");
@@ -182,50 +252,74 @@ int main()
 		Entity groundEntity(&groundModel, groundMaterial);
 		groundEntity.SetPosition(glm::vec3(100, -15, 100));
 		groundEntity.SetScale(glm::vec3(20, 1, 20));
-		entities.push_back(std::move(groundEntity));
+		scene.Add(std::move(groundEntity));
 
 		const Model billboardModel = ObjParser::LoadFromFile("resources/models/grass.obj");
 		const Texture grassTexture = Texture::LoadFromFile("resources/textures/grass.png", false);
 		Material grassMaterial(&sp, &hs);
 		grassMaterial.SetDiffuseMap(&grassTexture);
 		grassMaterial.SetShininess(8);
+		grassMaterial.SetBillboard(true);
+
+		// Patchy meadow over the whole ground, thinning out towards the edges
+		const glm::vec2 groundMin(-75.0f, -75.0f);
+		const glm::vec2 groundMax(275.0f, 275.0f);
+		Scatter grassScatter(&billboardModel, grassMaterial);
+		grassScatter.SetLayers({ glm::vec3(0, 135, 0), glm::vec3(0, 45, 0) });
+		grassScatter.SetFadeDistance(120.0f, 160.0f);
+		grassScatter.SetCullingShader(&cullInstancesShader);
+		grassScatter.SetCastsShadows(false);
+		grassScatter.Generate(groundMin, groundMax, -15.0f, 400000,
+			[](glm::vec2 position) {
+				const float patches = 0.5f + 0.5f * sin(position.x * 0.05f) * cos(position.y * 0.07f);
+				const float edge = glm::clamp(glm::distance(position, glm::vec2(100.0f)) / 175.0f, 0.0f, 1.0f);
+				return patches * (1.0f - edge * edge);
+			},
+			glm::vec2(4.0f, 7.0f), 1);
+
+		const Model treeModel = ObjParser::LoadFromFile("resources/models/tree.obj", { .lodsCount = 3, .quantize = true });
+		Material treeMaterial(&sp, &hs);
+		treeMaterial.SetColor(glm::vec3(0.25f, 0.45f, 0.2f));
+		treeMaterial.SetShininess(4);
+		Scatter treeScatter(&treeModel, treeMaterial);
+		treeScatter.SetRandomYaw(true);
+		treeScatter.SetFadeDistance(350.0f, 400.0f);
+		treeScatter.SetCullingShader(&cullInstancesShader);
+		treeScatter.Generate(groundMin, groundMax, -15.0f, 4000,
+			[](glm::vec2 position) {
+				// Keep the cube grid clear
+				const bool inGrid = position.x > -20.0f && position.x < 200.0f && position.y > -20.0f && position.y < 200.0f;
+				return inGrid ? 0.0f : 0.15f;
+			},
+			glm::vec2(4.0f, 6.0f), 2);
+
+		// High poly row past the cube grid to show off the levels of detail and meshlet culling
+		const Model monkeyModel = ObjParser::LoadFromFile("resources/models/monkey_smooth.obj", { .lodsCount = 4, .meshlets = true, .quantize = true });
+		Material monkeyMaterial(&sp, &hs);
+		monkeyMaterial.SetColor(glm::vec3(0.6f, 0.4f, 0.25f));
+		monkeyMaterial.SetShininess(32);
+		Entity monkeyPrototype(&monkeyModel, monkeyMaterial);
+		monkeyPrototype.SetScale(glm::vec3(4));
+		scene.SpawnMany(monkeyPrototype, 10,
+			[](Entity& e, size_t index) {
+				e.SetPosition(glm::vec3(static_cast<float>(index) * 20.0f, -9.0f, 230.0f));
+				e.SetRotation(glm::vec3(0.0f, 180.0f, 0.0f));
+			});
+
+		scene.SetOcclusionCulling(true);
 
-		std::uniform_real_distribution<float> grassSpawnRange(-50, 250);
-		for (int i = 0; i < 20; i++)
-		{
-			Entity grassEntity1(&billboardModel, grassMaterial);
-			grassEntity1.SetUpdateFunc(
-				[](Entity* entity, float deltaTime) {
-					glm::vec3 dir = mainCam.GetPosition() - entity->GetPosition();
-					dir.y = 0;
-					dir = glm::normalize(dir);
-					float angle = atan2(dir.z, dir.x);
-					entity->SetRotation(glm::vec3(0, 135 - glm::degrees(angle), 0));
-				});
-			grassEntity1.SetPosition(glm::vec3(grassSpawnRange(gen), -15, grassSpawnRange(gen)));
-			grassEntity1.SetScale(glm::vec3(6.0f));
-			Entity grassEntity2(grassEntity1);
-			grassEntity2.SetUpdateFunc(
-				[](Entity* entity, float deltaTime) {
-					glm::vec3 dir = mainCam.GetPosition() - entity->GetPosition();
-					dir.y = 0;
-					dir = glm::normalize(dir);
-					float angle = atan2(dir.z, dir.x);
-					entity->SetRotation(glm::vec3(0, 45 - glm::degrees(angle), 0));
-				});
-
-			entities.push_back(std::move(grassEntity1));
-			entities.push_back(std::move(grassEntity2));
-		}
 		mainCam.SetPosition(glm::vec3(0, 10, 0));
 		mainCam.SetRotation(glm::vec2(-136.0f, 21.0f));
 
 		glViewport(0, 0, windowWidth, windowHeight);
-		glfwSetWindowSizeCallback(window, windowSizeChangeCallback);
-		glfwSetCursorPosCallback(window, mouseCallback);
-		glfwSetKeyCallback(window, handleKey);
-		glfwSetMouseButtonCallback(window, handleMouseButton);
-		initImGui(window);
+		if (!headless)
+		{
+			glfwSetWindowSizeCallback(window, windowSizeChangeCallback);
+			glfwSetCursorPosCallback(window, mouseCallback);
+			glfwSetKeyCallback(window, handleKey);
+			glfwSetMouseButtonCallback(window, handleMouseButton);
+			initImGui(window);
+		}
 
 		glClearColor(160 / 7.0f / 255.0f, 217 / 7.0f / 255.0f, 239 / 7.0f / 255.0f, 1.0f);
 
@@ -239,7 +333,21 @@ int main()
 		std::string screenVertexShader = readFileAsString("shaders/screenVertShader.glsl");
 		std::string screenFragmentShader = readFileAsString("shaders/screenFragShader.glsl");
 		ShaderProgram screenShader = ShaderProgram::Compile(screenVertexShader, screenFragmentShader);
+		ShaderProgram depthPyramidDebugShader = ShaderProgram::Compile(screenVertexShader, readFileAsString("shaders/depthPyramidDebug.glsl"));
+		ShaderProgram buildDepthPyramidShader = ShaderProgram::CompileCompute(readFileAsString("shaders/buildDepthPyramid.glsl"));
+		OcclusionCuller occlusionCuller(&buildDepthPyramidShader, &cullInstancesShader);
+		ShaderProgram lightClustersShader = ShaderProgram::CompileCompute(readFileAsString("shaders/lightClusters.glsl"));
+		LightClusters lightClusters(&lightClustersShader);
+		scene.SetEntityLights(&entityLights);
+		ShaderProgram deferredLightingShader = ShaderProgram::Compile(screenVertexShader, readShaderSource("shaders/deferredLighting.glsl"));
+		GBuffer gBuffer(&deferredLightingShader);
+		ShaderProgram shadowDepthShader = ShaderProgram::Compile(vertexShader, readFileAsString("shaders/shadowDepth.glsl"));
+		ShadowCascades shadowCascades(&shadowDepthShader);
+		bool lastDeferredShading = deferredShading;
+		unsigned int framesOnRenderPath = 0;
+		std::vector<EntityHandle> occludedEntities;
 		Model screenModel = ObjParser::LoadFromFile("resources/models/screen.obj");
+		Profiler profiler;
 
 		glGenFramebuffers(1, &framebuffer);
 		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
@@ -265,12 +373,16 @@ int main()
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, entityTexture, 0);
 
-		glGenRenderbuffers(1, &depthStencilBufferObject);
-		glBindRenderbuffer(GL_RENDERBUFFER, depthStencilBufferObject);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, windowWidth, windowHeight);
-
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencilBufferObject);
+		// A texture rather than a renderbuffer so the depth pyramid can be built from it
+		glGenTextures(1, &depthStencilTexture);
+		glBindTexture(GL_TEXTURE_2D, depthStencilTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, windowWidth, windowHeight, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthStencilTexture, 0);
 
 		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		{
@@ -278,33 +390,153 @@ int main()
 			return -4;
 		}
 
-		double lastTime = glfwGetTime();
-		while (!glfwWindowShouldClose(window))
+		std::vector<float> cpuFrameTimes;
+		std::vector<float> gpuFrameTimes;
+		const auto headlessStart = std::chrono::steady_clock::now();
+
+		double lastTime = headless ? 0.0 : glfwGetTime();
+		for (int frame = 0; headless ? frame < headlessFrames : !glfwWindowShouldClose(window); frame++)
 		{
+#if ENTITIES_GL_INSTRUMENTATION
+			// The debug menu shows the calls of the previous frame, as this one is not done yet
+			GlCallCounter::EndFrame();
+#endif
+			profiler.BeginFrame();
+
+			// GPU times come in FramesInFlight frames late, only average them once they are from the current path
+			framesOnRenderPath = deferredShading == lastDeferredShading ? framesOnRenderPath + 1 : 0;
+			lastDeferredShading = deferredShading;
+			if (framesOnRenderPath > Profiler::FramesInFlight)
+			{
+				float& average = deferredShading ? deferredGpuFrameTime : forwardGpuFrameTime;
+				average = average == 0.0f ? profiler.GetGpuFrameTime() : glm::mix(average, profiler.GetGpuFrameTime(), 0.05f);
+			}
+
 			glEnable(GL_DEPTH_TEST);
 
 			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-			double now = glfwGetTime();
-			double deltaTime = fmin(now - lastTime, 0.3f);
-			lastTime = now;
+			double deltaTime = headlessDeltaTime;
+			if (!headless)
+			{
+				double now = glfwGetTime();
+				deltaTime = fmin(now - lastTime, 0.3f);
+				lastTime = now;
+			}
 
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 			int c = -1;
 			glClearBufferiv(GL_COLOR, 1, &c);
 
-			handleCameraMovement(window, static_cast<float>(deltaTime));
+			{
+				ProfileScope scope(profiler, "Update", false);
+				if (headless)
+					followCameraPath(static_cast<float>(frame) * headlessDeltaTime);
+				else
+					handleCameraMovement(window, static_cast<float>(deltaTime));
+
+				scene.Update(static_cast<float>(deltaTime));
+
+				if (occlusionCuller.FetchOccluded(occludedEntities) && scene.GetOcclusionCulling())
+					scene.SetOccludedEntities(occludedEntities);
+			}
 
-			int id = 0;
-			for (auto& entity : entities)
 			{
-				entity.Update(static_cast<float>(deltaTime));
-				entity.Draw(mainCam, suns, pointLights, spotLights, id);
+				ProfileScope scope(profiler, "Light clusters");
+				lightClusters.SetEnabled(clusteredLights);
+				lightClusters.SetShowHeatmap(showLightClusters);
+				lightClusters.SetIntensityCutoff(lightIntensityCutoff);
+				lightClusters.Update(mainCam, framebufferWidth, framebufferHeight, pointLights, spotLights);
+				lightClusters.Apply(sp);
+			}
 
-				// Clear menu highlight
-				if (imGuiMenuOpen && entity.GetIsHighlighted())
-					entity.SetIsHighlighted(false);
+			{
+				// Deferred lighting happens per pixel after the entities are drawn, it can only use the clusters
+				ProfileScope scope(profiler, "Entity lights", false);
+				entityLights.SetEnabled(entityLightLists && !deferredShading);
+				entityLights.Update(scene, pointLights, spotLights, lightIntensityCutoff);
+			}
 
-				id++;
+			{
+				ProfileScope scope(profiler, "Shadows");
+				shadowCascades.SetEnabled(sunShadows);
+				shadowCascades.SetShowCascades(showShadowCascades);
+				shadowCascades.SetShadowDistance(shadowDistance);
+				shadowCascades.Render(mainCam, suns, scene, { &grassScatter, &treeScatter });
+				shadowCascadesRendered = shadowCascades.GetCachedCascadesRendered();
+				shadowDynamicCasters = shadowCascades.GetDynamicCastersDrawn();
+				shadowCascades.Apply(sp);
+				shadowCascades.Apply(deferredLightingShader);
+				glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+				glViewport(0, 0, framebufferWidth, framebufferHeight);
+			}
+
+			if (deferredShading)
+			{
+				if (gBuffer.GetSize() != glm::ivec2(framebufferWidth, framebufferHeight))
+					gBuffer.Resize(framebufferWidth, framebufferHeight, colorTexture, entityTexture, depthStencilTexture);
+				gBuffer.BeginGeometryPass();
+			}
+			GBuffer::SetGeometryPass(sp, deferredShading);
+
+			{
+				ProfileScope scope(profiler, "Scene draw");
+				scene.SetLodSelection(lodSelection);
+				scene.Draw(mainCam, suns, pointLights, spotLights);
+			}
+
+			const OcclusionCuller* scatterOcclusion = scene.GetOcclusionCulling() ? &occlusionCuller : nullptr;
+			grassScatter.SetGpuCulling(gpuInstanceCulling);
+			grassScatter.SetOcclusionCuller(scatterOcclusion);
+			treeScatter.SetGpuCulling(gpuInstanceCulling);
+			treeScatter.SetOcclusionCuller(scatterOcclusion);
+			grassScatter.SetLodSelection(lodSelection);
+			treeScatter.SetLodSelection(lodSelection);
+			{
+				ProfileScope scope(profiler, "Scatter draw");
+				grassScatter.Draw(mainCam, suns, pointLights, spotLights);
+				treeScatter.Draw(mainCam, suns, pointLights, spotLights);
+			}
+
+			if (deferredShading)
+			{
+				ProfileScope scope(profiler, "Deferred lighting");
+				gBuffer.Light(mainCam, lightClusters, suns, pointLights.size(), spotLights.size(), screenModel);
+				glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			}
+
+			{
+				ProfileScope scope(profiler, "Occlusion");
+				if (scene.GetOcclusionCulling() || showDepthPyramid)
+				{
+					occlusionCuller.BuildPyramid(depthStencilTexture, framebufferWidth, framebufferHeight, mainCam.GetProjectionMatrix() * mainCam.GetMatrix());
+					depthPyramidLevelsCount = occlusionCuller.GetLevelsCount();
+				}
+
+				if (scene.GetOcclusionCulling())
+					occlusionCuller.Test(scene.GetOcclusionCandidates(), scene.GetOcclusionCandidateSpheres());
+			}
+
+			scene.DrawHighlights(mainCam);
+
+			// Clear menu highlight
+			if (Entity* selected = scene.Get(selectedEntity); imGuiMenuOpen && selected)
+				selected->SetIsHighlighted(false);
+
+			if (headless)
+			{
+				// Waiting for the GPU stands in for the swap, so every frame is measured in full
+				{
+					ProfileScope scope(profiler, "Finish", false);
+					glFinish();
+				}
+
+				profiler.EndFrame();
+				if (frame >= headlessWarmupFrames)
+				{
+					cpuFrameTimes.push_back(profiler.GetCpuFrameTime());
+					gpuFrameTimes.push_back(profiler.GetGpuFrameTime());
+				}
+				continue;
 			}
 
 			glfwPollEvents();
@@ -312,21 +544,53 @@ int main()
 			glBindFramebuffer(GL_FRAMEBUFFER, 0);
 			glDisable(GL_DEPTH_TEST);
 
-			beginFrameImGui(model, material);
+			{
+				ProfileScope scope(profiler, "ImGui");
+				beginFrameImGui(model, material, profiler);
+			}
 
-			glActiveTexture(GL_TEXTURE0);
-			GLint originalTexture;
-			glGetIntegerv(GL_TEXTURE_BINDING_2D, &originalTexture);
-			glBindTexture(GL_TEXTURE_2D, colorTexture);
-			screenShader.Use();
-			screenModel.Draw();
-			glBindTexture(GL_TEXTURE_2D, originalTexture);
+			{
+				ProfileScope scope(profiler, "Post");
+				glActiveTexture(GL_TEXTURE0);
+				GLint originalTexture;
+				glGetIntegerv(GL_TEXTURE_BINDING_2D, &originalTexture);
+				if (showDepthPyramid && occlusionCuller.HasPyramid())
+				{
+					glBindTexture(GL_TEXTURE_2D, occlusionCuller.GetPyramidTexture());
+					depthPyramidDebugShader.Use();
+					depthPyramidDebugShader.SetInt("level", std::min(depthPyramidLevel, depthPyramidLevelsCount - 1));
+					depthPyramidDebugShader.SetFloat("nearPlane", Camera::GetNearPlane());
+					depthPyramidDebugShader.SetFloat("farPlane", Camera::GetFarPlane());
+				}
+				else
+				{
+					glBindTexture(GL_TEXTURE_2D, colorTexture);
+					screenShader.Use();
+				}
+				screenModel.Draw();
+				glBindTexture(GL_TEXTURE_2D, originalTexture);
+			}
 
-			endFrameImGui();
+			{
+				ProfileScope scope(profiler, "ImGui");
+				endFrameImGui();
+			}
 
-			glfwSwapBuffers(window);
+			{
+				ProfileScope scope(profiler, "Swap", false);
+				glfwSwapBuffers(window);
+			}
 
 			glClear(GL_COLOR_BUFFER_BIT);
+
+			profiler.EndFrame();
+		}
+
+		if (headless)
+		{
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - headlessStart).count();
+			printHeadlessStats(profiler, cpuFrameTimes, gpuFrameTimes, seconds);
+			return 0;
 		}
 	}
 
@@ -351,10 +615,11 @@ void handleMouseButton(GLFWwindow* window, int button, int action, int mods)
 		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 		glReadBuffer(GL_COLOR_ATTACHMENT1);
 		glReadPixels(x, h - y, 1, 1, GL_RED_INTEGER, GL_INT, &value);
-		if (value < 0)
+		const EntityHandle picked = EntityHandle::FromId(value);
+		if (!scene.IsValid(picked))
 			return;
 
-		selectedEntity = fmin(value, entities.size() - 1);
+		selectedEntity = picked;
 	}
 }
 
@@ -404,6 +669,42 @@ void handleCameraMovement(GLFWwindow* window, float deltaTime)
 	mainCam.SetPosition(position);
 }
 
+// Slow orbit around the cube grid, high enough to see the grass, trees and monkeys
+void followCameraPath(float time)
+{
+	constexpr glm::vec3 center(100.0f, -10.0f, 120.0f);
+	constexpr float radius = 170.0f;
+	constexpr float height = 30.0f;
+	constexpr float secondsPerTurn = 20.0f;
+
+	const float angle = time / secondsPerTurn * glm::two_pi<float>();
+	mainCam.SetPosition(center + glm::vec3(glm::cos(angle) * radius, height, glm::sin(angle) * radius));
+	mainCam.LookAt(center);
+}
+
+void printHeadlessStats(const Profiler& profiler, const std::vector<float>& cpuFrameTimes, const std::vector<float>& gpuFrameTimes, double seconds)
+{
+	const auto printSummary = [](const char* name, const FrameTimeSummary& summary) {
+		std::cout << "  " << name << " frame ms: mean " << summary.mean << ", min " << summary.min << ", p50 " << summary.p50
+			<< ", p95 " << summary.p95 << ", p99 " << summary.p99 << ", max " << summary.max << '\n';
+	};
+
+	std::cout << "Headless run: " << headlessFrames << " frames at " << framebufferWidth << 'x' << framebufferHeight
+		<< (deferredShading ? " deferred" : " forward") << " in " << seconds << "s (" << headlessFrames / seconds << " fps)\n";
+	std::cout << "  Measured frames: " << cpuFrameTimes.size() << " after " << headlessWarmupFrames << " warmup frames\n";
+	printSummary("CPU", SummarizeFrameTimes(cpuFrameTimes));
+	printSummary("GPU", SummarizeFrameTimes(gpuFrameTimes));
+
+	std::cout << "  Scope averages (CPU ms / GPU ms):\n";
+	for (const ProfilerScope& scope : profiler.GetScopes())
+	{
+		std::cout << "    " << std::string(scope.depth * 2, ' ') << scope.name << ": " << scope.cpuAverageMs;
+		if (scope.hasGpu)
+			std::cout << " / " << scope.gpuAverageMs;
+		std::cout << '\n';
+	}
+}
+
 void windowSizeChangeCallback(GLFWwindow* window, int newWidth, int newHeight)
 {
 	if (newWidth == 0 || newHeight == 0) // ignore minimizing
@@ -411,6 +712,8 @@ void windowSizeChangeCallback(GLFWwindow* window, int newWidth, int newHeight)
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	glViewport(0, 0, newWidth, newHeight);
+	framebufferWidth = newWidth;
+	framebufferHeight = newHeight;
 	mainCam.SetAspectRatio(static_cast<float>(newWidth) / static_cast<float>(newHeight));
 
 	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
@@ -419,8 +722,8 @@ void windowSizeChangeCallback(GLFWwindow* window, int newWidth, int newHeight)
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, newWidth, newHeight, 0, GL_RED_INTEGER, GL_INT, nullptr);
 	glBindTexture(GL_TEXTURE_2D, colorTexture);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, newWidth, newHeight, 0, GL_RGB, GL_INT, nullptr);
-	glBindRenderbuffer(GL_RENDERBUFFER, depthStencilBufferObject);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, newWidth, newHeight);
+	glBindTexture(GL_TEXTURE_2D, depthStencilTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, newWidth, newHeight, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
 }
 
 double lastX = -1;
@@ -455,7 +758,7 @@ void initImGui(GLFWwindow* window)
 	ImGui_ImplOpenGL3_Init();
 }
 
-void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial)
+void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial, Profiler& profiler)
 {
 	if (!imGuiMenuOpen)
 		return;
@@ -468,10 +771,12 @@ void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial)
 
 	if (ImGui::TreeNode("Entities"))
 	{
-		if (entities.size() > 0)
+		if (scene.Size() > 0)
 		{
-			ImGui::SliderInt("Selected##entity", &selectedEntity, 0, entities.size() - 1);
-			Entity& entity = entities[selectedEntity];
+			int selectedIndex = std::max(scene.IndexOf(selectedEntity), 0);
+			ImGui::SliderInt("Selected##entity", &selectedIndex, 0, scene.Size() - 1);
+			selectedEntity = scene.GetHandle(selectedIndex);
+			Entity& entity = *scene.Get(selectedEntity);
 
 			ImGui::Spacing();
 
@@ -488,6 +793,10 @@ void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial)
 			entity.SetScale(entityScale);
 			entity.SetShouldUpdate(entityShouldUpdate);
 
+			int parentIndex = scene.IndexOf(scene.GetParent(selectedEntity));
+			if (ImGui::SliderInt("Parent##entity", &parentIndex, -1, scene.Size() - 1))
+				scene.SetParent(selectedEntity, parentIndex < 0 ? EntityHandle{} : scene.GetHandle(parentIndex));
+
 			if (ImGui::Button("Move to camera##entity"))
 			{
 				entity.SetPosition(mainCam.GetPosition());
@@ -505,23 +814,150 @@ void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial)
 					value += 2.0f * deltaTime;
 				});
 
-			entities.push_back(std::move(e));
-
-			selectedEntity = entities.size() - 1;
+			selectedEntity = scene.Add(std::move(e));
 		}
 		ImGui::SameLine();
-		if (entities.size() > 0 && ImGui::Button("Delete##entity"))
+		if (scene.Size() > 0 && ImGui::Button("Delete##entity"))
+		{
+			const int selectedIndex = scene.IndexOf(selectedEntity);
+			scene.Remove(selectedEntity);
+			selectedEntity = scene.GetHandle(std::min<size_t>(selectedIndex, scene.Size() - 1));
+		}
+		ImGui::TreePop();
+		ImGui::Spacing();
+	}
+
+	if (Entity* selected = scene.Get(selectedEntity))
+		selected->SetIsHighlighted(true);
+
+	if (ImGui::TreeNode("Culling"))
+	{
+		bool frustumCulling = scene.GetFrustumCulling();
+		if (ImGui::Checkbox("Frustum culling##culling", &frustumCulling))
+			scene.SetFrustumCulling(frustumCulling);
+
+		ImGui::Checkbox("GPU instance culling##culling", &gpuInstanceCulling);
+
+		Scene::CullingMethod cullingMethod = scene.GetCullingMethod();
+		if (ImGui::RadioButton("BVH##culling", cullingMethod == Scene::CullingMethod::Bvh))
+			scene.SetCullingMethod(Scene::CullingMethod::Bvh);
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Spheres##culling", cullingMethod == Scene::CullingMethod::Spheres))
+			scene.SetCullingMethod(Scene::CullingMethod::Spheres);
+
+		SphereCuller& culler = scene.GetCuller();
+		ImGui::Text("Sphere kernel:");
+		for (const SphereCuller::Kernel kernel : { SphereCuller::Kernel::Scalar, SphereCuller::Kernel::Sse, SphereCuller::Kernel::Avx2 })
 		{
-			entities.erase(entities.begin() + selectedEntity);
-			if (selectedEntity == entities.size())
-				selectedEntity--;
+			if (!SphereCuller::IsKernelSupported(kernel))
+				continue;
+
+			ImGui::SameLine();
+			if (ImGui::RadioButton(SphereCuller::GetKernelName(kernel), culler.GetKernel() == kernel))
+				culler.SetKernel(kernel);
 		}
+
+		const SceneStats& stats = scene.GetStats();
+		ImGui::Text("Drawn entities: %u", stats.drawnEntities);
+		ImGui::Text("Culled entities: %u", stats.culledEntities);
+		ImGui::Text("Drawn entity triangles: %llu", stats.drawnTriangles);
+		ImGui::Checkbox("Levels of detail##culling", &lodSelection);
+
+		bool meshletCulling = scene.GetMeshletCulling();
+		if (ImGui::Checkbox("Meshlet culling##culling", &meshletCulling))
+			scene.SetMeshletCulling(meshletCulling);
+		ImGui::Text("Drawn meshlets: %u", stats.drawnMeshlets);
+		ImGui::Text("Culled meshlets: %u", stats.culledMeshlets);
+
+		ImGui::Text("Occluded entities: %u", stats.occludedEntities);
+		ImGui::Text("Occlusion candidates: %zu", scene.GetOcclusionCandidates().size());
+
+		bool occlusionCulling = scene.GetOcclusionCulling();
+		if (ImGui::Checkbox("Occlusion culling##culling", &occlusionCulling))
+			scene.SetOcclusionCulling(occlusionCulling);
+		ImGui::Checkbox("Show depth pyramid##culling", &showDepthPyramid);
+		ImGui::SliderInt("Pyramid level##culling", &depthPyramidLevel, 0, depthPyramidLevelsCount - 1);
+
+		const Bvh& bvh = scene.GetBvh();
+		ImGui::Text("BVH nodes: %zu", bvh.GetNodesCount());
+		ImGui::Text("BVH cost: %.2f", bvh.GetCost());
+		ImGui::Text("BVH rebuilds: %u", bvh.GetRebuildsCount());
+
+		const SceneRayHit hit = scene.Raycast(mainCam.GetPosition(), mainCam.Forward(), 1000.0f);
+		if (hit.entity.IsNull())
+			ImGui::Text("Looking at: nothing");
+		else
+			ImGui::Text("Looking at: entity %d (%.1f)", scene.IndexOf(hit.entity), hit.distance);
+
 		ImGui::TreePop();
 		ImGui::Spacing();
 	}
 
-	if (selectedEntity >= 0)
-		entities[selectedEntity].SetIsHighlighted(true);
+	if (ImGui::TreeNode("Rendering"))
+	{
+		if (ImGui::RadioButton("Forward##rendering", !deferredShading))
+			deferredShading = false;
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Deferred##rendering", deferredShading))
+			deferredShading = true;
+
+		ImGui::Text("Forward GPU frame: %.2f ms", forwardGpuFrameTime);
+		ImGui::Text("Deferred GPU frame: %.2f ms", deferredGpuFrameTime);
+
+		ImGui::TreePop();
+		ImGui::Spacing();
+	}
+
+	if (ImGui::TreeNode("Light clusters"))
+	{
+		ImGui::Checkbox("Clustered lights##clusters", &clusteredLights);
+		ImGui::Checkbox("Per entity light lists##clusters", &entityLightLists);
+		ImGui::Checkbox("Show lights per cluster##clusters", &showLightClusters);
+		ImGui::SliderFloat("Intensity cutoff##clusters", &lightIntensityCutoff, 1.0f / 4096.0f, 1.0f / 16.0f, "%.5f", ImGuiSliderFlags_Logarithmic);
+		ImGui::Text("Clusters: %ux%ux%u", LightClusters::GridSize.x, LightClusters::GridSize.y, LightClusters::GridSize.z);
+		ImGui::Text("Point lights: %zu", pointLights.size());
+		ImGui::Text("Spot lights: %zu", spotLights.size());
+		if (entityLightLists)
+		{
+			const size_t litEntities = entityLights.GetLitEntitiesCount();
+			ImGui::Text("Lights per lit entity: %.1f (%zu entities)",
+				litEntities > 0 ? static_cast<float>(entityLights.GetListedLightsCount()) / static_cast<float>(litEntities) : 0.0f, litEntities);
+			ImGui::Text("Too many lights, clustered instead: %zu", entityLights.GetFallbackEntitiesCount());
+		}
+
+		if (ImGui::Button("Add 100 point lights##clusters"))
+		{
+			// Short ranged lights of random colors scattered on the ground around the camera
+			static std::mt19937 gen;
+			std::uniform_real_distribution<float> offset(-100.0f, 100.0f);
+			std::uniform_real_distribution<float> channel(0.0f, 1.0f);
+			const glm::vec3 center = mainCam.GetPosition();
+			for (int i = 0; i < 100; i++)
+			{
+				const glm::vec3 color(channel(gen), channel(gen), channel(gen));
+				pointLights.emplace_back(PointLight
+					{
+						.position = glm::vec3(center.x + offset(gen), -13.0f, center.z + offset(gen)),
+						.diffuse = color * 4.0f,
+						.specular = color * 4.0f,
+						.constant = 1.0f,
+						.linear = 0.7f,
+						.quadratic = 1.8f,
+					});
+			}
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Clear##clusters"))
+		{
+			pointLights.clear();
+			spotLights.clear();
+			selectedPointLight = 0;
+			selectedSpotLight = 0;
+		}
+
+		ImGui::TreePop();
+		ImGui::Spacing();
+	}
 
 	if (ImGui::TreeNode("Sun controls"))
 	{
@@ -541,7 +977,7 @@ void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial)
 				sun.direction = mainCam.Forward();
 			ImGui::SameLine();
 		}
-		if (suns.size() < maxLights && ImGui::Button("Add##sun"))
+		if (suns.size() < maxSuns && ImGui::Button("Add##sun"))
 		{
 			suns.emplace_back(Sun
 				{
@@ -561,6 +997,13 @@ void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial)
 				selectedSun--;
 		}
 
+		ImGui::Spacing();
+		ImGui::Checkbox("Shadows of the first sun##sun", &sunShadows);
+		ImGui::Checkbox("Show cascades##sun", &showShadowCascades);
+		ImGui::SliderFloat("Shadow distance##sun", &shadowDistance, 50.0f, Camera::GetFarPlane());
+		ImGui::Text("Cached cascades redrawn: %u of %u", shadowCascadesRendered, ShadowCascades::CascadesCount);
+		ImGui::Text("Dynamic casters drawn: %u", shadowDynamicCasters);
+
 		ImGui::TreePop();
 		ImGui::Spacing();
 	}
@@ -588,7 +1031,7 @@ void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial)
 				pointLight.position = mainCam.GetPosition();
 			ImGui::SameLine();
 		}
-		if (pointLights.size() < maxLights && ImGui::Button("Add##pointlight"))
+		if (ImGui::Button("Add##pointlight"))
 		{
 			pointLights.emplace_back(PointLight
 				{
@@ -646,7 +1089,7 @@ void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial)
 			}
 			ImGui::SameLine();
 		}
-		if (spotLights.size() < maxLights && ImGui::Button("Add##spotlight"))
+		if (ImGui::Button("Add##spotlight"))
 		{
 			spotLights.emplace_back(SpotLight
 				{
@@ -673,6 +1116,98 @@ void beginFrameImGui(Model& newEntityModel, Material newEntityMaterial)
 		ImGui::Spacing();
 	}
 
+	if (ImGui::TreeNode("Profiler"))
+	{
+		bool profilerEnabled = profiler.GetEnabled();
+		if (ImGui::Checkbox("Enabled##profiler", &profilerEnabled))
+			profiler.SetEnabled(profilerEnabled);
+
+		const float cpuFrameTime = profiler.GetCpuFrameTime();
+		ImGui::Text("CPU frame: %.2f ms (%.0f fps)", cpuFrameTime, cpuFrameTime > 0.0f ? 1000.0f / cpuFrameTime : 0.0f);
+		ImGui::Text("GPU frame: %.2f ms", profiler.GetGpuFrameTime());
+		ImGui::PlotLines("CPU##profiler", profiler.GetCpuFrameTimes().data(), Profiler::HistorySize,
+			profiler.GetHistoryOffset(), nullptr, 0.0f, 33.3f, ImVec2(0, 60));
+		ImGui::PlotLines("GPU##profiler", profiler.GetGpuFrameTimes().data(), Profiler::HistorySize,
+			profiler.GetHistoryOffset(), nullptr, 0.0f, 33.3f, ImVec2(0, 60));
+
+		if (ImGui::BeginTable("Scopes##profiler", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Scope");
+			ImGui::TableSetupColumn("CPU ms");
+			ImGui::TableSetupColumn("CPU avg");
+			ImGui::TableSetupColumn("GPU ms");
+			ImGui::TableSetupColumn("GPU avg");
+			ImGui::TableHeadersRow();
+
+			for (const ProfilerScope& scope : profiler.GetScopes())
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%*s%s", static_cast<int>(scope.depth) * 2, "", scope.name.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", scope.cpuMs);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", scope.cpuAverageMs);
+				ImGui::TableNextColumn();
+				if (scope.hasGpu)
+					ImGui::Text("%.3f", scope.gpuMs);
+				ImGui::TableNextColumn();
+				if (scope.hasGpu)
+					ImGui::Text("%.3f", scope.gpuAverageMs);
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::Text("Dropped GPU frames: %u", profiler.GetDroppedGpuFrames());
+		if (ImGui::Button("Save Chrome trace##profiler") && profiler.WriteChromeTrace("trace.json"))
+			std::cout << "Saved the last " << Profiler::TraceFrames << " frames to trace.json\n";
+
+		ImGui::TreePop();
+		ImGui::Spacing();
+	}
+
+#if ENTITIES_GL_INSTRUMENTATION
+	if (ImGui::TreeNode("GL calls"))
+	{
+		const GlCallCounts& counts = GlCallCounter::GetLastFrame();
+		ImGui::Text("Draw calls: %llu", counts.drawCalls);
+		ImGui::Text("Dispatches: %llu", counts.dispatches);
+		ImGui::Text("State changes: %llu (%llu redundant)", counts.stateChanges, counts.redundantStateChanges);
+		ImGui::Text("Uniform uploads: %llu (%llu redundant)", counts.uniformUploads, counts.redundantUniformUploads);
+
+		ImGui::Checkbox("Show uncalled##glcalls", &showUncalledGlCalls);
+
+		if (ImGui::BeginTable("Functions##glcalls", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Function");
+			ImGui::TableSetupColumn("Calls");
+			ImGui::TableSetupColumn("Redundant");
+			ImGui::TableHeadersRow();
+
+			for (const GlFunctionCalls& calls : GlCallCounter::GetLastFrameFunctionCalls())
+			{
+				if (calls.calls == 0 && !showUncalledGlCalls)
+					continue;
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(calls.name);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", calls.calls);
+				ImGui::TableNextColumn();
+				if (calls.redundant > 0)
+					ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "%llu", calls.redundant);
+				else
+					ImGui::TextUnformatted("0");
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::TreePop();
+		ImGui::Spacing();
+	}
+#endif
+
 	ImGui::End();
 }
 
@@ -22,39 +22,15 @@ void Material::ApplySuns(const std::vector<Sun>& suns) const
 	}
 }
 
+// The lights themselves are in storage buffers uploaded once a frame, see LightClusters
 void Material::ApplyPointLights(const std::vector<PointLight>& pointLights) const
 {
 	m_shader->SetInt("pointLightsCount", pointLights.size());
-	for (int i = 0; i < pointLights.size(); i++)
-	{
-		const PointLight& pointLight = pointLights[i];
-		const std::string member = "pointLights[" + std::to_string(i) + "]";
-		m_shader->SetVector3(member + ".position", pointLight.position);
-		m_shader->SetVector3(member + ".diffuse", pointLight.diffuse);
-		m_shader->SetVector3(member + ".specular", pointLight.specular);
-		m_shader->SetFloat(member + ".constant", pointLight.constant);
-		m_shader->SetFloat(member + ".linear", pointLight.linear);
-		m_shader->SetFloat(member + ".quadratic", pointLight.quadratic);
-	}
 }
 
 void Material::ApplySpotLights(const std::vector<SpotLight>& spotLights) const
 {
 	m_shader->SetInt("spotLightsCount", spotLights.size());
-	for (int i = 0; i < spotLights.size(); i++)
-	{
-		const SpotLight& pointLight = spotLights[i];
-		const std::string member = "spotLights[" + std::to_string(i) + "]";
-		m_shader->SetVector3(member + ".position", pointLight.position);
-		m_shader->SetVector3(member + ".direction", pointLight.direction);
-		m_shader->SetVector3(member + ".diffuse", pointLight.diffuse);
-		m_shader->SetVector3(member + ".specular", pointLight.specular);
-		m_shader->SetFloat(member + ".constant", pointLight.constant);
-		m_shader->SetFloat(member + ".linear", pointLight.linear);
-		m_shader->SetFloat(member + ".quadratic", pointLight.quadratic);
-		m_shader->SetFloat(member + ".innerCutoff", pointLight.innerCutoff);
-		m_shader->SetFloat(member + ".outerCutoff", pointLight.outerCutoff);
-	}
 }
 
 void Material::ApplyMaterial() const
@@ -65,6 +41,7 @@ void Material::ApplyMaterial() const
 	m_shader->SetInt("material.specularMap", 1);
 	m_shader->SetInt("material.specularOverride", m_specularMap == nullptr);
 	m_shader->SetFloat("material.shininess", m_shininess);
+	m_shader->SetInt("billboard", m_billboard);
 }
 
 void Material::ApplyTextures() const
@@ -103,4 +80,13 @@ void Material::UseHighlight() const
 		return;
 
 	m_highlightShader->Use();
+	m_highlightShader->SetInt("billboard", m_billboard);
+}
+
+void Material::UseShadow(ShaderProgram& shadowShader) const
+{
+	shadowShader.Use();
+	shadowShader.SetInt("billboard", m_billboard);
+	shadowShader.SetInt("alphaTested", m_diffuseMap != nullptr);
+	ApplyTextures();
 }
\ No newline at end of file
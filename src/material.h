@@ -23,6 +23,8 @@ public:
 		const std::vector<PointLight>& pointLight,
 		const std::vector<SpotLight>& spotLight) const;
 	void UseHighlight() const;
+	// Binds the diffuse map for the alpha test of a shadow map program, see ShadowCascades
+	void UseShadow(ShaderProgram& shadowShader) const;
 
 	void SetColor(glm::vec3 color) { m_color = color; }
 	[[nodiscard]] glm::vec3 GetColor() const { return m_color; }
@@ -36,6 +38,10 @@ public:
 	void SetShininess(float shininess) { m_shininess = shininess; }
 	[[nodiscard]] float GetShininess() const { return m_shininess; }
 
+	// Billboarded materials are yawed towards the camera in the vertex shader
+	void SetBillboard(bool billboard) { m_billboard = billboard; }
+	[[nodiscard]] bool GetBillboard() const { return m_billboard; }
+
 	[[nodiscard]] ShaderProgram& GetShader() const { return *m_shader; }
 	[[nodiscard]] ShaderProgram& GetHighlightShader() const { return *m_highlightShader; }
 
@@ -60,6 +66,8 @@ private:
 	float m_shininess{ 32 };
 	int m_shininessLocation = -1;
 
+	bool m_billboard = false;
+
 	ShaderProgram* m_shader;
 	ShaderProgram* m_highlightShader;
 
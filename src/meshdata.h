@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Small cluster of triangles stored as a contiguous range of the indices, see MeshletBuilder
+struct Meshlet
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+	// Every triangle faces away from a viewer for which dot(center - viewer, coneAxis) is at least
+	// coneCutoff * distance(center, viewer) + radius. A cutoff of 1 or more never passes.
+	glm::vec3 coneAxis = glm::vec3(0.0f);
+	float coneCutoff = 1.0f;
+	unsigned int firstIndex = 0;
+	unsigned int indicesCount = 0;
+};
+
+// Indexed triangle list with one position, uv and normal per vertex
+struct MeshData
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<unsigned int> indices;
+	// Optional, covering the indices in order
+	std::vector<Meshlet> meshlets;
+
+	[[nodiscard]] size_t GetVerticesCount() const { return positions.size(); }
+	[[nodiscard]] size_t GetTrianglesCount() const { return indices.size() / 3; }
+};
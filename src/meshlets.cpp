@@ -0,0 +1,139 @@
+#include <algorithm>
+
+#include "meshlets.h"
+
+namespace
+{
+	// Cones wider than this (dot with the axis below it) are too wide to ever be worth testing
+	constexpr float minConeDot = 0.1f;
+}
+
+void MeshletBuilder::Build(MeshData& mesh, unsigned int maxVertices, unsigned int maxTriangles)
+{
+	mesh.meshlets.clear();
+
+	// Vertex to the meshlet it was last added to, so membership checks are a single lookup
+	std::vector<unsigned int> lastMeshlet(mesh.GetVerticesCount(), ~0u);
+
+	unsigned int meshletIndex = 0;
+	unsigned int firstIndex = 0;
+	unsigned int verticesCount = 0;
+	unsigned int trianglesCount = 0;
+
+	for (unsigned int i = 0; i < mesh.indices.size(); i += 3)
+	{
+		unsigned int newVertices = 0;
+		for (int corner = 0; corner < 3; corner++)
+			newVertices += lastMeshlet[mesh.indices[i + corner]] != meshletIndex;
+
+		if (verticesCount + newVertices > maxVertices || trianglesCount + 1 > maxTriangles)
+		{
+			mesh.meshlets.push_back(ComputeBounds(mesh, firstIndex, i - firstIndex));
+
+			meshletIndex++;
+			firstIndex = i;
+			verticesCount = 0;
+			trianglesCount = 0;
+		}
+
+		for (int corner = 0; corner < 3; corner++)
+		{
+			unsigned int& last = lastMeshlet[mesh.indices[i + corner]];
+			if (last != meshletIndex)
+			{
+				last = meshletIndex;
+				verticesCount++;
+			}
+		}
+		trianglesCount++;
+	}
+
+	if (trianglesCount > 0)
+		mesh.meshlets.push_back(ComputeBounds(mesh, firstIndex, static_cast<unsigned int>(mesh.indices.size()) - firstIndex));
+}
+
+Meshlet MeshletBuilder::ComputeBounds(const MeshData& mesh, unsigned int firstIndex, unsigned int indicesCount)
+{
+	Meshlet meshlet;
+	meshlet.firstIndex = firstIndex;
+	meshlet.indicesCount = indicesCount;
+
+	// Centered on the box, as large as the furthest vertex
+	glm::vec3 min = mesh.positions[mesh.indices[firstIndex]];
+	glm::vec3 max = min;
+	for (unsigned int i = firstIndex; i < firstIndex + indicesCount; i++)
+	{
+		min = glm::min(min, mesh.positions[mesh.indices[i]]);
+		max = glm::max(max, mesh.positions[mesh.indices[i]]);
+	}
+
+	meshlet.center = (min + max) * 0.5f;
+	float maxDistanceSquared = 0.0f;
+	for (unsigned int i = firstIndex; i < firstIndex + indicesCount; i++)
+	{
+		const glm::vec3 offset = mesh.positions[mesh.indices[i]] - meshlet.center;
+		maxDistanceSquared = std::max(maxDistanceSquared, glm::dot(offset, offset));
+	}
+	meshlet.radius = glm::sqrt(maxDistanceSquared);
+
+	// Normal cone around the average face normal
+	std::vector<glm::vec3> normals;
+	normals.reserve(indicesCount / 3);
+	glm::vec3 axis(0.0f);
+	for (unsigned int i = firstIndex; i < firstIndex + indicesCount; i += 3)
+	{
+		const glm::vec3& a = mesh.positions[mesh.indices[i]];
+		const glm::vec3& b = mesh.positions[mesh.indices[i + 1]];
+		const glm::vec3& c = mesh.positions[mesh.indices[i + 2]];
+
+		const glm::vec3 normal = glm::cross(b - a, c - a);
+		const float length = glm::length(normal);
+		if (length == 0.0f)
+			continue;
+
+		normals.push_back(normal / length);
+		axis += normals.back();
+	}
+
+	const float axisLength = glm::length(axis);
+	if (axisLength == 0.0f)
+		return meshlet;
+
+	meshlet.coneAxis = axis / axisLength;
+
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : normals)
+		minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+
+	meshlet.coneCutoff = minDot < minConeDot ? 1.0f : glm::sqrt(1.0f - minDot * minDot);
+
+	return meshlet;
+}
+
+MeshletCullView MeshletCullView::Create(const Frustum& frustum, glm::vec3 cameraPosition, const glm::mat4& world)
+{
+	MeshletCullView view{};
+
+	const glm::mat4 transposedWorld = glm::transpose(world);
+	for (int i = 0; i < Frustum::PlanesCount; i++)
+	{
+		view.planes[i] = transposedWorld * frustum.planes[i];
+		view.planeScales[i] = glm::length(glm::vec3(view.planes[i]));
+	}
+
+	view.cameraPosition = glm::vec3(glm::inverse(world) * glm::vec4(cameraPosition, 1.0f));
+
+	return view;
+}
+
+bool MeshletCullView::IsCulled(const Meshlet& meshlet) const
+{
+	for (int i = 0; i < Frustum::PlanesCount; i++)
+	{
+		if (glm::dot(glm::vec3(planes[i]), meshlet.center) + planes[i].w < -meshlet.radius * planeScales[i])
+			return true;
+	}
+
+	const glm::vec3 toMeshlet = meshlet.center - cameraPosition;
+	return glm::dot(toMeshlet, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toMeshlet) + meshlet.radius;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "frustum.h"
+#include "meshdata.h"
+
+// Splits a mesh into meshlets of neighbouring triangles so large meshes can be culled in parts
+class MeshletBuilder
+{
+public:
+	static constexpr unsigned int MaxVertices = 64;
+	static constexpr unsigned int MaxTriangles = 124;
+
+	// Cuts the triangles into meshlets in their current order, which should already be vertex
+	// cache optimized so consecutive triangles share vertices. Fills mesh.meshlets.
+	static void Build(MeshData& mesh, unsigned int maxVertices = MaxVertices, unsigned int maxTriangles = MaxTriangles);
+
+private:
+	static Meshlet ComputeBounds(const MeshData& mesh, unsigned int firstIndex, unsigned int indicesCount);
+};
+
+// Frustum and camera moved into the model space of an entity, so its meshlets are tested
+// without transforming them. Exact for any transform that does not mirror the mesh.
+struct MeshletCullView
+{
+	glm::vec4 planes[Frustum::PlanesCount];
+	// Length of the plane normals, which scales the radius in model space
+	float planeScales[Frustum::PlanesCount];
+	glm::vec3 cameraPosition;
+
+	static MeshletCullView Create(const Frustum& frustum, glm::vec3 cameraPosition, const glm::mat4& world);
+
+	// Outside the frustum or every triangle facing away from the camera
+	[[nodiscard]] bool IsCulled(const Meshlet& meshlet) const;
+};
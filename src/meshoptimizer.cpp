@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <numeric>
+
+#include "meshoptimizer.h"
+
+namespace
+{
+	// Exact FIFO cache, a vertex is cached while fewer than CacheSize misses happened after its own
+	class FifoCache
+	{
+	public:
+		explicit FifoCache(size_t verticesCount) : m_timestamps(verticesCount, 0) {}
+
+		// Returns true on a miss
+		bool Access(unsigned int vertex)
+		{
+			if (m_time - m_timestamps[vertex] < MeshOptimizer::CacheSize)
+				return false;
+
+			m_timestamps[vertex] = ++m_time;
+			return true;
+		}
+
+		// Empties the cache without touching the timestamps, every one of them is now too old
+		void Reset() { m_time += MeshOptimizer::CacheSize; }
+
+	private:
+		std::vector<unsigned int> m_timestamps;
+		// Starts a cache size past the zeroed timestamps, so no vertex is cached yet
+		unsigned int m_time = MeshOptimizer::CacheSize;
+	};
+
+	// Triangles using each vertex, as offsets into one shared array
+	struct Adjacency
+	{
+		std::vector<unsigned int> offsets;
+		std::vector<unsigned int> triangles;
+
+		Adjacency(const std::vector<unsigned int>& indices, size_t verticesCount) :
+			offsets(verticesCount + 1, 0), triangles(indices.size())
+		{
+			for (const unsigned int index : indices)
+				offsets[index + 1]++;
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+			std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				triangles[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+		}
+	};
+}
+
+void MeshOptimizer::Optimize(MeshData& mesh)
+{
+	OptimizeVertexCache(mesh);
+	OptimizeOverdraw(mesh);
+	OptimizeVertexFetch(mesh);
+}
+
+void MeshOptimizer::OptimizeVertexCache(MeshData& mesh)
+{
+	const std::vector<unsigned int>& indices = mesh.indices;
+	const size_t verticesCount = mesh.GetVerticesCount();
+	const size_t trianglesCount = mesh.GetTrianglesCount();
+	if (trianglesCount == 0)
+		return;
+
+	const Adjacency adjacency(indices, verticesCount);
+
+	std::vector<unsigned int> liveTriangles(verticesCount);
+	for (size_t v = 0; v < verticesCount; v++)
+		liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+	std::vector<unsigned int> cacheTimestamps(verticesCount, 0);
+	std::vector<unsigned char> emitted(trianglesCount, 0);
+	std::vector<unsigned int> deadEnds;
+	std::vector<unsigned int> candidates;
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+
+	unsigned int time = CacheSize + 1;
+	unsigned int cursor = 0;
+	int fanning = static_cast<int>(indices[0]);
+
+	while (fanning >= 0)
+	{
+		// Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (unsigned int i = adjacency.offsets[fanning]; i < adjacency.offsets[fanning + 1]; i++)
+		{
+			const unsigned int triangle = adjacency.triangles[i];
+			if (emitted[triangle])
+				continue;
+
+			emitted[triangle] = 1;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const unsigned int vertex = indices[triangle * 3 + corner];
+				result.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+
+				if (time - cacheTimestamps[vertex] > CacheSize)
+					cacheTimestamps[vertex] = time++;
+			}
+		}
+
+		// Next is the vertex that stays longest in the cache while its triangles are emitted
+		int next = -1;
+		int bestPriority = -1;
+		for (const unsigned int vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+				continue;
+
+			int priority = 0;
+			if (time - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= CacheSize)
+				priority = static_cast<int>(time - cacheTimestamps[vertex]);
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = static_cast<int>(vertex);
+			}
+		}
+
+		// Dead end, go back to a recently used vertex or otherwise to the next one in input order
+		while (next < 0 && !deadEnds.empty())
+		{
+			const unsigned int vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[vertex] > 0)
+				next = static_cast<int>(vertex);
+		}
+
+		while (next < 0 && cursor < verticesCount)
+		{
+			if (liveTriangles[cursor] > 0)
+				next = static_cast<int>(cursor);
+			cursor++;
+		}
+
+		fanning = next;
+	}
+
+	mesh.indices = std::move(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(MeshData& mesh, float threshold)
+{
+	const std::vector<unsigned int>& indices = mesh.indices;
+	const size_t verticesCount = mesh.GetVerticesCount();
+	const size_t trianglesCount = mesh.GetTrianglesCount();
+	if (trianglesCount == 0)
+		return;
+
+	// Hard boundaries where the cache starts over, every vertex of the triangle missing
+	std::vector<unsigned int> hardClusters;
+	{
+		FifoCache cache(verticesCount);
+		for (unsigned int t = 0; t < trianglesCount; t++)
+		{
+			int misses = 0;
+			for (int corner = 0; corner < 3; corner++)
+				misses += cache.Access(indices[t * 3 + corner]);
+
+			if (misses == 3)
+				hardClusters.push_back(t);
+		}
+	}
+	hardClusters.push_back(static_cast<unsigned int>(trianglesCount));
+
+	const float targetAcmr = AnalyzeVertexCache(indices, verticesCount).acmr * threshold;
+
+	// Split further wherever the cluster so far is at least as cache friendly as the target,
+	// restarting the cache there costs about as much as it already paid
+	std::vector<unsigned int> clusters;
+	FifoCache cache(verticesCount);
+	for (size_t c = 0; c + 1 < hardClusters.size(); c++)
+	{
+		const unsigned int begin = hardClusters[c];
+		const unsigned int end = hardClusters[c + 1];
+
+		cache.Reset();
+		unsigned int clusterBegin = begin;
+		unsigned int misses = 0;
+		clusters.push_back(begin);
+
+		for (unsigned int t = begin; t < end; t++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+				misses += cache.Access(indices[t * 3 + corner]);
+
+			const unsigned int clusterTriangles = t - clusterBegin + 1;
+			if (t + 1 < end && static_cast<float>(misses) <= targetAcmr * static_cast<float>(clusterTriangles))
+			{
+				clusterBegin = t + 1;
+				misses = 0;
+				clusters.push_back(clusterBegin);
+				cache.Reset();
+			}
+		}
+	}
+
+	// Clusters facing away from the center draw first, they are the most likely to hide the rest
+	glm::vec3 meshCentroid(0.0f);
+	for (const glm::vec3& position : mesh.positions)
+		meshCentroid += position;
+	meshCentroid /= static_cast<float>(std::max<size_t>(verticesCount, 1));
+
+	const size_t clustersCount = clusters.size();
+	clusters.push_back(static_cast<unsigned int>(trianglesCount));
+
+	std::vector<float> sortKeys(clustersCount);
+	for (size_t c = 0; c < clustersCount; c++)
+	{
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+
+		for (unsigned int t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			const glm::vec3& a = mesh.positions[indices[t * 3]];
+			const glm::vec3& b = mesh.positions[indices[t * 3 + 1]];
+			const glm::vec3& p = mesh.positions[indices[t * 3 + 2]];
+
+			const glm::vec3 triangleNormal = glm::cross(b - a, p - a);
+			const float triangleArea = glm::length(triangleNormal);
+
+			centroid += (a + b + p) * (triangleArea / 3.0f);
+			normal += triangleNormal;
+			area += triangleArea;
+		}
+
+		const float normalLength = glm::length(normal);
+		if (area > 0.0f && normalLength > 0.0f)
+			sortKeys[c] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+	}
+
+	std::vector<unsigned int> order(clustersCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (const unsigned int c : order)
+		result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+
+	mesh.indices = std::move(result);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData& mesh)
+{
+	constexpr unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(mesh.GetVerticesCount(), unused);
+
+	MeshData result;
+	result.positions.reserve(mesh.positions.size());
+	result.uvs.reserve(mesh.uvs.size());
+	result.normals.reserve(mesh.normals.size());
+	result.indices.reserve(mesh.indices.size());
+
+	// Vertices in the order the indices first reach them, unreferenced ones are dropped
+	for (const unsigned int index : mesh.indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = static_cast<unsigned int>(result.positions.size());
+			result.positions.push_back(mesh.positions[index]);
+			result.uvs.push_back(mesh.uvs[index]);
+			result.normals.push_back(mesh.normals[index]);
+		}
+
+		result.indices.push_back(remap[index]);
+	}
+
+	mesh = std::move(result);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t verticesCount)
+{
+	FifoCache cache(verticesCount);
+	std::vector<unsigned char> used(verticesCount, 0);
+
+	unsigned int misses = 0;
+	unsigned int usedCount = 0;
+	for (const unsigned int index : indices)
+	{
+		misses += cache.Access(index);
+		if (!used[index])
+		{
+			used[index] = 1;
+			usedCount++;
+		}
+	}
+
+	VertexCacheStats stats;
+	if (!indices.empty())
+		stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	if (usedCount > 0)
+		stats.atvr = static_cast<float>(misses) / static_cast<float>(usedCount);
+
+	return stats;
+}
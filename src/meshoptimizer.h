@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "meshdata.h"
+
+// Post-transform vertex cache behaviour of an index order
+struct VertexCacheStats
+{
+	// Average cache misses per triangle, 0.5 is about the best a regular mesh can do, 3 is no reuse at all
+	float acmr = 0.0f;
+	// Average transforms per vertex, 1 when every vertex is only processed once
+	float atvr = 0.0f;
+};
+
+// Reorders a mesh for the GPU without changing what it looks like:
+// triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007), clusters of them
+// so outer surfaces draw before the ones they hide, and vertices in the order they are first used.
+class MeshOptimizer
+{
+public:
+	// Size of the FIFO cache the orders are tuned and measured for
+	static constexpr unsigned int CacheSize = 16;
+
+	// Runs all three passes in order
+	static void Optimize(MeshData& mesh);
+
+	static void OptimizeVertexCache(MeshData& mesh);
+	// Needs triangles already in vertex cache order, clusters are only moved while
+	// the ACMR stays within threshold times the one of that order
+	static void OptimizeOverdraw(MeshData& mesh, float threshold = 1.05f);
+	static void OptimizeVertexFetch(MeshData& mesh);
+
+	[[nodiscard]] static VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t verticesCount);
+};
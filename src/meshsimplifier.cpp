@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+
+#include "meshsimplifier.h"
+
+namespace
+{
+	// Constraint planes along open borders and uv seams weigh this much more than surface planes
+	constexpr double constraintWeight = 10.0;
+	// Collapses turning a triangle's normal by more than ~78 degrees are rejected
+	constexpr float minNormalDot = 0.2f;
+	// Flat shaded triangles turned by more than ~8 degrees get their normal recomputed
+	constexpr float flatNormalDot = 0.99f;
+
+	// Symmetric 4x4 matrix summing squared distances to planes
+	struct Quadric
+	{
+		double a2 = 0, ab = 0, ac = 0, ad = 0;
+		double b2 = 0, bc = 0, bd = 0;
+		double c2 = 0, cd = 0;
+		double d2 = 0;
+		double weight = 0;
+
+		static Quadric FromPlane(glm::dvec3 normal, double distance, double weight)
+		{
+			const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+			return {
+				a * a * weight, a * b * weight, a * c * weight, a * d * weight,
+				b * b * weight, b * c * weight, b * d * weight,
+				c * c * weight, c * d * weight,
+				d * d * weight,
+				weight };
+		}
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+			b2 += other.b2; bc += other.bc; bd += other.bd;
+			c2 += other.c2; cd += other.cd;
+			d2 += other.d2;
+			weight += other.weight;
+			return *this;
+		}
+
+		// Weighted mean of the squared distances to the planes
+		[[nodiscard]] double Evaluate(glm::dvec3 p) const
+		{
+			if (weight == 0.0)
+				return 0.0;
+
+			return (a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x
+				+ b2 * p.y * p.y + 2.0 * bc * p.y * p.z + 2.0 * bd * p.y
+				+ c2 * p.z * p.z + 2.0 * cd * p.z
+				+ d2) / weight;
+		}
+	};
+
+	struct Collapse
+	{
+		double cost;
+		unsigned int from;
+		unsigned int to;
+		unsigned int fromVersion;
+		unsigned int toVersion;
+
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+
+	unsigned long long EdgeKey(unsigned int a, unsigned int b)
+	{
+		if (a > b)
+			std::swap(a, b);
+		return (static_cast<unsigned long long>(a) << 32) | b;
+	}
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& p) const
+		{
+			unsigned int bits[3];
+			std::memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+}
+
+MeshData MeshSimplifier::Simplify(const MeshData& mesh, size_t targetTrianglesCount, float maxError)
+{
+	const size_t trianglesCount = mesh.GetTrianglesCount();
+	if (trianglesCount <= targetTrianglesCount)
+		return mesh;
+
+	// Weld by position so triangles split by uv or normal seams still share edges
+	std::unordered_map<glm::vec3, unsigned int, PositionHash> weldedIds;
+	std::vector<unsigned int> weld(mesh.GetVerticesCount());
+	std::vector<glm::vec3> positions;
+	for (size_t i = 0; i < mesh.GetVerticesCount(); i++)
+	{
+		const auto [it, inserted] = weldedIds.try_emplace(mesh.positions[i], static_cast<unsigned int>(positions.size()));
+		if (inserted)
+			positions.push_back(mesh.positions[i]);
+		weld[i] = it->second;
+	}
+
+	const size_t positionsCount = positions.size();
+
+	// Also weld by position and uv, normals may be split along hard edges without it being a seam
+	std::map<std::tuple<unsigned int, float, float>, unsigned int> uvWeldedIds;
+	std::vector<unsigned int> uvWeld(mesh.GetVerticesCount());
+	for (size_t i = 0; i < mesh.GetVerticesCount(); i++)
+	{
+		const auto [it, inserted] = uvWeldedIds.try_emplace({ weld[i], mesh.uvs[i].x, mesh.uvs[i].y },
+			static_cast<unsigned int>(uvWeldedIds.size()));
+		uvWeld[i] = it->second;
+	}
+
+	// Corners point at attribute vertices, their positions are tracked separately as they move
+	std::vector<unsigned int> corners(mesh.indices);
+	std::vector<unsigned int> cornerPositions(corners.size());
+	for (size_t i = 0; i < corners.size(); i++)
+		cornerPositions[i] = weld[corners[i]];
+
+	std::vector<unsigned char> removed(trianglesCount, 0);
+
+	// Flat shaded triangles are the ones with the same normal on every corner
+	std::vector<unsigned char> flat(trianglesCount, 0);
+	for (size_t t = 0; t < trianglesCount; t++)
+	{
+		const unsigned int* v = &corners[t * 3];
+		flat[t] = mesh.normals[v[0]] == mesh.normals[v[1]] && mesh.normals[v[0]] == mesh.normals[v[2]];
+	}
+	std::vector<std::vector<unsigned int>> vertexTriangles(positionsCount);
+	std::vector<Quadric> quadrics(positionsCount);
+
+	std::unordered_map<unsigned long long, unsigned int> positionEdgeUses;
+	std::unordered_map<unsigned long long, unsigned int> uvEdgeUses;
+
+	auto faceNormal = [&](unsigned int a, unsigned int b, unsigned int c)
+	{
+		return glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+	};
+
+	for (unsigned int t = 0; t < trianglesCount; t++)
+	{
+		const unsigned int* p = &cornerPositions[t * 3];
+		const unsigned int* v = &corners[t * 3];
+
+		const glm::dvec3 normal = faceNormal(p[0], p[1], p[2]);
+		const double doubleArea = glm::length(normal);
+		if (doubleArea > 0.0)
+		{
+			const glm::dvec3 unitNormal = normal / doubleArea;
+			const Quadric quadric = Quadric::FromPlane(unitNormal, -glm::dot(unitNormal, glm::dvec3(positions[p[0]])), doubleArea * 0.5);
+			for (int i = 0; i < 3; i++)
+				quadrics[p[i]] += quadric;
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			vertexTriangles[p[i]].push_back(t);
+			positionEdgeUses[EdgeKey(p[i], p[(i + 1) % 3])]++;
+			uvEdgeUses[EdgeKey(uvWeld[v[i]], uvWeld[v[(i + 1) % 3]])]++;
+		}
+	}
+
+	// Borders are edges with a single triangle, seams are shared edges whose uvs differ on each side
+	for (unsigned int t = 0; t < trianglesCount; t++)
+	{
+		const unsigned int* p = &cornerPositions[t * 3];
+		const unsigned int* v = &corners[t * 3];
+
+		const glm::dvec3 normal = faceNormal(p[0], p[1], p[2]);
+		if (glm::dot(normal, normal) == 0.0)
+			continue;
+
+		for (int i = 0; i < 3; i++)
+		{
+			const unsigned int a = p[i];
+			const unsigned int b = p[(i + 1) % 3];
+			const bool border = positionEdgeUses[EdgeKey(a, b)] == 1;
+			const bool seam = !border && uvEdgeUses[EdgeKey(uvWeld[v[i]], uvWeld[v[(i + 1) % 3]])] == 1;
+			if (!border && !seam)
+				continue;
+
+			// Plane through the edge, perpendicular to the triangle
+			const glm::dvec3 edge = glm::dvec3(positions[b]) - glm::dvec3(positions[a]);
+			const glm::dvec3 constraintNormal = glm::cross(edge, normal);
+			const double length = glm::length(constraintNormal);
+			if (length == 0.0)
+				continue;
+
+			const glm::dvec3 unitNormal = constraintNormal / length;
+			const Quadric quadric = Quadric::FromPlane(unitNormal, -glm::dot(unitNormal, glm::dvec3(positions[a])),
+				constraintWeight * glm::dot(edge, edge));
+			quadrics[a] += quadric;
+			quadrics[b] += quadric;
+		}
+	}
+
+	std::vector<unsigned int> versions(positionsCount, 0);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> queue;
+
+	auto pushEdge = [&](unsigned int a, unsigned int b)
+	{
+		Quadric quadric = quadrics[a];
+		quadric += quadrics[b];
+
+		// Half-edge collapse, the surviving vertex stays where it is
+		const double costToB = quadric.Evaluate(positions[b]);
+		const double costToA = quadric.Evaluate(positions[a]);
+		if (costToB <= costToA)
+			queue.push({ costToB, a, b, versions[a], versions[b] });
+		else
+			queue.push({ costToA, b, a, versions[b], versions[a] });
+	};
+
+	for (const auto& [key, uses] : positionEdgeUses)
+		pushEdge(static_cast<unsigned int>(key >> 32), static_cast<unsigned int>(key & 0xFFFFFFFFu));
+
+	auto neighbours = [&](unsigned int vertex, std::vector<unsigned int>& result)
+	{
+		result.clear();
+		for (const unsigned int t : vertexTriangles[vertex])
+		{
+			if (removed[t])
+				continue;
+			for (int i = 0; i < 3; i++)
+			{
+				const unsigned int p = cornerPositions[t * 3 + i];
+				if (p != vertex)
+					result.push_back(p);
+			}
+		}
+		std::sort(result.begin(), result.end());
+		result.erase(std::unique(result.begin(), result.end()), result.end());
+	};
+
+	std::vector<unsigned int> fromNeighbours, toNeighbours, common;
+	auto isCollapseValid = [&](unsigned int from, unsigned int to)
+	{
+		unsigned int sharedTriangles = 0;
+		for (const unsigned int t : vertexTriangles[from])
+		{
+			if (removed[t])
+				continue;
+
+			const unsigned int* p = &cornerPositions[t * 3];
+			if (p[0] == to || p[1] == to || p[2] == to)
+			{
+				sharedTriangles++;
+				continue;
+			}
+
+			const glm::vec3 before = faceNormal(p[0], p[1], p[2]);
+			const glm::vec3 after = faceNormal(
+				p[0] == from ? to : p[0],
+				p[1] == from ? to : p[1],
+				p[2] == from ? to : p[2]);
+
+			const float beforeLength = glm::length(before);
+			const float afterLength = glm::length(after);
+			if (afterLength == 0.0f || (beforeLength > 0.0f && glm::dot(before, after) < minNormalDot * beforeLength * afterLength))
+				return false;
+		}
+
+		// Link condition, more common neighbours than shared triangles would pinch the surface
+		neighbours(from, fromNeighbours);
+		neighbours(to, toNeighbours);
+		common.clear();
+		std::set_intersection(fromNeighbours.begin(), fromNeighbours.end(), toNeighbours.begin(), toNeighbours.end(), std::back_inserter(common));
+
+		return sharedTriangles > 0 && common.size() <= sharedTriangles;
+	};
+
+	size_t liveTrianglesCount = trianglesCount;
+	std::vector<unsigned int> touched;
+	std::vector<std::pair<unsigned int, unsigned int>> attributeRemap;
+
+	while (liveTrianglesCount > targetTrianglesCount && !queue.empty())
+	{
+		const Collapse collapse = queue.top();
+		queue.pop();
+
+		if (collapse.cost > maxError)
+			break;
+
+		if (versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion)
+			continue;
+
+		if (!isCollapseValid(collapse.from, collapse.to))
+			continue;
+
+		const unsigned int from = collapse.from;
+		const unsigned int to = collapse.to;
+
+		// The triangles around the edge tell which attributes of the kept vertex replace the removed
+		// one's, corners across a seam from them keep their own
+		attributeRemap.clear();
+		for (const unsigned int t : vertexTriangles[from])
+		{
+			if (removed[t])
+				continue;
+
+			const unsigned int* p = &cornerPositions[t * 3];
+			const unsigned int* v = &corners[t * 3];
+			const int fromCorner = p[0] == from ? 0 : p[1] == from ? 1 : 2;
+			const int toCorner = p[0] == to ? 0 : p[1] == to ? 1 : p[2] == to ? 2 : -1;
+			if (toCorner < 0)
+				continue;
+
+			attributeRemap.emplace_back(v[fromCorner], v[toCorner]);
+			removed[t] = 1;
+			liveTrianglesCount--;
+		}
+
+		for (const unsigned int t : vertexTriangles[from])
+		{
+			if (removed[t])
+				continue;
+
+			unsigned int* p = &cornerPositions[t * 3];
+			unsigned int* v = &corners[t * 3];
+			for (int i = 0; i < 3; i++)
+			{
+				if (p[i] != from)
+					continue;
+
+				p[i] = to;
+				for (const auto& [removedAttribute, keptAttribute] : attributeRemap)
+				{
+					if (v[i] == removedAttribute)
+					{
+						v[i] = keptAttribute;
+						break;
+					}
+				}
+			}
+			vertexTriangles[to].push_back(t);
+		}
+
+		vertexTriangles[from].clear();
+		quadrics[to] += quadrics[from];
+		versions[from]++;
+		versions[to]++;
+
+		std::erase_if(vertexTriangles[to], [&](unsigned int t) { return removed[t] != 0; });
+
+		neighbours(to, touched);
+		for (const unsigned int neighbour : touched)
+			pushEdge(to, neighbour);
+	}
+
+	// Rebuild the vertices, one per position and attribute pair still in use
+	MeshData result;
+	std::unordered_map<unsigned long long, unsigned int> outputIds;
+
+	for (unsigned int t = 0; t < trianglesCount; t++)
+	{
+		if (removed[t])
+			continue;
+
+		const unsigned int* p = &cornerPositions[t * 3];
+		const unsigned int* v = &corners[t * 3];
+
+		// Flat shaded triangles that turned noticeably get their normal recomputed and vertices of their own
+		bool recomputeNormal = false;
+		glm::vec3 flatNormal(0.0f);
+		if (flat[t])
+		{
+			const glm::vec3 normal = faceNormal(p[0], p[1], p[2]);
+			const float normalLength = glm::length(normal);
+			if (normalLength > 0.0f)
+			{
+				flatNormal = normal / normalLength;
+				recomputeNormal = glm::dot(flatNormal, mesh.normals[v[0]]) < flatNormalDot;
+			}
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			const unsigned long long key = (static_cast<unsigned long long>(p[i]) << 32) | v[i];
+			const auto [it, inserted] = recomputeNormal ?
+				std::pair{ outputIds.end(), true } :
+				outputIds.try_emplace(key, static_cast<unsigned int>(result.positions.size()));
+
+			if (inserted)
+			{
+				result.indices.push_back(static_cast<unsigned int>(result.positions.size()));
+				result.positions.push_back(positions[p[i]]);
+				result.uvs.push_back(mesh.uvs[v[i]]);
+				result.normals.push_back(recomputeNormal ? flatNormal : mesh.normals[v[i]]);
+			}
+			else
+			{
+				result.indices.push_back(it->second);
+			}
+		}
+	}
+
+	return result;
+}
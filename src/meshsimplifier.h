@@ -0,0 +1,15 @@
+#pragma once
+
+#include "meshdata.h"
+
+// Quadric error metric simplification (Garland-Heckbert) with half-edge collapses, so every
+// vertex keeps one of the original positions. Vertices are welded by position before
+// simplifying, open borders and uv seams are held in place by extra constraint planes, and
+// collapses that would fold a triangle over are rejected.
+class MeshSimplifier
+{
+public:
+	// Collapses edges until the mesh has at most targetTrianglesCount triangles or
+	// no collapse below maxError (squared distance) is left
+	static MeshData Simplify(const MeshData& mesh, size_t targetTrianglesCount, float maxError = 1e30f);
+};
@@ -1,54 +1,228 @@
+#include <cstddef>
+
 #include <glad/glad.h>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 #include "model.h"
 
 unsigned int Model::s_currentlyBoundBuffer = 0;
 
-Model Model::Create(const std::vector<float>& vertices, const std::vector<float>& uvs, const std::vector<float>& normals)
+namespace
+{
+	// Returns the bytes uploaded
+	size_t CreateFloatBuffers(
+		const std::vector<glm::vec3>& vertices,
+		const std::vector<glm::vec2>& uvs,
+		const std::vector<glm::vec3>& normals,
+		std::vector<unsigned int>& buffers)
+	{
+		unsigned int vertBuffer;
+		glGenBuffers(1, &vertBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, vertBuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+		glEnableVertexAttribArray(0);
+
+		unsigned int uvBuffer;
+		glGenBuffers(1, &uvBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, uvBuffer);
+		glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), uvs.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+		glEnableVertexAttribArray(1);
+
+		unsigned int normalBuffer;
+		glGenBuffers(1, &normalBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
+		glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+		glEnableVertexAttribArray(2);
+
+		buffers.insert(buffers.end(), { vertBuffer, uvBuffer, normalBuffer });
+		return vertices.size() * sizeof(glm::vec3) + uvs.size() * sizeof(glm::vec2) + normals.size() * sizeof(glm::vec3);
+	}
+
+	struct QuantizedVertex
+	{
+		unsigned short position[4];
+		unsigned int normal;
+		unsigned int uv;
+	};
+	static_assert(sizeof(QuantizedVertex) == 16);
+
+	// Folds the unit sphere onto an octahedron and that flat onto the [-1, 1] square
+	glm::vec2 EncodeOctahedral(glm::vec3 normal)
+	{
+		normal /= glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+		glm::vec2 encoded(normal.x, normal.y);
+		if (normal.z < 0.0f)
+		{
+			const glm::vec2 signs(encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f);
+			encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signs;
+		}
+		return encoded;
+	}
+
+	size_t CreateQuantizedBuffer(
+		const std::vector<glm::vec3>& vertices,
+		const std::vector<glm::vec2>& uvs,
+		const std::vector<glm::vec3>& normals,
+		glm::vec3 positionOffset, glm::vec3 positionScale,
+		std::vector<unsigned int>& buffers)
+	{
+		const glm::vec3 inverseScale(
+			positionScale.x > 0.0f ? 1.0f / positionScale.x : 0.0f,
+			positionScale.y > 0.0f ? 1.0f / positionScale.y : 0.0f,
+			positionScale.z > 0.0f ? 1.0f / positionScale.z : 0.0f);
+
+		std::vector<QuantizedVertex> packed(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const glm::vec3 normalized = glm::clamp((vertices[i] - positionOffset) * inverseScale, 0.0f, 1.0f);
+			const glm::u16vec3 position = glm::round(normalized * 65535.0f);
+			packed[i].position[0] = position.x;
+			packed[i].position[1] = position.y;
+			packed[i].position[2] = position.z;
+			packed[i].position[3] = 0;
+
+			const float normalLength = glm::length(normals[i]);
+			packed[i].normal = glm::packSnorm2x16(normalLength > 0.0f ? EncodeOctahedral(normals[i] / normalLength) : glm::vec2(0.0f));
+			packed[i].uv = glm::packHalf2x16(uvs[i]);
+		}
+
+		unsigned int vertexBuffer;
+		glGenBuffers(1, &vertexBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(QuantizedVertex), packed.data(), GL_STATIC_DRAW);
+
+		constexpr int stride = sizeof(QuantizedVertex);
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, reinterpret_cast<const void*>(offsetof(QuantizedVertex, position)));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(QuantizedVertex, uv)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, reinterpret_cast<const void*>(offsetof(QuantizedVertex, normal)));
+		glEnableVertexAttribArray(2);
+
+		buffers.push_back(vertexBuffer);
+		return packed.size() * sizeof(QuantizedVertex);
+	}
+}
+
+Model Model::Create(
+	const std::vector<MeshData>& lods,
+	const std::vector<float>& screenSizes,
+	const BoundingBox& boundingBox,
+	const BoundingSphere& boundingSphere,
+	VertexFormat vertexFormat)
 {
+	// Every level shares one set of buffers, offset by its first index and base vertex
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<unsigned int> indices;
+	std::vector<ModelLod> modelLods;
+	std::vector<Meshlet> meshlets;
+
+	for (size_t i = 0; i < lods.size() && i < MaxLods; i++)
+	{
+		const MeshData& mesh = lods[i];
+
+		ModelLod lod;
+		lod.firstIndex = static_cast<unsigned int>(indices.size());
+		lod.indicesCount = static_cast<unsigned int>(mesh.indices.size());
+		lod.baseVertex = static_cast<int>(vertices.size());
+		lod.screenSize = i < screenSizes.size() ? screenSizes[i] : 0.0f;
+		lod.firstMeshlet = static_cast<unsigned int>(meshlets.size());
+		lod.meshletsCount = static_cast<unsigned int>(mesh.meshlets.size());
+		modelLods.push_back(lod);
+
+		for (Meshlet meshlet : mesh.meshlets)
+		{
+			meshlet.firstIndex += lod.firstIndex;
+			meshlets.push_back(meshlet);
+		}
+
+		vertices.insert(vertices.end(), mesh.positions.begin(), mesh.positions.end());
+		uvs.insert(uvs.end(), mesh.uvs.begin(), mesh.uvs.end());
+		normals.insert(normals.end(), mesh.normals.begin(), mesh.normals.end());
+		indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+	}
+
 	unsigned int vertexArrayObject;
 	glGenVertexArrays(1, &vertexArrayObject);
 	glBindVertexArray(vertexArrayObject);
+	s_currentlyBoundBuffer = vertexArrayObject;
+
+	std::vector<unsigned int> buffers;
+	glm::vec3 positionOffset(0.0f);
+	glm::vec3 positionScale(1.0f);
+	size_t vertexDataSize;
 
-	unsigned int vertBuffer;
-	glGenBuffers(1, &vertBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, vertBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
-	glEnableVertexAttribArray(0);
-
-	unsigned int uvBuffer;
-	glGenBuffers(1, &uvBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, uvBuffer);
-	glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(float), uvs.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
-	glEnableVertexAttribArray(1);
-
-	unsigned int normalBuffer;
-	glGenBuffers(1, &normalBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(float), normals.data(), GL_STATIC_DRAW);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
-	glEnableVertexAttribArray(2);
-
-	return Model(vertexArrayObject, vertices.size() / 3);
+	if (vertexFormat == VertexFormat::Quantized)
+	{
+		if (!vertices.empty())
+		{
+			glm::vec3 min = vertices[0];
+			glm::vec3 max = vertices[0];
+			for (const glm::vec3& v : vertices)
+			{
+				min = glm::min(min, v);
+				max = glm::max(max, v);
+			}
+
+			positionOffset = min;
+			positionScale = max - min;
+		}
+
+		vertexDataSize = CreateQuantizedBuffer(vertices, uvs, normals, positionOffset, positionScale, buffers);
+	}
+	else
+	{
+		vertexDataSize = CreateFloatBuffers(vertices, uvs, normals, buffers);
+	}
+
+	unsigned int indexBuffer;
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	buffers.push_back(indexBuffer);
+
+	Model model(vertexArrayObject, std::move(buffers), std::move(modelLods));
+	model.m_meshlets = std::move(meshlets);
+	model.m_boundingBox = boundingBox;
+	model.m_boundingSphere = boundingSphere;
+	model.m_vertexFormat = vertexFormat;
+	model.m_positionOffset = positionOffset;
+	model.m_positionScale = positionScale;
+	model.m_vertexDataSize = vertexDataSize;
+
+	return model;
 }
 
 Model::~Model()
 {
-	if (m_buffer != 0)
-	{
-		glDeleteBuffers(1, &m_buffer);
-	}
+	Release();
 }
 
 Model::Model(Model&& other) noexcept
 {
 	m_buffer = other.m_buffer;
-	m_verticesCount = other.m_verticesCount;
+	m_dataBuffers = std::move(other.m_dataBuffers);
+	m_lods = std::move(other.m_lods);
+	m_meshlets = std::move(other.m_meshlets);
+	m_commandBuffer = other.m_commandBuffer;
+	m_vertexFormat = other.m_vertexFormat;
+	m_positionOffset = other.m_positionOffset;
+	m_positionScale = other.m_positionScale;
+	m_vertexDataSize = other.m_vertexDataSize;
+	m_boundingBox = other.m_boundingBox;
+	m_boundingSphere = other.m_boundingSphere;
 
 	other.m_buffer = 0;
-	other.m_verticesCount = 0;
+	other.m_dataBuffers.clear();
+	other.m_lods.clear();
+	other.m_meshlets.clear();
+	other.m_commandBuffer = 0;
 }
 
 Model& Model::operator= (Model&& other) noexcept
@@ -56,24 +230,117 @@ Model& Model::operator= (Model&& other) noexcept
 	if (this == &other)
 		return *this;
 
-	if (m_buffer != 0)
-		glDeleteBuffers(1, &m_buffer);
+	Release();
 
 	m_buffer = other.m_buffer;
-	m_verticesCount = other.m_verticesCount;
+	m_dataBuffers = std::move(other.m_dataBuffers);
+	m_lods = std::move(other.m_lods);
+	m_meshlets = std::move(other.m_meshlets);
+	m_commandBuffer = other.m_commandBuffer;
+	m_vertexFormat = other.m_vertexFormat;
+	m_positionOffset = other.m_positionOffset;
+	m_positionScale = other.m_positionScale;
+	m_vertexDataSize = other.m_vertexDataSize;
+	m_boundingBox = other.m_boundingBox;
+	m_boundingSphere = other.m_boundingSphere;
 
 	other.m_buffer = 0;
-	other.m_verticesCount = 0;
+	other.m_dataBuffers.clear();
+	other.m_lods.clear();
+	other.m_meshlets.clear();
+	other.m_commandBuffer = 0;
 
 	return *this;
 }
 
-void Model::Draw() const
+void Model::Draw(unsigned int lod) const
+{
+	const ModelLod& range = m_lods[lod];
+
+	Bind();
+	glDrawElementsBaseVertex(GL_TRIANGLES, range.indicesCount, GL_UNSIGNED_INT,
+		reinterpret_cast<const void*>(range.firstIndex * sizeof(unsigned int)), range.baseVertex);
+}
+
+void Model::DrawInstanced(unsigned int instanceCount, unsigned int lod) const
+{
+	const ModelLod& range = m_lods[lod];
+
+	Bind();
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indicesCount, GL_UNSIGNED_INT,
+		reinterpret_cast<const void*>(range.firstIndex * sizeof(unsigned int)), instanceCount, range.baseVertex);
+}
+
+void Model::DrawIndirect(unsigned int lod) const
+{
+	Bind();
+	glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+		reinterpret_cast<const void*>(lod * sizeof(DrawElementsIndirectCommand)));
+}
+
+void Model::DrawCommands(std::span<const DrawElementsIndirectCommand> commands) const
+{
+	if (commands.empty())
+		return;
+
+	if (m_commandBuffer == 0)
+		glGenBuffers(1, &m_commandBuffer);
+
+	// Orphaned every time, the driver hands out fresh memory instead of waiting for earlier draws
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size_bytes(), commands.data(), GL_STREAM_DRAW);
+
+	Bind();
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<int>(commands.size()), 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void Model::ApplyVertexFormat(ShaderProgram& shader) const
+{
+	const bool quantized = m_vertexFormat == VertexFormat::Quantized;
+	shader.SetInt("quantizedVertices", quantized);
+	if (quantized)
+	{
+		shader.SetVector3("positionOffset", m_positionOffset);
+		shader.SetVector3("positionScale", m_positionScale);
+	}
+}
+
+unsigned int Model::SelectLod(float screenSize, unsigned int currentLod) const
+{
+	const unsigned int lastLod = GetLodsCount() - 1;
+	unsigned int lod = currentLod < lastLod ? currentLod : lastLod;
+
+	while (lod < lastLod && screenSize < m_lods[lod + 1].screenSize * (1.0f - LodHysteresis))
+		lod++;
+
+	while (lod > 0 && screenSize > m_lods[lod].screenSize * (1.0f + LodHysteresis))
+		lod--;
+
+	return lod;
+}
+
+void Model::Bind() const
 {
 	if (s_currentlyBoundBuffer != m_buffer)
 	{
 		s_currentlyBoundBuffer = m_buffer;
 		glBindVertexArray(m_buffer);
 	}
-	glDrawArrays(GL_TRIANGLES, 0, m_verticesCount);
-}
\ No newline at end of file
+}
+
+void Model::Release()
+{
+	if (m_commandBuffer != 0)
+		glDeleteBuffers(1, &m_commandBuffer);
+
+	if (!m_dataBuffers.empty())
+		glDeleteBuffers(static_cast<int>(m_dataBuffers.size()), m_dataBuffers.data());
+
+	if (m_buffer != 0)
+	{
+		if (s_currentlyBoundBuffer == m_buffer)
+			s_currentlyBoundBuffer = 0;
+		glDeleteVertexArrays(1, &m_buffer);
+	}
+}
@@ -1,29 +1,117 @@
 #pragma once
 
+#include <span>
 #include <vector>
 
+#include "bounds.h"
+#include "meshdata.h"
+#include "shaderprogram.h"
+
+// Layout expected by glDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	unsigned int count;
+	unsigned int instanceCount;
+	unsigned int firstIndex;
+	int baseVertex;
+	unsigned int baseInstance;
+};
+
+// Range of the shared buffers holding one level of detail
+struct ModelLod
+{
+	unsigned int firstIndex = 0;
+	unsigned int indicesCount = 0;
+	int baseVertex = 0;
+	// Projected radius over the half height of the screen below which this level replaces
+	// the previous one, unused for the first level
+	float screenSize = 0.0f;
+	// Range of the model's meshlets, empty when the level was loaded without them
+	unsigned int firstMeshlet = 0;
+	unsigned int meshletsCount = 0;
+};
+
 class Model
 {
 public:
+	static constexpr unsigned int MaxLods = 4;
+	// Fraction a level's threshold has to be crossed by before switching to it
+	static constexpr float LodHysteresis = 0.1f;
+
+	enum class VertexFormat
+	{
+		// Separate float buffers, 32 bytes per vertex
+		Float,
+		// One interleaved buffer of 16 bytes per vertex: positions as 16 bit unorm within the
+		// bounds of the vertices, octahedral normals as 2x16 bit snorm and half float uvs
+		Quantized,
+	};
+
 	Model() = delete;
 	~Model();
 
 	Model(Model&& other) noexcept;
 	Model& operator= (Model&& other) noexcept;
 
+	// lods go from the most to the least detailed, screenSizes holds one threshold per level
 	static Model Create(
-		const std::vector<float>& vertices,
-		const std::vector<float>& uvs,
-		const std::vector<float>& normals);
+		const std::vector<MeshData>& lods,
+		const std::vector<float>& screenSizes,
+		const BoundingBox& boundingBox = {},
+		const BoundingSphere& boundingSphere = {},
+		VertexFormat vertexFormat = VertexFormat::Float);
+
+	void Draw(unsigned int lod = 0) const;
+	void DrawInstanced(unsigned int instanceCount, unsigned int lod = 0) const;
+	// Reads the DrawElementsIndirectCommand at index lod from the bound GL_DRAW_INDIRECT_BUFFER
+	void DrawIndirect(unsigned int lod = 0) const;
+	// Uploads the commands, e.g. the visible meshlets, to the model's own indirect buffer and draws them
+	void DrawCommands(std::span<const DrawElementsIndirectCommand> commands) const;
 
-	void Draw() const;
+	// Sets the uniforms vertexShader.glsl needs to decode this model's vertices
+	void ApplyVertexFormat(ShaderProgram& shader) const;
+	[[nodiscard]] VertexFormat GetVertexFormat() const { return m_vertexFormat; }
+	// Bytes of vertex data over every level, without the indices
+	[[nodiscard]] size_t GetVertexDataSize() const { return m_vertexDataSize; }
+
+	// Level to draw at the given projected size, staying on currentLod while close to its thresholds
+	[[nodiscard]] unsigned int SelectLod(float screenSize, unsigned int currentLod) const;
+
+	[[nodiscard]] unsigned int GetLodsCount() const { return static_cast<unsigned int>(m_lods.size()); }
+	[[nodiscard]] const ModelLod& GetLod(unsigned int lod) const { return m_lods[lod]; }
+	[[nodiscard]] unsigned int GetTrianglesCount(unsigned int lod = 0) const { return m_lods[lod].indicesCount / 3; }
+
+	// Index ranges are absolute within the model's index buffer
+	[[nodiscard]] std::span<const Meshlet> GetMeshlets(unsigned int lod) const
+	{
+		return std::span<const Meshlet>(m_meshlets).subspan(m_lods[lod].firstMeshlet, m_lods[lod].meshletsCount);
+	}
+	[[nodiscard]] bool HasMeshlets() const { return !m_meshlets.empty(); }
+
+	// Model space bounds, computed at load time
+	[[nodiscard]] const BoundingBox& GetBoundingBox() const { return m_boundingBox; }
+	[[nodiscard]] const BoundingSphere& GetBoundingSphere() const { return m_boundingSphere; }
 
 private:
-	Model(unsigned int buffer, unsigned long long verticesCount) : 
-		m_buffer(buffer), m_verticesCount(verticesCount) {}
+	Model(unsigned int buffer, std::vector<unsigned int> dataBuffers, std::vector<ModelLod> lods) :
+		m_buffer(buffer), m_dataBuffers(std::move(dataBuffers)), m_lods(std::move(lods)) {}
+
+	void Bind() const;
+	void Release();
 
 	unsigned int m_buffer = 0;
-	unsigned long long m_verticesCount = 0;
+	std::vector<unsigned int> m_dataBuffers;
+	std::vector<ModelLod> m_lods;
+	std::vector<Meshlet> m_meshlets;
+	mutable unsigned int m_commandBuffer = 0;
+
+	VertexFormat m_vertexFormat = VertexFormat::Float;
+	glm::vec3 m_positionOffset = glm::vec3(0.0f);
+	glm::vec3 m_positionScale = glm::vec3(1.0f);
+	size_t m_vertexDataSize = 0;
+
+	BoundingBox m_boundingBox;
+	BoundingSphere m_boundingSphere;
 
 	static unsigned int s_currentlyBoundBuffer;
-};
\ No newline at end of file
+};
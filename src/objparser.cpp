@@ -1,19 +1,22 @@
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-#include "objParser.h"
+#include "objparser.h"
 #include "fileutils.h"
+#include "meshlets.h"
+#include "meshoptimizer.h"
+#include "meshsimplifier.h"
 
-Model ObjParser::LoadFromFile(const std::string& filePath)
+Model ObjParser::LoadFromFile(const std::string& filePath, const ModelOptions& options)
 {
 	std::vector<glm::vec3> vertices;
-	std::vector<glm::vec3> endVertices;
-
 	std::vector<glm::vec2> uv;
-	std::vector<glm::vec2> endUv;
-
 	std::vector<glm::vec3> normal;
-	std::vector<glm::vec3> endNormal;
+
+	// Corners sharing the same position, uv and normal become one vertex
+	MeshData mesh;
+	std::unordered_map<std::string, unsigned int> cornerIndices;
 
 	std::cout << "Loading model: " << filePath << '\n';
 	std::streamoff fileSize = getFileSize(filePath);
@@ -75,20 +78,18 @@ Model ObjParser::LoadFromFile(const std::string& filePath)
 				continue;
 			}
 
-			auto vec = TokenizeString(tokens[1], '/');
-			endVertices.push_back(vertices[std::stoi(vec[0]) - 1]);
-			endUv.push_back(uv[std::stoi(vec[1]) - 1]);
-			endNormal.push_back(normal[std::stoi(vec[2]) - 1]);
-
-			vec = TokenizeString(tokens[2], '/');
-			endVertices.push_back(vertices[std::stoi(vec[0]) - 1]);
-			endUv.push_back(uv[std::stoi(vec[1]) - 1]);
-			endNormal.push_back(normal[std::stoi(vec[2]) - 1]);
-
-			vec = TokenizeString(tokens[3], '/');
-			endVertices.push_back(vertices[std::stoi(vec[0]) - 1]);
-			endUv.push_back(uv[std::stoi(vec[1]) - 1]);
-			endNormal.push_back(normal[std::stoi(vec[2]) - 1]);
+			for (int i = 1; i <= 3; i++)
+			{
+				const auto [it, inserted] = cornerIndices.try_emplace(tokens[i], static_cast<unsigned int>(mesh.positions.size()));
+				if (inserted)
+				{
+					const auto vec = TokenizeString(tokens[i], '/');
+					mesh.positions.push_back(vertices[std::stoi(vec[0]) - 1]);
+					mesh.uvs.push_back(uv[std::stoi(vec[1]) - 1]);
+					mesh.normals.push_back(normal[std::stoi(vec[2]) - 1]);
+				}
+				mesh.indices.push_back(it->second);
+			}
 		}
 
 		if (lineIndex % 30 == 0) // Update every x lines
@@ -97,38 +98,110 @@ Model ObjParser::LoadFromFile(const std::string& filePath)
 
 	std::cout << "\r  Loaded: 100.00%     \n";
 
+	const BoundingBox boundingBox = ComputeBoundingBox(mesh.positions);
+	const BoundingSphere boundingSphere = ComputeBoundingSphere(mesh.positions, boundingBox);
+	std::cout << "  Bounds radius: " << boundingSphere.radius << '\n';
+
+	std::vector<float> screenSizes;
+	std::vector<MeshData> lods = GenerateLods(mesh, options, boundingSphere.radius, screenSizes);
+
+	if (options.optimize)
+	{
+		for (size_t i = 0; i < lods.size(); i++)
+		{
+			const VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(lods[i].indices, lods[i].GetVerticesCount());
+			MeshOptimizer::Optimize(lods[i]);
+			const VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(lods[i].indices, lods[i].GetVerticesCount());
+
+			std::cout << "  LOD " << i << " optimized: ACMR " << before.acmr << " -> " << after.acmr
+				<< ", ATVR " << before.atvr << " -> " << after.atvr << '\n';
+		}
+	}
+
+	if (options.meshlets)
+	{
+		for (size_t i = 0; i < lods.size(); i++)
+		{
+			MeshletBuilder::Build(lods[i]);
+			std::cout << "  LOD " << i << ": " << lods[i].meshlets.size() << " meshlets\n";
+		}
+	}
+
+	Model model = Model::Create(lods, screenSizes, boundingBox, boundingSphere,
+		options.quantize ? Model::VertexFormat::Quantized : Model::VertexFormat::Float);
+	std::cout << "  Vertex data: " << static_cast<double>(model.GetVertexDataSize()) / 1024.0 << "KiB"
+		<< (options.quantize ? " quantized\n" : "\n");
+
 	std::cout << "  Model loaded: " << filePath << '\n';
 
-	return Model::Create(FlattenVector3(endVertices), FlattenVector2(endUv), FlattenVector3(endNormal));
+	return model;
 }
 
-std::vector<float> ObjParser::FlattenVector3(const std::vector<glm::vec3>& vector)
+std::vector<MeshData> ObjParser::GenerateLods(const MeshData& mesh, const ModelOptions& options, float boundingRadius, std::vector<float>& screenSizes)
 {
-	std::vector<float> result(vector.size() * 3);
-	int index = 0;
+	std::vector<MeshData> lods = { mesh };
+	screenSizes = { 0.0f };
+
+	const unsigned int lodsCount = glm::clamp(options.lodsCount, 1u, Model::MaxLods);
+	float screenSize = options.lodScreenSize;
+	float maxError = options.lodMaxError * boundingRadius;
 
-	for (const glm::vec3& v : vector)
+	// Each level is simplified from the previous one, which is both faster and keeps them nested
+	while (lods.size() < lodsCount)
 	{
-		result[index] = v.x;
-		result[index + 1] = v.y;
-		result[index + 2] = v.z;
-		index += 3;
+		const MeshData& previous = lods.back();
+		const size_t target = static_cast<size_t>(static_cast<float>(previous.GetTrianglesCount()) * options.lodReduction);
+
+		MeshData simplified = MeshSimplifier::Simplify(previous, target, maxError * maxError);
+
+		// Not worth a level when the mesh barely got any simpler
+		if (simplified.GetTrianglesCount() * 10 > previous.GetTrianglesCount() * 9)
+			break;
+
+		lods.push_back(std::move(simplified));
+		screenSizes.push_back(screenSize);
+		screenSize *= 0.5f;
+		maxError *= 2.0f;
 	}
 
-	return result;
+	for (size_t i = 0; i < lods.size(); i++)
+	{
+		std::cout << "  LOD " << i << ": " << lods[i].GetTrianglesCount() << " triangles, "
+			<< lods[i].GetVerticesCount() << " vertices";
+		if (i > 0)
+			std::cout << ", below screen size " << screenSizes[i];
+		std::cout << '\n';
+	}
+
+	return lods;
 }
 
-std::vector<float> ObjParser::FlattenVector2(const std::vector<glm::vec2>& vector)
+BoundingBox ObjParser::ComputeBoundingBox(const std::vector<glm::vec3>& vertices)
 {
-	std::vector<float> result(vector.size() * 2);
-	int index = 0;
+	if (vertices.empty())
+		return {};
+
+	BoundingBox result{ vertices[0], vertices[0] };
+	for (const glm::vec3& v : vertices)
+	{
+		result.min = glm::min(result.min, v);
+		result.max = glm::max(result.max, v);
+	}
 
-	for (const glm::vec2& v : vector)
+	return result;
+}
+
+BoundingSphere ObjParser::ComputeBoundingSphere(const std::vector<glm::vec3>& vertices, const BoundingBox& boundingBox)
+{
+	// Centered on the box, but only as large as the furthest vertex
+	BoundingSphere result{ boundingBox.Center(), 0.0f };
+	float maxDistanceSquared = 0.0f;
+	for (const glm::vec3& v : vertices)
 	{
-		result[index] = v.x;
-		result[index + 1] = v.y;
-		index += 2;
+		const glm::vec3 offset = v - result.center;
+		maxDistanceSquared = glm::max(maxDistanceSquared, glm::dot(offset, offset));
 	}
+	result.radius = glm::sqrt(maxDistanceSquared);
 
 	return result;
 }
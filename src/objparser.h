@@ -3,14 +3,37 @@
 #include <string>
 #include "glm/glm.hpp"
 #include "model.h"
+#include "bounds.h"
+#include "meshdata.h"
+
+struct ModelOptions
+{
+	// Levels of detail to generate, including the full mesh
+	unsigned int lodsCount = 1;
+	// Fraction of the previous level's triangles each level is simplified to
+	float lodReduction = 0.5f;
+	// Projected size the first simplified level takes over at, halved for every following one
+	float lodScreenSize = 0.25f;
+	// Largest distance a simplified surface may move away from the full mesh, relative to the
+	// bounding radius. Doubled for every level, like the projected size is halved.
+	float lodMaxError = 0.01f;
+	// Reorder triangles and vertices of every level for the vertex cache, overdraw and vertex fetch
+	bool optimize = true;
+	// Split every level into meshlets the scene culls separately, for large meshes
+	bool meshlets = false;
+	// Store vertices in the compact 16 byte format, see Model::VertexFormat
+	bool quantize = false;
+};
 
 class ObjParser
 {
 public:
-	static Model LoadFromFile(const std::string& filePath);
+	static Model LoadFromFile(const std::string& filePath, const ModelOptions& options = {});
+	// Splits on runs of separator and stops at a '#' comment
+	static std::vector<std::string> TokenizeString(std::string_view stringToTokenize, char separator);
 
 private:
-	static std::vector<float> FlattenVector2(const std::vector<glm::vec2>& vector);
-	static std::vector<float> FlattenVector3(const std::vector<glm::vec3>& vector);
-	static std::vector<std::string> TokenizeString(std::string_view stringToTokenize, char separator);
+	static std::vector<MeshData> GenerateLods(const MeshData& mesh, const ModelOptions& options, float boundingRadius, std::vector<float>& screenSizes);
+	static BoundingBox ComputeBoundingBox(const std::vector<glm::vec3>& vertices);
+	static BoundingSphere ComputeBoundingSphere(const std::vector<glm::vec3>& vertices, const BoundingBox& boundingBox);
 };
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <bit>
+
+#include <glad/glad.h>
+
+#include "occlusionculler.h"
+#include "model.h"
+
+namespace
+{
+	// Match the local sizes of buildDepthPyramid.glsl and cullInstances.glsl
+	constexpr int pyramidGroupSize = 8;
+	constexpr unsigned int cullingGroupSize = 256;
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	if (m_fence)
+		glDeleteSync(static_cast<GLsync>(m_fence));
+
+	if (m_pyramid != 0)
+		glDeleteTextures(1, &m_pyramid);
+
+	const unsigned int buffers[] = { m_sphereBuffer, m_visibleBuffer, m_commandBuffer };
+	glDeleteBuffers(3, buffers);
+}
+
+void OcclusionCuller::BuildPyramid(unsigned int depthTexture, int width, int height, const glm::mat4& viewProjection)
+{
+	if (width <= 0 || height <= 0 || !m_pyramidShader || m_pyramidShader->GetId() == 0)
+		return;
+
+	if (m_size != glm::ivec2(width, height))
+	{
+		if (m_pyramid != 0)
+			glDeleteTextures(1, &m_pyramid);
+
+		m_size = glm::ivec2(width, height);
+		m_levelsCount = std::bit_width(static_cast<unsigned int>(std::max(width, height)));
+
+		glGenTextures(1, &m_pyramid);
+		glBindTexture(GL_TEXTURE_2D, m_pyramid);
+		glTexStorage2D(GL_TEXTURE_2D, m_levelsCount, GL_R32F, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	m_pyramidShader->Use();
+
+	glActiveTexture(GL_TEXTURE0 + TextureUnit);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glActiveTexture(GL_TEXTURE0);
+	m_pyramidShader->SetInt("depthTexture", TextureUnit);
+
+	glm::ivec2 sourceSize = m_size;
+	for (int level = 0; level < m_levelsCount; level++)
+	{
+		const glm::ivec2 destinationSize = level == 0 ? m_size : glm::max(sourceSize / 2, glm::ivec2(1));
+
+		if (level > 0)
+			glBindImageTexture(0, m_pyramid, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glBindImageTexture(1, m_pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		m_pyramidShader->SetInt("fromDepth", level == 0);
+		m_pyramidShader->SetVector2("sourceSize", glm::vec2(sourceSize));
+		m_pyramidShader->SetVector2("destinationSize", glm::vec2(destinationSize));
+
+		glDispatchCompute(
+			(destinationSize.x + pyramidGroupSize - 1) / pyramidGroupSize,
+			(destinationSize.y + pyramidGroupSize - 1) / pyramidGroupSize, 1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+		sourceSize = destinationSize;
+	}
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	m_viewProjection = viewProjection;
+}
+
+void OcclusionCuller::Test(std::span<const EntityHandle> entities, std::span<const BoundingSphere> spheres)
+{
+	if (m_fence || !HasPyramid() || !m_cullingShader || m_cullingShader->GetId() == 0)
+		return;
+
+	if (m_sphereBuffer == 0)
+	{
+		glGenBuffers(1, &m_sphereBuffer);
+		glGenBuffers(1, &m_visibleBuffer);
+		glGenBuffers(1, &m_commandBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_READ);
+	}
+
+	const size_t count = spheres.size();
+	if (count > m_capacity)
+	{
+		m_capacity = std::max(count, m_capacity * 2);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_sphereBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_capacity * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_visibleBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_capacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_READ);
+	}
+
+	std::vector<glm::vec4> packed(count);
+	for (size_t i = 0; i < count; i++)
+		packed[i] = glm::vec4(spheres[i].center, spheres[i].radius);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_sphereBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(glm::vec4), packed.data());
+
+	const DrawElementsIndirectCommand command{};
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(command), &command);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// Spheres are already frustum culled, the radius is stored directly in place of the scale
+	m_cullingShader->Use();
+	m_cullingShader->SetUint("instancesCount", static_cast<unsigned int>(count));
+	m_cullingShader->SetInt("frustumCulling", false);
+	m_cullingShader->SetFloat("boundingRadius", 1.0f);
+	m_cullingShader->SetFloat("maxDistance", 0.0f);
+	m_cullingShader->SetInt("lodsCount", 1);
+	Apply(*m_cullingShader);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_sphereBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_visibleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_commandBuffer);
+
+	if (count > 0)
+		glDispatchCompute((static_cast<unsigned int>(count) + cullingGroupSize - 1) / cullingGroupSize, 1, 1);
+
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_pendingEntities.assign(entities.begin(), entities.end());
+}
+
+bool OcclusionCuller::FetchOccluded(std::vector<EntityHandle>& occluded)
+{
+	if (!m_fence)
+		return false;
+
+	const GLenum status = glClientWaitSync(static_cast<GLsync>(m_fence), 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	glDeleteSync(static_cast<GLsync>(m_fence));
+	m_fence = nullptr;
+
+	DrawElementsIndirectCommand command{};
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(command), &command);
+
+	m_visible.resize(command.instanceCount);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_visibleBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_visible.size() * sizeof(unsigned int), m_visible.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_isVisible.assign(m_pendingEntities.size(), 0);
+	for (const unsigned int index : m_visible)
+		m_isVisible[index] = 1;
+
+	occluded.clear();
+	for (size_t i = 0; i < m_pendingEntities.size(); i++)
+	{
+		if (!m_isVisible[i])
+			occluded.push_back(m_pendingEntities[i]);
+	}
+
+	return true;
+}
+
+void OcclusionCuller::Apply(ShaderProgram& cullingShader) const
+{
+	glActiveTexture(GL_TEXTURE0 + TextureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_pyramid);
+	glActiveTexture(GL_TEXTURE0);
+
+	cullingShader.SetInt("occlusionCulling", true);
+	cullingShader.SetInt("depthPyramid", TextureUnit);
+	cullingShader.SetMat4("pyramidViewProjection", m_viewProjection);
+	cullingShader.SetVector2("pyramidSize", glm::vec2(m_size));
+	cullingShader.SetInt("pyramidLevelsCount", m_levelsCount);
+}
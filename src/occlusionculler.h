@@ -0,0 +1,64 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "scene.h"
+#include "shaderprogram.h"
+
+// Hierarchical-Z occlusion culling. After the scene is drawn a pyramid of farthest depths is built
+// from the depth buffer, and the bounds of entities that passed frustum culling are tested against it
+// on the GPU. Results are read back once the GPU is done, without waiting for it, so an entity is
+// skipped from the frame after its test. The pyramid is also used by the instance culling shader.
+class OcclusionCuller
+{
+public:
+	// Texture unit the depth and pyramid textures get bound to, clear of the material maps
+	static constexpr int TextureUnit = 4;
+
+	OcclusionCuller(ShaderProgram* pyramidShader, ShaderProgram* cullingShader) :
+		m_pyramidShader(pyramidShader), m_cullingShader(cullingShader) {}
+	~OcclusionCuller();
+
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+	// depthTexture has to be a sampleable depth texture of the given size
+	void BuildPyramid(unsigned int depthTexture, int width, int height, const glm::mat4& viewProjection);
+
+	// Tests the spheres against the current pyramid. Skipped while an earlier test is still running.
+	void Test(std::span<const EntityHandle> entities, std::span<const BoundingSphere> spheres);
+	// Returns false until the last test finished, then fills occluded with the entities that failed it
+	bool FetchOccluded(std::vector<EntityHandle>& occluded);
+
+	// Sets the pyramid uniforms of a program built from cullInstances.glsl
+	void Apply(ShaderProgram& cullingShader) const;
+
+	[[nodiscard]] bool HasPyramid() const { return m_pyramid != 0; }
+	[[nodiscard]] unsigned int GetPyramidTexture() const { return m_pyramid; }
+	[[nodiscard]] int GetLevelsCount() const { return m_levelsCount; }
+	[[nodiscard]] glm::ivec2 GetSize() const { return m_size; }
+
+private:
+	ShaderProgram* m_pyramidShader;
+	ShaderProgram* m_cullingShader;
+
+	unsigned int m_pyramid = 0;
+	glm::ivec2 m_size = glm::ivec2(0);
+	int m_levelsCount = 0;
+	glm::mat4 m_viewProjection = glm::mat4(1.0f);
+
+	unsigned int m_sphereBuffer = 0;
+	unsigned int m_visibleBuffer = 0;
+	unsigned int m_commandBuffer = 0;
+	size_t m_capacity = 0;
+
+	// GLsync of the test in flight
+	void* m_fence = nullptr;
+	std::vector<EntityHandle> m_pendingEntities;
+	std::vector<unsigned int> m_visible;
+	std::vector<unsigned char> m_isVisible;
+};
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+#include <glad/glad.h>
+
+#include "profiler.h"
+
+namespace
+{
+	// Weight of the newest frame in the running averages
+	constexpr float averageWeight = 0.05f;
+
+	float UpdateAverage(float average, float value)
+	{
+		return average + (value - average) * averageWeight;
+	}
+
+	void WriteJsonString(std::ostream& stream, const std::string& value)
+	{
+		stream << '"';
+		for (const char c : value)
+		{
+			if (c == '"' || c == '\\')
+				stream << '\\';
+			stream << c;
+		}
+		stream << '"';
+	}
+}
+
+Profiler::~Profiler()
+{
+	for (FrameQueries& frameQueries : m_frameQueries)
+	{
+		if (!frameQueries.queries.empty())
+			glDeleteQueries(static_cast<GLsizei>(frameQueries.queries.size()), frameQueries.queries.data());
+	}
+}
+
+void Profiler::BeginFrame()
+{
+	m_frame++;
+	m_frameActive = m_enabled;
+	m_frameStart = Clock::now();
+	m_stack.clear();
+	m_gpuScopeOpen = false;
+
+	FrameQueries& frameQueries = m_frameQueries[m_frame % FramesInFlight];
+	ResolveQueries(frameQueries);
+	frameQueries.usedCount = 0;
+	frameQueries.frame = m_frame;
+
+	std::fill(m_cpuAccumulators.begin(), m_cpuAccumulators.end(), 0.0f);
+
+	while (!m_trace.empty() && m_trace.front().frame + TraceFrames < m_frame)
+		m_trace.pop_front();
+}
+
+void Profiler::EndFrame()
+{
+	if (!m_frameActive)
+		return;
+
+	while (!m_stack.empty())
+		EndScope();
+
+	for (size_t i = 0; i < m_scopes.size(); i++)
+	{
+		m_scopes[i].cpuMs = m_cpuAccumulators[i];
+		m_scopes[i].cpuAverageMs = UpdateAverage(m_scopes[i].cpuAverageMs, m_cpuAccumulators[i]);
+	}
+
+	float gpuFrameMs = 0.0f;
+	for (const ProfilerScope& scope : m_scopes)
+	{
+		if (scope.hasGpu && scope.depth == 0)
+			gpuFrameMs += scope.gpuMs;
+	}
+
+	m_cpuFrameTimes[m_historyOffset] = std::chrono::duration<float, std::milli>(Clock::now() - m_frameStart).count();
+	m_gpuFrameTimes[m_historyOffset] = gpuFrameMs;
+	m_historyOffset = (m_historyOffset + 1) % HistorySize;
+
+	m_frameActive = false;
+}
+
+void Profiler::BeginScope(const char* name, bool gpu)
+{
+	if (!m_frameActive)
+		return;
+
+	const unsigned int scope = FindScope(name, static_cast<unsigned int>(m_stack.size()));
+	const bool timeGpu = gpu && !m_gpuScopeOpen;
+	const Clock::time_point start = Clock::now();
+
+	if (timeGpu)
+	{
+		FrameQueries& frameQueries = m_frameQueries[m_frame % FramesInFlight];
+		if (frameQueries.usedCount == frameQueries.queries.size())
+		{
+			unsigned int query;
+			glGenQueries(1, &query);
+			frameQueries.queries.push_back(query);
+			frameQueries.scopes.push_back(0);
+			frameQueries.startsUs.push_back(0);
+		}
+
+		frameQueries.scopes[frameQueries.usedCount] = scope;
+		frameQueries.startsUs[frameQueries.usedCount] = ToTraceTime(start);
+		glBeginQuery(GL_TIME_ELAPSED, frameQueries.queries[frameQueries.usedCount]);
+		frameQueries.usedCount++;
+
+		m_scopes[scope].hasGpu = true;
+		m_gpuScopeOpen = true;
+	}
+
+	m_stack.push_back({ scope, start, timeGpu });
+}
+
+void Profiler::EndScope()
+{
+	if (!m_frameActive || m_stack.empty())
+		return;
+
+	const OpenScope open = m_stack.back();
+	m_stack.pop_back();
+
+	if (open.gpu)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_gpuScopeOpen = false;
+	}
+
+	const Clock::time_point end = Clock::now();
+	m_cpuAccumulators[open.scope] += std::chrono::duration<float, std::milli>(end - open.start).count();
+
+	const long long startUs = ToTraceTime(open.start);
+	m_trace.push_back({ open.scope, false, startUs, ToTraceTime(end) - startUs, m_frame });
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) const
+{
+	std::ofstream stream(path);
+	if (!stream.is_open())
+	{
+		std::cout << "Could not open file " << path << '\n';
+		return false;
+	}
+
+	stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	for (const TraceEvent& event : m_trace)
+	{
+		stream << ",\n{\"name\":";
+		WriteJsonString(stream, m_scopes[event.scope].name);
+		stream << ",\"cat\":\"" << (event.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (event.gpu ? 2 : 1)
+			<< ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs
+			<< ",\"args\":{\"frame\":" << event.frame << "}}";
+	}
+
+	stream << "\n]}\n";
+	return stream.good();
+}
+
+unsigned int Profiler::FindScope(const char* name, unsigned int depth)
+{
+	for (size_t i = 0; i < m_scopes.size(); i++)
+	{
+		if (m_scopes[i].depth == depth && std::strcmp(m_scopes[i].name.c_str(), name) == 0)
+			return static_cast<unsigned int>(i);
+	}
+
+	m_scopes.push_back({ .name = name, .depth = depth });
+	m_cpuAccumulators.push_back(0.0f);
+	return static_cast<unsigned int>(m_scopes.size() - 1);
+}
+
+void Profiler::ResolveQueries(FrameQueries& frameQueries)
+{
+	if (frameQueries.usedCount == 0)
+		return;
+
+	// Queries finish in order, so the last one being available means all of them are
+	GLint available = 0;
+	glGetQueryObjectiv(frameQueries.queries[frameQueries.usedCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		m_droppedGpuFrames++;
+		return;
+	}
+
+	std::vector<float> gpuMs(m_scopes.size(), -1.0f);
+	for (unsigned int i = 0; i < frameQueries.usedCount; i++)
+	{
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(frameQueries.queries[i], GL_QUERY_RESULT, &elapsed);
+
+		const unsigned int scope = frameQueries.scopes[i];
+		gpuMs[scope] = std::max(gpuMs[scope], 0.0f) + static_cast<float>(elapsed) / 1e6f;
+		m_trace.push_back({ scope, true, frameQueries.startsUs[i], static_cast<long long>(elapsed / 1000), frameQueries.frame });
+	}
+
+	for (size_t i = 0; i < m_scopes.size(); i++)
+	{
+		if (gpuMs[i] < 0.0f)
+			continue;
+
+		m_scopes[i].gpuMs = gpuMs[i];
+		m_scopes[i].gpuAverageMs = UpdateAverage(m_scopes[i].gpuAverageMs, gpuMs[i]);
+	}
+}
+
+long long Profiler::ToTraceTime(Clock::time_point time) const
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(time - m_epoch).count();
+}
+
+FrameTimeSummary SummarizeFrameTimes(std::vector<float> frameTimes)
+{
+	FrameTimeSummary summary;
+	if (frameTimes.empty())
+		return summary;
+
+	std::sort(frameTimes.begin(), frameTimes.end());
+	const auto percentile = [&](float fraction) {
+		const size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<float>(frameTimes.size())));
+		return frameTimes[std::clamp<size_t>(rank, 1, frameTimes.size()) - 1];
+	};
+
+	summary.mean = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0f) / static_cast<float>(frameTimes.size());
+	summary.min = frameTimes.front();
+	summary.p50 = percentile(0.5f);
+	summary.p95 = percentile(0.95f);
+	summary.p99 = percentile(0.99f);
+	summary.max = frameTimes.back();
+	return summary;
+}
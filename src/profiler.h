@@ -0,0 +1,152 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Timings of one named scope, aggregated over every time it ran in a frame
+struct ProfilerScope
+{
+	std::string name;
+	// Nesting level, 0 for scopes opened outside any other
+	unsigned int depth = 0;
+	float cpuMs = 0.0f;
+	float cpuAverageMs = 0.0f;
+	// Only scopes opened with gpu set and no other GPU scope open get a timer query
+	bool hasGpu = false;
+	float gpuMs = 0.0f;
+	float gpuAverageMs = 0.0f;
+};
+
+// Distribution of a run of frame times, percentiles by nearest rank
+struct FrameTimeSummary
+{
+	float mean = 0.0f;
+	float min = 0.0f;
+	float p50 = 0.0f;
+	float p95 = 0.0f;
+	float p99 = 0.0f;
+	float max = 0.0f;
+};
+
+[[nodiscard]] FrameTimeSummary SummarizeFrameTimes(std::vector<float> frameTimes);
+
+// Frame profiler for the main thread. CPU time is taken with the steady clock, GPU time
+// with GL_TIME_ELAPSED queries read back FramesInFlight frames later so the driver never
+// has to stall for them. GL only allows one such query at a time, so GPU timings are
+// limited to scopes that are not nested in another GPU scope.
+class Profiler
+{
+public:
+	static constexpr unsigned int FramesInFlight = 3;
+	// Frames kept for the frame time graph
+	static constexpr unsigned int HistorySize = 240;
+	// Frames kept for the Chrome trace
+	static constexpr unsigned int TraceFrames = 120;
+
+	Profiler() = default;
+	~Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// Reads the queries of the frame FramesInFlight frames back, if they are done, and starts a new one
+	void BeginFrame();
+	void EndFrame();
+
+	// Prefer ProfileScope over calling these directly
+	void BeginScope(const char* name, bool gpu = true);
+	void EndScope();
+
+	// Takes effect at the next BeginFrame
+	void SetEnabled(bool enabled) { m_enabled = enabled; }
+	[[nodiscard]] bool GetEnabled() const { return m_enabled; }
+
+	// Scopes in the order they were first opened, the GPU times lag FramesInFlight frames behind
+	[[nodiscard]] const std::vector<ProfilerScope>& GetScopes() const { return m_scopes; }
+
+	// Frame times in ms as rings of HistorySize values starting at GetHistoryOffset
+	[[nodiscard]] const std::vector<float>& GetCpuFrameTimes() const { return m_cpuFrameTimes; }
+	[[nodiscard]] const std::vector<float>& GetGpuFrameTimes() const { return m_gpuFrameTimes; }
+	[[nodiscard]] unsigned int GetHistoryOffset() const { return m_historyOffset; }
+	[[nodiscard]] float GetCpuFrameTime() const { return m_cpuFrameTimes[(m_historyOffset + HistorySize - 1) % HistorySize]; }
+	[[nodiscard]] float GetGpuFrameTime() const { return m_gpuFrameTimes[(m_historyOffset + HistorySize - 1) % HistorySize]; }
+	// Frames whose queries were still pending when their slot came round again
+	[[nodiscard]] unsigned int GetDroppedGpuFrames() const { return m_droppedGpuFrames; }
+
+	// Writes the events of the last TraceFrames frames in the Trace Event Format read by
+	// chrome://tracing and Perfetto. GPU events are placed at the CPU time their query started.
+	bool WriteChromeTrace(const std::string& path) const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct OpenScope
+	{
+		unsigned int scope;
+		Clock::time_point start;
+		bool gpu;
+	};
+
+	// Queries issued during one frame, reused every FramesInFlight frames
+	struct FrameQueries
+	{
+		std::vector<unsigned int> queries;
+		std::vector<unsigned int> scopes;
+		std::vector<long long> startsUs;
+		unsigned int usedCount = 0;
+		unsigned long long frame = 0;
+	};
+
+	struct TraceEvent
+	{
+		unsigned int scope;
+		bool gpu;
+		long long startUs;
+		long long durationUs;
+		unsigned long long frame;
+	};
+
+	[[nodiscard]] unsigned int FindScope(const char* name, unsigned int depth);
+	void ResolveQueries(FrameQueries& frameQueries);
+	[[nodiscard]] long long ToTraceTime(Clock::time_point time) const;
+
+	bool m_enabled = true;
+	bool m_frameActive = false;
+	unsigned long long m_frame = 0;
+	Clock::time_point m_frameStart;
+	const Clock::time_point m_epoch = Clock::now();
+
+	std::vector<ProfilerScope> m_scopes;
+	// CPU time of each scope so far this frame, published at EndFrame
+	std::vector<float> m_cpuAccumulators;
+	std::vector<OpenScope> m_stack;
+	bool m_gpuScopeOpen = false;
+
+	FrameQueries m_frameQueries[FramesInFlight];
+	unsigned int m_droppedGpuFrames = 0;
+
+	std::vector<float> m_cpuFrameTimes = std::vector<float>(HistorySize, 0.0f);
+	std::vector<float> m_gpuFrameTimes = std::vector<float>(HistorySize, 0.0f);
+	unsigned int m_historyOffset = 0;
+
+	std::deque<TraceEvent> m_trace;
+};
+
+// Times the enclosing block in the profiler
+class ProfileScope
+{
+public:
+	ProfileScope(Profiler& profiler, const char* name, bool gpu = true) : m_profiler(profiler)
+	{
+		m_profiler.BeginScope(name, gpu);
+	}
+	~ProfileScope() { m_profiler.EndScope(); }
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	Profiler& m_profiler;
+};
@@ -0,0 +1,274 @@
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "scatter.h"
+#include "frustum.h"
+#include "occlusionculler.h"
+
+namespace
+{
+	// Matches the local size of the culling shader
+	constexpr unsigned int cullingGroupSize = 256;
+}
+
+Scatter::~Scatter()
+{
+	const unsigned int buffers[] = { m_instanceBuffer, m_visibleBuffer, m_commandBuffer };
+	glDeleteBuffers(3, buffers);
+}
+
+Scatter::Scatter(Scatter&& other) noexcept :
+	m_model(other.m_model),
+	m_material(std::move(other.m_material)),
+	m_layers(std::move(other.m_layers)),
+	m_randomYaw(other.m_randomYaw),
+	m_fadeDistance(other.m_fadeDistance),
+	m_cullingShader(other.m_cullingShader),
+	m_gpuCulling(other.m_gpuCulling),
+	m_lodSelection(other.m_lodSelection),
+	m_occlusionCuller(other.m_occlusionCuller),
+	m_instanceBuffer(other.m_instanceBuffer),
+	m_instanceCount(other.m_instanceCount),
+	m_visibleBuffer(other.m_visibleBuffer),
+	m_commandBuffer(other.m_commandBuffer)
+{
+	other.m_instanceBuffer = 0;
+	other.m_instanceCount = 0;
+	other.m_visibleBuffer = 0;
+	other.m_commandBuffer = 0;
+}
+
+Scatter& Scatter::operator=(Scatter&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	const unsigned int buffers[] = { m_instanceBuffer, m_visibleBuffer, m_commandBuffer };
+	glDeleteBuffers(3, buffers);
+
+	m_model = other.m_model;
+	m_material = std::move(other.m_material);
+	m_layers = std::move(other.m_layers);
+	m_randomYaw = other.m_randomYaw;
+	m_fadeDistance = other.m_fadeDistance;
+	m_cullingShader = other.m_cullingShader;
+	m_gpuCulling = other.m_gpuCulling;
+	m_lodSelection = other.m_lodSelection;
+	m_occlusionCuller = other.m_occlusionCuller;
+	m_instanceBuffer = other.m_instanceBuffer;
+	m_instanceCount = other.m_instanceCount;
+	m_visibleBuffer = other.m_visibleBuffer;
+	m_commandBuffer = other.m_commandBuffer;
+
+	other.m_instanceBuffer = 0;
+	other.m_instanceCount = 0;
+	other.m_visibleBuffer = 0;
+	other.m_commandBuffer = 0;
+
+	return *this;
+}
+
+void Scatter::Generate(
+	glm::vec2 boundsMin, glm::vec2 boundsMax, float height,
+	unsigned int candidatesCount,
+	const DensityFunc& density,
+	glm::vec2 scaleRange,
+	unsigned int seed)
+{
+	std::cout << "Generating scatter with " << candidatesCount << " candidates\n";
+
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> xRange(boundsMin.x, boundsMax.x);
+	std::uniform_real_distribution<float> zRange(boundsMin.y, boundsMax.y);
+	std::uniform_real_distribution<float> scaleDistribution(scaleRange.x, scaleRange.y);
+	std::uniform_real_distribution<float> keepDistribution(0.0f, 1.0f);
+
+	std::vector<glm::vec4> instances;
+	instances.reserve(candidatesCount);
+
+	for (unsigned int i = 0; i < candidatesCount; i++)
+	{
+		const glm::vec2 position(xRange(gen), zRange(gen));
+		if (keepDistribution(gen) >= density(position))
+			continue;
+
+		instances.emplace_back(position.x, height, position.y, scaleDistribution(gen));
+	}
+
+	if (m_instanceBuffer == 0)
+		glGenBuffers(1, &m_instanceBuffer);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(glm::vec4), instances.data(), GL_STATIC_DRAW);
+
+	// Written by the culling pass, never touched by the CPU. Every level of detail gets room for all instances.
+	if (m_visibleBuffer == 0)
+		glGenBuffers(1, &m_visibleBuffer);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_visibleBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * m_model->GetLodsCount() * sizeof(unsigned int), nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	if (m_commandBuffer == 0)
+	{
+		glGenBuffers(1, &m_commandBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, Model::MaxLods * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	m_instanceCount = static_cast<unsigned int>(instances.size());
+
+	std::cout << "  Kept " << m_instanceCount << " instances ("
+		<< static_cast<double>(instances.size() * sizeof(glm::vec4)) / 1024.0 << "KiB)\n";
+}
+
+void Scatter::Draw(const Camera& camera,
+	const std::vector<Sun>& suns,
+	const std::vector<PointLight>& pointLights,
+	const std::vector<SpotLight>& spotLights) const
+{
+	if (!m_model || m_instanceCount == 0)
+		return;
+
+	const bool culled = m_gpuCulling && m_cullingShader && m_cullingShader->GetId() != 0;
+	if (culled)
+		Cull(&camera, Frustum::FromMatrix(camera.GetProjectionMatrix() * camera.GetMatrix()));
+
+	m_material.Use(suns, pointLights, spotLights);
+
+	ShaderProgram& shader = m_material.GetShader();
+	shader.SetInt("entityId", -1);
+	shader.SetInt("instanced", true);
+	// The instances spread over far more than one entity's light list would cover
+	shader.SetInt("entityLights", false);
+	shader.SetInt("culledInstances", culled);
+	shader.SetInt("randomYaw", m_randomYaw);
+	shader.SetVector2("fadeDistance", m_fadeDistance);
+
+	shader.SetMat4("view", camera.GetMatrix());
+	shader.SetMat4("perspective", camera.GetProjectionMatrix());
+	shader.SetVector3("cameraPosition", camera.GetPosition());
+	DrawInstances(shader, culled);
+}
+
+void Scatter::DrawShadow(const Frustum& frustum, float viewHalfHeight, glm::vec3 lightDirection, ShaderProgram& shader) const
+{
+	if (!m_model || m_instanceCount == 0 || !m_castsShadows)
+		return;
+
+	const bool culled = m_gpuCulling && m_cullingShader && m_cullingShader->GetId() != 0;
+	if (culled)
+		Cull(nullptr, frustum, viewHalfHeight);
+
+	m_material.UseShadow(shader);
+	shader.SetInt("instanced", true);
+	shader.SetInt("culledInstances", culled);
+	shader.SetInt("randomYaw", m_randomYaw);
+	shader.SetVector2("fadeDistance", glm::vec2(0.0f));
+
+	// Billboards turn towards the camera position, put it far away in the light's direction
+	shader.SetVector3("cameraPosition", -glm::normalize(lightDirection) * 1e6f);
+	DrawInstances(shader, culled);
+}
+
+void Scatter::DrawInstances(ShaderProgram& shader, bool culled) const
+{
+	m_model->ApplyVertexFormat(shader);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer);
+	if (culled)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_visibleBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	}
+
+	for (const glm::vec3& rotation : m_layers)
+	{
+		const glm::mat4 layerMatrix =
+			glm::rotate(
+				glm::rotate(
+					glm::rotate(
+						glm::mat4(1.0f),
+						glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f)),
+					glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f)),
+				glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+
+		shader.SetMat4("model", layerMatrix);
+		shader.SetMat3("normalMatrix", glm::mat3(layerMatrix));
+		if (culled)
+		{
+			for (unsigned int lod = 0; lod < GetLodsCount(); lod++)
+			{
+				shader.SetUint("instanceOffset", lod * m_instanceCount);
+				m_model->DrawIndirect(lod);
+			}
+		}
+		else
+		{
+			m_model->DrawInstanced(m_instanceCount);
+		}
+	}
+
+	if (culled)
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	// Leave the shared shader in the state regular entities expect
+	shader.SetInt("instanced", false);
+	shader.SetInt("culledInstances", false);
+	shader.SetUint("instanceOffset", 0);
+	shader.SetVector2("fadeDistance", glm::vec2(0.0f));
+}
+
+void Scatter::Cull(const Camera* camera, const Frustum& frustum, float orthographicHalfHeight) const
+{
+	// Every layer shares the same instances, so one command per level of detail serves all of them
+	const unsigned int lodsCount = GetLodsCount();
+	DrawElementsIndirectCommand commands[Model::MaxLods]{};
+	for (unsigned int lod = 0; lod < lodsCount; lod++)
+	{
+		const ModelLod& range = m_model->GetLod(lod);
+		commands[lod] = { range.indicesCount, 0, range.firstIndex, range.baseVertex, 0 };
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, lodsCount * sizeof(DrawElementsIndirectCommand), commands);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	// Layers, billboarding and random yaw all rotate around the instance origin
+	const BoundingSphere& sphere = m_model->GetBoundingSphere();
+	const float boundingRadius = glm::length(sphere.center) + sphere.radius;
+
+	m_cullingShader->Use();
+	m_cullingShader->SetUint("instancesCount", m_instanceCount);
+	m_cullingShader->SetInt("frustumCulling", true);
+	m_cullingShader->SetVector3("cameraPosition", camera ? camera->GetPosition() : glm::vec3(0.0f));
+	m_cullingShader->SetFloat("boundingRadius", boundingRadius);
+	m_cullingShader->SetFloat("maxDistance", camera ? m_fadeDistance.y : 0.0f);
+	for (int i = 0; i < Frustum::PlanesCount; i++)
+		m_cullingShader->SetVector4("frustumPlanes[" + std::to_string(i) + "]", frustum.planes[i]);
+
+	m_cullingShader->SetInt("lodsCount", static_cast<int>(lodsCount));
+	m_cullingShader->SetFloat("projectedSizeScale", camera ? camera->GetProjectedSizeScale() : 0.0f);
+	m_cullingShader->SetFloat("orthographicHalfHeight", camera ? 0.0f : orthographicHalfHeight);
+	for (unsigned int lod = 0; lod < lodsCount; lod++)
+		m_cullingShader->SetFloat("lodScreenSizes[" + std::to_string(lod) + "]", m_model->GetLod(lod).screenSize);
+
+	if (camera && m_occlusionCuller && m_occlusionCuller->HasPyramid())
+		m_occlusionCuller->Apply(*m_cullingShader);
+	else
+		m_cullingShader->SetInt("occlusionCulling", false);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_visibleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_commandBuffer);
+
+	glDispatchCompute((m_instanceCount + cullingGroupSize - 1) / cullingGroupSize, 1, 1);
+
+	// The vertex shader reads the indices and the draw reads the command
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
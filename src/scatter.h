@@ -0,0 +1,106 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "material.h"
+#include "model.h"
+#include "sun.h"
+#include "pointlight.h"
+#include "spotlight.h"
+#include "camera.h"
+#include "frustum.h"
+
+class OcclusionCuller;
+
+// Large sets of a single model (grass, trees...) drawn with one instanced call per layer.
+// Every instance is a single vec4 on the GPU: world position and uniform scale.
+// With a culling shader set, instances are culled on the GPU every frame and drawn
+// indirectly, so the CPU cost does not depend on the instance count.
+class Scatter
+{
+public:
+	// Returns the probability in [0, 1] of keeping an instance at the given xz position
+	using DensityFunc = std::function<float(glm::vec2 position)>;
+
+	explicit Scatter(const Model* model, Material material) :
+		m_model(model), m_material(std::move(material)) {}
+	~Scatter();
+
+	Scatter(const Scatter&) = delete;
+	Scatter& operator=(const Scatter&) = delete;
+	Scatter(Scatter&& other) noexcept;
+	Scatter& operator=(Scatter&& other) noexcept;
+
+	void Generate(
+		glm::vec2 boundsMin, glm::vec2 boundsMax, float height,
+		unsigned int candidatesCount,
+		const DensityFunc& density,
+		glm::vec2 scaleRange = glm::vec2(1.0f),
+		unsigned int seed = 0);
+
+	void Draw(const Camera& camera,
+		const std::vector<Sun>& suns,
+		const std::vector<PointLight>& pointLights,
+		const std::vector<SpotLight>& spotLights) const;
+
+	// Draws the depth of the instances inside the frustum of an orthographic view with a shadow map
+	// program, culled on the GPU like Draw without the occlusion test. Levels of detail follow the size
+	// over the view's half height, billboards face lightDirection and nothing fades out, so the result
+	// doesn't depend on the camera and can be cached. See ShadowCascades.
+	void DrawShadow(const Frustum& frustum, float viewHalfHeight, glm::vec3 lightDirection, ShaderProgram& shader) const;
+
+	// Small dense instances like grass cost more to draw into the shadow maps than they add
+	void SetCastsShadows(bool castsShadows) { m_castsShadows = castsShadows; }
+	[[nodiscard]] bool GetCastsShadows() const { return m_castsShadows; }
+
+	// Each layer draws every instance again with its own base rotation, e.g. crossed grass quads
+	void SetLayers(std::vector<glm::vec3> rotations) { m_layers = std::move(rotations); }
+	[[nodiscard]] const std::vector<glm::vec3>& GetLayers() const { return m_layers; }
+
+	void SetRandomYaw(bool randomYaw) { m_randomYaw = randomYaw; }
+	[[nodiscard]] bool GetRandomYaw() const { return m_randomYaw; }
+
+	// Instances dither out between start and end distance from the camera
+	void SetFadeDistance(float start, float end) { m_fadeDistance = glm::vec2(start, end); }
+	[[nodiscard]] glm::vec2 GetFadeDistance() const { return m_fadeDistance; }
+
+	[[nodiscard]] unsigned int GetInstanceCount() const { return m_instanceCount; }
+
+	void SetCullingShader(ShaderProgram* cullingShader) { m_cullingShader = cullingShader; }
+	void SetGpuCulling(bool gpuCulling) { m_gpuCulling = gpuCulling; }
+	[[nodiscard]] bool GetGpuCulling() const { return m_gpuCulling; }
+	// Culled instances are drawn with the model level matching their projected size, without
+	// hysteresis since the culling pass keeps no state between frames
+	void SetLodSelection(bool lodSelection) { m_lodSelection = lodSelection; }
+	[[nodiscard]] bool GetLodSelection() const { return m_lodSelection; }
+	// Also tests instances against the occlusion culler's last depth pyramid, null disables it
+	void SetOcclusionCuller(const OcclusionCuller* occlusionCuller) { m_occlusionCuller = occlusionCuller; }
+
+private:
+	// The camera picks the levels of detail and fading and occlusion only apply to its view. Without
+	// one the levels follow the size over orthographicHalfHeight.
+	void Cull(const Camera* camera, const Frustum& frustum, float orthographicHalfHeight = 0.0f) const;
+	void DrawInstances(ShaderProgram& shader, bool culled) const;
+	[[nodiscard]] unsigned int GetLodsCount() const { return m_lodSelection ? m_model->GetLodsCount() : 1; }
+
+	const Model* m_model;
+	Material m_material;
+
+	std::vector<glm::vec3> m_layers = { glm::vec3(0.0f) };
+	bool m_randomYaw = false;
+	glm::vec2 m_fadeDistance{};
+
+	ShaderProgram* m_cullingShader = nullptr;
+	bool m_gpuCulling = true;
+	bool m_lodSelection = true;
+	bool m_castsShadows = true;
+	const OcclusionCuller* m_occlusionCuller = nullptr;
+
+	unsigned int m_instanceBuffer = 0;
+	unsigned int m_instanceCount = 0;
+	unsigned int m_visibleBuffer = 0;
+	unsigned int m_commandBuffer = 0;
+};
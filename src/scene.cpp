@@ -0,0 +1,567 @@
+#include <algorithm>
+#include <iostream>
+
+#include "scene.h"
+#include "entitylights.h"
+#include "threadpool.h"
+
+unsigned int Scene::AllocateSlot()
+{
+	unsigned int slotIndex;
+	if (!m_freeSlots.empty())
+	{
+		slotIndex = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		if (m_slots.size() >= MaxEntities)
+		{
+			std::cout << "Scene is full, can't add more than " << MaxEntities << " entities\n";
+			return EntityHandle::InvalidValue;
+		}
+
+		slotIndex = static_cast<unsigned int>(m_slots.size());
+		m_slots.push_back({ .denseIndex = 0, .generation = 0 });
+	}
+
+	m_slots[slotIndex].denseIndex = static_cast<unsigned int>(m_entities.size());
+	m_denseToSlot.push_back(slotIndex);
+	m_hierarchy.Add(slotIndex);
+	if (slotIndex >= m_occluded.size())
+		m_occluded.resize(slotIndex + 1);
+	m_occluded[slotIndex] = 0;
+	// Bounds are filled in once the world matrix is known
+	m_bvh.Add(slotIndex, {});
+	m_culler.Resize(m_denseToSlot.size());
+
+	return slotIndex;
+}
+
+EntityHandle Scene::Add(Entity entity)
+{
+	const unsigned int slotIndex = AllocateSlot();
+	if (slotIndex == EntityHandle::InvalidValue)
+		return {};
+
+	Entity& added = m_entities.emplace_back(std::move(entity));
+	m_hierarchy.SetLocal(slotIndex, added.GetLocalMatrix());
+	added.ClearTransformDirty();
+
+	return EntityHandle::Create(slotIndex, m_slots[slotIndex].generation);
+}
+
+std::vector<EntityHandle> Scene::SpawnMany(
+	const Entity& prototype, size_t count,
+	const std::function<void(Entity& entity, size_t index)>& init)
+{
+	std::vector<EntityHandle> handles;
+	handles.reserve(count);
+
+	// Grown geometrically, so repeated small batches don't reallocate the entities every call
+	const size_t required = m_entities.size() + count;
+	if (required > m_entities.capacity())
+		Reserve(std::max(required, 2 * m_entities.capacity()));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const unsigned int slotIndex = AllocateSlot();
+		if (slotIndex == EntityHandle::InvalidValue)
+			break;
+
+		Entity& entity = m_entities.emplace_back(prototype);
+		if (init)
+			init(entity, i);
+
+		m_hierarchy.SetLocal(slotIndex, entity.GetLocalMatrix());
+		entity.ClearTransformDirty();
+
+		handles.push_back(EntityHandle::Create(slotIndex, m_slots[slotIndex].generation));
+	}
+
+	return handles;
+}
+
+void Scene::Reserve(size_t count)
+{
+	m_entities.reserve(count);
+	m_denseToSlot.reserve(count);
+
+	const size_t newSlots = count > m_entities.size() + m_freeSlots.size() ?
+		count - m_entities.size() - m_freeSlots.size() : 0;
+	m_slots.reserve(m_slots.size() + newSlots);
+}
+
+void Scene::Remove(EntityHandle handle)
+{
+	if (!IsValid(handle))
+		return;
+
+	Slot& slot = m_slots[handle.Index()];
+	const unsigned int removedIndex = slot.denseIndex;
+
+	// Children move up to the grandparent, take over the removed transform so they stay in place
+	const glm::mat4 removedLocal = m_entities[removedIndex].GetLocalMatrix();
+	m_hierarchy.ForEachChild(handle.Index(), [&](unsigned int child) {
+		Entity& entity = m_entities[m_slots[child].denseIndex];
+		entity.SetLocalMatrix(removedLocal * entity.GetLocalMatrix());
+	});
+
+	const unsigned int lastIndex = static_cast<unsigned int>(m_entities.size() - 1);
+
+	if (removedIndex != lastIndex)
+	{
+		m_entities[removedIndex] = std::move(m_entities[lastIndex]);
+		m_denseToSlot[removedIndex] = m_denseToSlot[lastIndex];
+		m_slots[m_denseToSlot[removedIndex]].denseIndex = removedIndex;
+		m_culler.Set(removedIndex, m_culler.Get(lastIndex));
+	}
+
+	m_entities.pop_back();
+	m_denseToSlot.pop_back();
+	m_culler.Resize(lastIndex);
+
+	slot.generation = (slot.generation + 1) & EntityHandle::GenerationMask;
+	m_freeSlots.push_back(handle.Index());
+	m_hierarchy.Remove(handle.Index());
+	m_bvh.Remove(handle.Index());
+	m_staticGeometryVersion++;
+}
+
+void Scene::Remove(std::span<const EntityHandle> handles)
+{
+	for (const EntityHandle handle : handles)
+		Remove(handle);
+}
+
+void Scene::Clear()
+{
+	for (unsigned int slotIndex : m_denseToSlot)
+	{
+		Slot& slot = m_slots[slotIndex];
+		slot.generation = (slot.generation + 1) & EntityHandle::GenerationMask;
+		m_freeSlots.push_back(slotIndex);
+		m_hierarchy.Remove(slotIndex);
+		m_bvh.Remove(slotIndex);
+	}
+
+	m_entities.clear();
+	m_denseToSlot.clear();
+	m_culler.Resize(0);
+	m_staticGeometryVersion++;
+}
+
+bool Scene::IsValid(EntityHandle handle) const
+{
+	if (handle.IsNull() || handle.Index() >= m_slots.size())
+		return false;
+
+	const Slot& slot = m_slots[handle.Index()];
+	return slot.generation == handle.Generation() &&
+		slot.denseIndex < m_denseToSlot.size() &&
+		m_denseToSlot[slot.denseIndex] == handle.Index();
+}
+
+Entity* Scene::Get(EntityHandle handle)
+{
+	return IsValid(handle) ? &m_entities[m_slots[handle.Index()].denseIndex] : nullptr;
+}
+
+const Entity* Scene::Get(EntityHandle handle) const
+{
+	return IsValid(handle) ? &m_entities[m_slots[handle.Index()].denseIndex] : nullptr;
+}
+
+EntityHandle Scene::GetHandle(size_t index) const
+{
+	if (index >= m_entities.size())
+		return {};
+
+	const unsigned int slotIndex = m_denseToSlot[index];
+	return EntityHandle::Create(slotIndex, m_slots[slotIndex].generation);
+}
+
+int Scene::IndexOf(EntityHandle handle) const
+{
+	return IsValid(handle) ? static_cast<int>(m_slots[handle.Index()].denseIndex) : -1;
+}
+
+bool Scene::SetParent(EntityHandle child, EntityHandle parent)
+{
+	if (!IsValid(child) || (!parent.IsNull() && !IsValid(parent)))
+		return false;
+
+	return m_hierarchy.SetParent(child.Index(),
+		parent.IsNull() ? TransformHierarchy::NoParent : parent.Index());
+}
+
+EntityHandle Scene::GetParent(EntityHandle child) const
+{
+	if (!IsValid(child))
+		return {};
+
+	const unsigned int parentSlot = m_hierarchy.GetParent(child.Index());
+	if (parentSlot == TransformHierarchy::NoParent)
+		return {};
+
+	return EntityHandle::Create(parentSlot, m_slots[parentSlot].generation);
+}
+
+void Scene::QueryFrustum(const Frustum& frustum, std::vector<EntityHandle>& entities) const
+{
+	std::vector<unsigned int> slots;
+	m_bvh.QueryFrustum(frustum, slots);
+	AppendHandles(slots, entities);
+}
+
+void Scene::QuerySphere(const BoundingSphere& sphere, std::vector<EntityHandle>& entities) const
+{
+	std::vector<unsigned int> slots;
+	m_bvh.QuerySphere(sphere, slots);
+	AppendHandles(slots, entities);
+}
+
+void Scene::QueryBox(const BoundingBox& box, std::vector<EntityHandle>& entities) const
+{
+	std::vector<unsigned int> slots;
+	m_bvh.QueryBox(box, slots);
+	AppendHandles(slots, entities);
+}
+
+SceneRayHit Scene::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const
+{
+	const Bvh::RayHit hit = m_bvh.Raycast(origin, direction, maxDistance, [this](unsigned int slotIndex) {
+		return m_entities[m_slots[slotIndex].denseIndex].GetModel() != nullptr;
+	});
+
+	if (hit.item == Bvh::NoItem)
+		return {};
+
+	return { EntityHandle::Create(hit.item, m_slots[hit.item].generation), hit.distance };
+}
+
+void Scene::AppendHandles(const std::vector<unsigned int>& slots, std::vector<EntityHandle>& entities) const
+{
+	entities.reserve(entities.size() + slots.size());
+	for (const unsigned int slotIndex : slots)
+		entities.push_back(EntityHandle::Create(slotIndex, m_slots[slotIndex].generation));
+}
+
+void Scene::Update(float deltaTime)
+{
+	for (Entity& entity : m_entities)
+		entity.Update(deltaTime);
+
+	for (size_t i = 0; i < m_entities.size(); i++)
+	{
+		Entity& entity = m_entities[i];
+		if (!entity.GetIsTransformDirty())
+			continue;
+
+		m_hierarchy.SetLocal(m_denseToSlot[i], entity.GetLocalMatrix());
+		entity.ClearTransformDirty();
+	}
+
+	m_hierarchy.Update(&ThreadPool::Shared());
+
+	// Entities moved by a dynamic ancestor count as dynamic too, they move every frame all the same
+	m_dynamic.resize(m_slots.size(), 0);
+	bool staticGeometryChanged = false;
+	for (size_t i = 0; i < m_entities.size(); i++)
+	{
+		const unsigned int slotIndex = m_denseToSlot[i];
+		const bool dynamic = HasDynamicAncestry(slotIndex);
+		if (dynamic != static_cast<bool>(m_dynamic[slotIndex]))
+		{
+			m_dynamic[slotIndex] = dynamic;
+			staticGeometryChanged = true;
+		}
+
+		if (!m_hierarchy.WasUpdated(slotIndex))
+			continue;
+
+		m_entities[i].SetWorldMatrix(m_hierarchy.GetWorld(slotIndex));
+		m_culler.Set(i, ComputeWorldSphere(m_entities[i]));
+		m_bvh.SetBounds(slotIndex, ComputeWorldBox(m_entities[i]));
+		staticGeometryChanged = staticGeometryChanged || !dynamic;
+	}
+
+	if (staticGeometryChanged)
+		m_staticGeometryVersion++;
+
+	m_bvh.Update();
+}
+
+bool Scene::GetIsDynamic(EntityHandle handle) const
+{
+	return IsValid(handle) && handle.Index() < m_dynamic.size() && m_dynamic[handle.Index()];
+}
+
+bool Scene::HasDynamicAncestry(unsigned int slotIndex) const
+{
+	for (unsigned int slot = slotIndex; slot != TransformHierarchy::NoParent; slot = m_hierarchy.GetParent(slot))
+	{
+		if (m_entities[m_slots[slot].denseIndex].GetIsDynamic())
+			return true;
+	}
+
+	return false;
+}
+
+void Scene::Draw(const Camera& camera,
+	const std::vector<Sun>& suns,
+	const std::vector<PointLight>& pointLights,
+	const std::vector<SpotLight>& spotLights)
+{
+	m_stats = {};
+	m_occlusionCandidates.clear();
+	m_occlusionCandidateSpheres.clear();
+	m_drawList.clear();
+
+	const auto collectEntity = [&](size_t index) {
+		Entity& entity = m_entities[index];
+		const Model* model = entity.GetModel();
+		if (!model)
+			return;
+
+		const EntityHandle handle = GetHandle(index);
+		if (m_occlusionCulling)
+		{
+			m_occlusionCandidates.push_back(handle);
+			m_occlusionCandidateSpheres.push_back(m_culler.Get(index));
+
+			if (m_occluded[handle.Index()])
+			{
+				m_stats.occludedEntities++;
+				return;
+			}
+		}
+
+		if (m_lodSelection)
+		{
+			const BoundingSphere& sphere = m_culler.Get(index);
+			entity.SetLod(model->SelectLod(camera.ProjectedSize(sphere.center, sphere.radius), entity.GetLod()));
+		}
+		else
+		{
+			entity.SetLod(0);
+		}
+
+		m_drawList.push_back(static_cast<unsigned int>(index));
+	};
+
+	const Frustum frustum = Frustum::FromMatrix(camera.GetProjectionMatrix() * camera.GetMatrix());
+
+	if (!m_frustumCulling)
+	{
+		for (size_t i = 0; i < m_entities.size(); i++)
+			collectEntity(i);
+	}
+	else if (m_cullingMethod == CullingMethod::Bvh)
+	{
+		m_visible.clear();
+		m_bvh.QueryFrustum(frustum, m_visible);
+
+		// Back to dense order so consecutive draws keep sharing bound state
+		for (unsigned int& index : m_visible)
+			index = m_slots[index].denseIndex;
+		std::sort(m_visible.begin(), m_visible.end());
+
+		for (const unsigned int index : m_visible)
+			collectEntity(index);
+	}
+	else
+	{
+		m_culler.Cull(frustum, m_visible, &ThreadPool::Shared());
+
+		for (const unsigned int index : m_visible)
+		{
+			// The sphere pass is coarse, the box is tighter for long and flat models
+			if (!IsBoxVisible(m_entities[index], frustum))
+				continue;
+
+			collectEntity(index);
+		}
+	}
+
+	if (m_meshletCulling)
+		CullMeshlets(camera, frustum);
+	else
+		m_meshletBatches.clear();
+
+	// Batches are in draw list order, at most one per entry
+	size_t batchIndex = 0;
+	for (size_t i = 0; i < m_drawList.size(); i++)
+	{
+		const Entity& entity = m_entities[m_drawList[i]];
+		const int id = GetHandle(m_drawList[i]).ToId();
+		if (m_entityLights)
+			m_entityLights->Apply(entity.GetMaterial().GetShader(), m_drawList[i]);
+
+		if (batchIndex < m_meshletBatches.size() && m_meshletBatches[batchIndex].drawListIndex == i)
+		{
+			const MeshletBatch& batch = m_meshletBatches[batchIndex++];
+			if (batch.commandsCount == 0)
+				continue;
+
+			const std::span<const DrawElementsIndirectCommand> commands(m_meshletCommands.data() + batch.firstCommand, batch.commandsCount);
+			entity.Draw(camera, suns, pointLights, spotLights, id, commands);
+
+			m_stats.drawnEntities++;
+			for (const DrawElementsIndirectCommand& command : commands)
+				m_stats.drawnTriangles += command.count / 3;
+			continue;
+		}
+
+		entity.Draw(camera, suns, pointLights, spotLights, id);
+		m_stats.drawnEntities++;
+		m_stats.drawnTriangles += entity.GetModel()->GetTrianglesCount(entity.GetLod());
+	}
+
+	// Entities without a model are never tested, ones whose meshlets were all culled count as culled
+	const size_t modelsCount = std::count_if(m_entities.begin(), m_entities.end(),
+		[](const Entity& entity) { return entity.GetModel() != nullptr; });
+	m_stats.culledEntities = static_cast<unsigned int>(modelsCount) - m_stats.drawnEntities - m_stats.occludedEntities;
+}
+
+void Scene::DrawHighlights(const Camera& camera) const
+{
+	for (const unsigned int index : m_drawList)
+		m_entities[index].DrawHighlight(camera);
+}
+
+void Scene::CullMeshlets(const Camera& camera, const Frustum& frustum)
+{
+	// One flat list over every meshlet of the drawn entities, so the threads share the work
+	// evenly whether it's one huge mesh or many small ones
+	m_meshletBatches.clear();
+	size_t meshletsCount = 0;
+	for (size_t i = 0; i < m_drawList.size(); i++)
+	{
+		const Entity& entity = m_entities[m_drawList[i]];
+		const std::span<const Meshlet> meshlets = entity.GetModel()->GetMeshlets(entity.GetLod());
+		if (meshlets.empty())
+			continue;
+
+		MeshletBatch batch;
+		batch.drawListIndex = i;
+		batch.firstVisibility = meshletsCount;
+		batch.meshlets = meshlets;
+		batch.view = MeshletCullView::Create(frustum, camera.GetPosition(), entity.GetWorldMatrix());
+		batch.baseVertex = entity.GetModel()->GetLod(entity.GetLod()).baseVertex;
+		m_meshletBatches.push_back(batch);
+
+		meshletsCount += meshlets.size();
+	}
+
+	if (m_meshletBatches.empty())
+		return;
+
+	m_meshletVisibility.resize(meshletsCount);
+	ThreadPool::Shared().ParallelFor(meshletsCount, 1024, [&](size_t begin, size_t end) {
+		auto batch = std::upper_bound(m_meshletBatches.begin(), m_meshletBatches.end(), begin,
+			[](size_t index, const MeshletBatch& b) { return index < b.firstVisibility; }) - 1;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			while (i >= batch->firstVisibility + batch->meshlets.size())
+				++batch;
+
+			m_meshletVisibility[i] = !batch->view.IsCulled(batch->meshlets[i - batch->firstVisibility]);
+		}
+	});
+
+	// Visible neighbours are also neighbours in the index buffer, so runs of them merge into one command
+	m_meshletCommands.clear();
+	for (MeshletBatch& batch : m_meshletBatches)
+	{
+		batch.firstCommand = m_meshletCommands.size();
+
+		for (size_t i = 0; i < batch.meshlets.size(); i++)
+		{
+			const Meshlet& meshlet = batch.meshlets[i];
+			if (!m_meshletVisibility[batch.firstVisibility + i])
+			{
+				m_stats.culledMeshlets++;
+				continue;
+			}
+
+			m_stats.drawnMeshlets++;
+			if (m_meshletCommands.size() > batch.firstCommand)
+			{
+				DrawElementsIndirectCommand& last = m_meshletCommands.back();
+				if (last.firstIndex + last.count == meshlet.firstIndex)
+				{
+					last.count += meshlet.indicesCount;
+					continue;
+				}
+			}
+
+			m_meshletCommands.push_back({ meshlet.indicesCount, 1, meshlet.firstIndex, batch.baseVertex, 0 });
+		}
+
+		batch.commandsCount = m_meshletCommands.size() - batch.firstCommand;
+	}
+}
+
+void Scene::SetOcclusionCulling(bool occlusionCulling)
+{
+	m_occlusionCulling = occlusionCulling;
+	std::fill(m_occluded.begin(), m_occluded.end(), 0);
+}
+
+void Scene::SetOccludedEntities(std::span<const EntityHandle> occluded)
+{
+	std::fill(m_occluded.begin(), m_occluded.end(), 0);
+	for (const EntityHandle handle : occluded)
+	{
+		if (IsValid(handle))
+			m_occluded[handle.Index()] = 1;
+	}
+}
+
+BoundingSphere Scene::ComputeWorldSphere(const Entity& entity)
+{
+	const Model* model = entity.GetModel();
+	if (!model)
+		return {};
+
+	const glm::mat4& world = entity.GetWorldMatrix();
+	BoundingSphere sphere = TransformBoundingSphere(model->GetBoundingSphere(), world);
+
+	if (entity.GetMaterial().GetBillboard())
+	{
+		// The shader spins the mesh around its origin, so the bounds have to cover every yaw
+		const glm::vec3 origin(world[3]);
+		sphere.radius += glm::distance(sphere.center, origin);
+		sphere.center = origin;
+	}
+
+	return sphere;
+}
+
+BoundingBox Scene::ComputeWorldBox(const Entity& entity)
+{
+	const Model* model = entity.GetModel();
+	if (!model)
+	{
+		const glm::vec3 origin(entity.GetWorldMatrix()[3]);
+		return { origin, origin };
+	}
+
+	if (entity.GetMaterial().GetBillboard())
+	{
+		const BoundingSphere sphere = ComputeWorldSphere(entity);
+		return { sphere.center - glm::vec3(sphere.radius), sphere.center + glm::vec3(sphere.radius) };
+	}
+
+	return TransformBoundingBox(model->GetBoundingBox(), entity.GetWorldMatrix());
+}
+
+bool Scene::IsBoxVisible(const Entity& entity, const Frustum& frustum)
+{
+	if (!entity.GetModel() || entity.GetMaterial().GetBillboard())
+		return true;
+
+	return frustum.Intersects(TransformBoundingBox(entity.GetModel()->GetBoundingBox(), entity.GetWorldMatrix()));
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "entity.h"
+#include "transformhierarchy.h"
+#include "frustum.h"
+#include "bvh.h"
+#include "meshlets.h"
+#include "sphereculler.h"
+
+class EntityLights;
+
+// Stable reference to an entity in a Scene. The generation is bumped every time a slot
+// is reused, so handles to removed entities never resolve to their replacement.
+struct EntityHandle
+{
+	static constexpr unsigned int IndexBits = 20;
+	static constexpr unsigned int GenerationBits = 11;
+	static constexpr unsigned int IndexMask = (1u << IndexBits) - 1;
+	static constexpr unsigned int GenerationMask = (1u << GenerationBits) - 1;
+	static constexpr unsigned int InvalidValue = ~0u;
+
+	unsigned int value = InvalidValue;
+
+	static EntityHandle Create(unsigned int index, unsigned int generation)
+	{
+		return { (index & IndexMask) | ((generation & GenerationMask) << IndexBits) };
+	}
+
+	// Ids are always non-negative so -1 can keep meaning "nothing" in the entity id attachment
+	static EntityHandle FromId(int id) { return id < 0 ? EntityHandle{} : EntityHandle{ static_cast<unsigned int>(id) }; }
+	[[nodiscard]] int ToId() const { return IsNull() ? -1 : static_cast<int>(value); }
+
+	[[nodiscard]] unsigned int Index() const { return value & IndexMask; }
+	[[nodiscard]] unsigned int Generation() const { return (value >> IndexBits) & GenerationMask; }
+	[[nodiscard]] bool IsNull() const { return value == InvalidValue; }
+
+	bool operator==(const EntityHandle& other) const = default;
+};
+
+struct SceneRayHit
+{
+	EntityHandle entity;
+	float distance = 0.0f;
+};
+
+struct SceneStats
+{
+	unsigned int drawnEntities = 0;
+	unsigned int culledEntities = 0;
+	unsigned int occludedEntities = 0;
+	unsigned long long drawnTriangles = 0;
+	unsigned int drawnMeshlets = 0;
+	unsigned int culledMeshlets = 0;
+};
+
+// Owns all entities. Entities are kept densely packed for iteration and addressed through
+// a generational slot map, so removal is a swap-and-pop and handles stay valid.
+// World transforms are propagated through a TransformHierarchy keyed by slot index.
+class Scene
+{
+public:
+	static constexpr unsigned int MaxEntities = EntityHandle::IndexMask;
+
+	enum class CullingMethod { Spheres, Bvh };
+
+	EntityHandle Add(Entity entity);
+	// Copy constructs count entities from the prototype directly in the scene storage.
+	// init is called for every new entity with its position in the batch.
+	std::vector<EntityHandle> SpawnMany(
+		const Entity& prototype, size_t count,
+		const std::function<void(Entity& entity, size_t index)>& init = {});
+	void Reserve(size_t count);
+	void Remove(EntityHandle handle);
+	void Remove(std::span<const EntityHandle> handles);
+	void Clear();
+
+	[[nodiscard]] bool IsValid(EntityHandle handle) const;
+	[[nodiscard]] Entity* Get(EntityHandle handle);
+	[[nodiscard]] const Entity* Get(EntityHandle handle) const;
+
+	// Dense index access, only valid until the next Add/Remove
+	[[nodiscard]] size_t Size() const { return m_entities.size(); }
+	[[nodiscard]] Entity& GetByIndex(size_t index) { return m_entities[index]; }
+	[[nodiscard]] EntityHandle GetHandle(size_t index) const;
+	[[nodiscard]] int IndexOf(EntityHandle handle) const;
+
+	// Parents a child to another entity, or detaches it with a null parent handle.
+	// Returns false if either handle is invalid or the change would create a cycle.
+	// Children of a removed entity are attached to its parent.
+	bool SetParent(EntityHandle child, EntityHandle parent);
+	[[nodiscard]] EntityHandle GetParent(EntityHandle child) const;
+
+	// Spatial queries against the world bounds as of the last Update
+	void QueryFrustum(const Frustum& frustum, std::vector<EntityHandle>& entities) const;
+	void QuerySphere(const BoundingSphere& sphere, std::vector<EntityHandle>& entities) const;
+	void QueryBox(const BoundingBox& box, std::vector<EntityHandle>& entities) const;
+	// Closest entity with a model whose world box is hit, the entity is null on a miss
+	[[nodiscard]] SceneRayHit Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+
+	void Update(float deltaTime);
+	void Draw(const Camera& camera,
+		const std::vector<Sun>& suns,
+		const std::vector<PointLight>& pointLights,
+		const std::vector<SpotLight>& spotLights);
+	// Outlines the highlighted entities of the last Draw. The outline writes depth 0, so call it after
+	// the depth buffer was read for occlusion culling.
+	void DrawHighlights(const Camera& camera) const;
+
+	void SetFrustumCulling(bool frustumCulling) { m_frustumCulling = frustumCulling; }
+	[[nodiscard]] bool GetFrustumCulling() const { return m_frustumCulling; }
+	void SetCullingMethod(CullingMethod cullingMethod) { m_cullingMethod = cullingMethod; }
+	[[nodiscard]] CullingMethod GetCullingMethod() const { return m_cullingMethod; }
+	[[nodiscard]] SphereCuller& GetCuller() { return m_culler; }
+	[[nodiscard]] const SphereCuller& GetCuller() const { return m_culler; }
+	[[nodiscard]] const Bvh& GetBvh() const { return m_bvh; }
+
+	// Entities draw the model level matching their projected size, otherwise always the full mesh
+	void SetLodSelection(bool lodSelection) { m_lodSelection = lodSelection; }
+	[[nodiscard]] bool GetLodSelection() const { return m_lodSelection; }
+
+	// Models loaded with meshlets only draw the ones inside the frustum and facing the camera
+	void SetMeshletCulling(bool meshletCulling) { m_meshletCulling = meshletCulling; }
+	[[nodiscard]] bool GetMeshletCulling() const { return m_meshletCulling; }
+
+	// Entities marked occluded are skipped while occlusion culling is on. Every Draw collects the
+	// entities that passed frustum culling, occluded or not, so they can be tested again.
+	void SetOcclusionCulling(bool occlusionCulling);
+	[[nodiscard]] bool GetOcclusionCulling() const { return m_occlusionCulling; }
+	void SetOccludedEntities(std::span<const EntityHandle> occluded);
+	[[nodiscard]] const std::vector<EntityHandle>& GetOcclusionCandidates() const { return m_occlusionCandidates; }
+	[[nodiscard]] const std::vector<BoundingSphere>& GetOcclusionCandidateSpheres() const { return m_occlusionCandidateSpheres; }
+
+	// Changes whenever an entity is added, removed, moved while static or turns static or dynamic,
+	// so caches of the static geometry like ShadowCascades know to redraw
+	[[nodiscard]] unsigned long long GetStaticGeometryVersion() const { return m_staticGeometryVersion; }
+	// Whether the entity or one of its ancestors updates itself every frame, as of the last Update
+	[[nodiscard]] bool GetIsDynamic(EntityHandle handle) const;
+
+	// Entities get their light list uploaded before they're drawn, null leaves the lights to the material
+	void SetEntityLights(const EntityLights* entityLights) { m_entityLights = entityLights; }
+
+	// Counters of the last Draw
+	[[nodiscard]] const SceneStats& GetStats() const { return m_stats; }
+
+private:
+	[[nodiscard]] unsigned int AllocateSlot();
+	[[nodiscard]] bool HasDynamicAncestry(unsigned int slotIndex) const;
+	[[nodiscard]] static BoundingSphere ComputeWorldSphere(const Entity& entity);
+	[[nodiscard]] static BoundingBox ComputeWorldBox(const Entity& entity);
+	void CullMeshlets(const Camera& camera, const Frustum& frustum);
+	void AppendHandles(const std::vector<unsigned int>& slots, std::vector<EntityHandle>& entities) const;
+	[[nodiscard]] static bool IsBoxVisible(const Entity& entity, const Frustum& frustum);
+
+	// Meshlets of one entry of the draw list
+	struct MeshletBatch
+	{
+		size_t drawListIndex = 0;
+		size_t firstVisibility = 0;
+		std::span<const Meshlet> meshlets;
+		MeshletCullView view{};
+		int baseVertex = 0;
+		size_t firstCommand = 0;
+		size_t commandsCount = 0;
+	};
+
+	struct Slot
+	{
+		unsigned int denseIndex;
+		unsigned int generation;
+	};
+
+	std::vector<Entity> m_entities;
+	std::vector<unsigned int> m_denseToSlot;
+
+	std::vector<Slot> m_slots;
+	std::vector<unsigned int> m_freeSlots;
+
+	TransformHierarchy m_hierarchy;
+
+	// World bounding spheres by dense index
+	SphereCuller m_culler;
+	// World boxes by slot index
+	Bvh m_bvh;
+	std::vector<unsigned int> m_visible;
+	bool m_frustumCulling = true;
+	CullingMethod m_cullingMethod = CullingMethod::Bvh;
+	bool m_lodSelection = true;
+
+	// Dense indices of the entities passing culling this frame, in draw order
+	std::vector<unsigned int> m_drawList;
+	bool m_meshletCulling = true;
+	std::vector<MeshletBatch> m_meshletBatches;
+	std::vector<unsigned char> m_meshletVisibility;
+	std::vector<DrawElementsIndirectCommand> m_meshletCommands;
+
+	// By slot index
+	std::vector<unsigned char> m_occluded;
+	bool m_occlusionCulling = false;
+	std::vector<EntityHandle> m_occlusionCandidates;
+	std::vector<BoundingSphere> m_occlusionCandidateSpheres;
+	const EntityLights* m_entityLights = nullptr;
+	unsigned long long m_staticGeometryVersion = 0;
+	// By slot index, see GetIsDynamic
+	std::vector<unsigned char> m_dynamic;
+	SceneStats m_stats;
+};
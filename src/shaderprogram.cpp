@@ -55,6 +55,41 @@ ShaderProgram ShaderProgram::Compile(const std::string& vertexShaderSource, cons
 	return ShaderProgram(shaderProgram);
 }
 
+ShaderProgram ShaderProgram::CompileCompute(const std::string& computeShaderSource)
+{
+	int  success;
+	char infoLog[1024];
+
+	std::cout << "Compiling compute shader\n";
+
+	unsigned int computeShader = glCreateShader(GL_COMPUTE_SHADER);
+	std::cout << "  Compiling compute shader ID " << computeShader << '\n';
+	const char* s1 = computeShaderSource.c_str();
+	glShaderSource(computeShader, 1, &s1, nullptr);
+	glCompileShader(computeShader);
+	glGetShaderiv(computeShader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(computeShader, sizeof(infoLog), nullptr, infoLog);
+		std::cout << "  Failed compute shader compilation. Error: \"" << infoLog << "\"\n";
+		glDeleteShader(computeShader);
+		return Empty();
+	}
+	std::cout << "  Compute shader compiled successfully\n";
+
+	unsigned int shaderProgram = glCreateProgram();
+	glAttachShader(shaderProgram, computeShader);
+	glLinkProgram(shaderProgram);
+
+	std::cout << "  Shader linked to program with ID " << shaderProgram << '\n';
+
+	glDeleteShader(computeShader);
+
+	std::cout << "  Cleanup\n";
+
+	return ShaderProgram(shaderProgram);
+}
+
 ShaderProgram::~ShaderProgram()
 {
 	if (m_programId != 0)
@@ -206,6 +241,42 @@ void ShaderProgram::SetVector2(const std::string& paramName, const glm::vec2& va
 	}
 }
 
+void ShaderProgram::SetVector4(const std::string& paramName, const glm::vec4& value)
+{
+	int location = GetPramLocation(paramName);
+	if (location < 0)
+	{
+		if (m_verboseLogging)
+			std::cout << "Unknown param name \"" << paramName << "\"\n";
+		return;
+	}
+
+	auto cachedIt = m_shaderValueCache.find(paramName);
+	if (cachedIt == m_shaderValueCache.end() || std::get<glm::vec4>(cachedIt->second) != value)
+	{
+		m_shaderValueCache[paramName] = value;
+		glUniform4fv(location, 1, &value[0]);
+	}
+}
+
+void ShaderProgram::SetMat3(const std::string& paramName, const glm::mat3& value)
+{
+	int location = GetPramLocation(paramName);
+	if (location < 0)
+	{
+		if (m_verboseLogging)
+			std::cout << "Unknown param name \"" << paramName << "\"\n";
+		return;
+	}
+
+	auto cachedIt = m_shaderValueCache.find(paramName);
+	if (cachedIt == m_shaderValueCache.end() || std::get<glm::mat3>(cachedIt->second) != value)
+	{
+		m_shaderValueCache[paramName] = value;
+		glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
+
 void ShaderProgram::SetMat4(const std::string& paramName, const glm::mat4& value)
 {
 	int location = GetPramLocation(paramName);
@@ -222,4 +293,18 @@ void ShaderProgram::SetMat4(const std::string& paramName, const glm::mat4& value
 		m_shaderValueCache[paramName] = value;
 		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
 	}
+}
+
+void ShaderProgram::SetUintArray(const std::string& paramName, std::span<const unsigned int> values)
+{
+	int location = GetPramLocation(paramName);
+	if (location < 0)
+	{
+		if (m_verboseLogging)
+			std::cout << "Unknown param name \"" << paramName << "\"\n";
+		return;
+	}
+
+	if (!values.empty())
+		glUniform1uiv(location, static_cast<int>(values.size()), values.data());
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <variant>
@@ -11,6 +12,7 @@ class ShaderProgram
 public:
 	static ShaderProgram Compile(
 		const std::string& vertexShaderSource, const std::string& fragmentShaderSource);
+	static ShaderProgram CompileCompute(const std::string& computeShaderSource);
 	static ShaderProgram Empty() { return ShaderProgram(0); }
 
 	~ShaderProgram();
@@ -27,7 +29,11 @@ public:
 	void SetFloat(const std::string& paramName, float value);
 	void SetVector3(const std::string& paramName, const glm::vec3& value);
 	void SetVector2(const std::string& paramName, const glm::vec2& value);
+	void SetVector4(const std::string& paramName, const glm::vec4& value);
+	void SetMat3(const std::string& paramName, const glm::mat3& value);
 	void SetMat4(const std::string& paramName, const glm::mat4& value);
+	// Uploads the values from the first element on, arrays aren't cached
+	void SetUintArray(const std::string& paramName, std::span<const unsigned int> values);
 	void SetVerboseLogging(bool verboseLogging) { m_verboseLogging = verboseLogging; }
 
 	static unsigned int GetCurrentShader() { return s_currentlyUsedShader; }
@@ -39,7 +45,7 @@ private:
 	bool m_verboseLogging = false;
 
 	mutable std::unordered_map<std::string, int> m_shaderLocationCache;
-	using ShaderValue = std::variant<glm::vec3, glm::vec2, glm::mat4, int, unsigned int, float>;
+	using ShaderValue = std::variant<glm::vec4, glm::vec3, glm::vec2, glm::mat3, glm::mat4, int, unsigned int, float>;
 	mutable std::unordered_map<std::string, ShaderValue> m_shaderValueCache;
 
 	static unsigned int s_currentlyUsedShader;
@@ -0,0 +1,45 @@
+#version 460 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// Level 0 is a copy of the depth buffer, every next level keeps the farthest depth of the
+// texels it covers. Odd sizes round down and the last row/column also takes the leftover texel.
+uniform sampler2D depthTexture;
+layout (r32f, binding = 0) readonly uniform image2D source;
+layout (r32f, binding = 1) writeonly uniform image2D destination;
+
+uniform bool fromDepth;
+uniform vec2 sourceSize;
+uniform vec2 destinationSize;
+
+void main()
+{
+	ivec2 sourceTexels = ivec2(sourceSize);
+	ivec2 destinationTexels = ivec2(destinationSize);
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(texel, destinationTexels)))
+		return;
+
+	if (fromDepth)
+	{
+		imageStore(destination, texel, vec4(texelFetch(depthTexture, texel, 0).r));
+		return;
+	}
+
+	ivec2 base = texel * 2;
+	ivec2 last = sourceTexels - 1;
+	ivec2 end = base + 1;
+	if ((sourceTexels.x & 1) == 1 && texel.x == destinationTexels.x - 1)
+		end.x++;
+	if ((sourceTexels.y & 1) == 1 && texel.y == destinationTexels.y - 1)
+		end.y++;
+
+	float depth = 0.0;
+	for (int y = base.y; y <= end.y; y++)
+	{
+		for (int x = base.x; x <= end.x; x++)
+			depth = max(depth, imageLoad(source, min(ivec2(x, y), last)).r);
+	}
+
+	imageStore(destination, texel, vec4(depth));
+}
@@ -0,0 +1,171 @@
+#version 460 core
+
+layout (local_size_x = 256) in;
+
+// xyz - world position, w - uniform scale
+layout (std430, binding = 0) readonly buffer Instances
+{
+	vec4 instances[];
+};
+
+// One range of instancesCount indices per level of detail
+layout (std430, binding = 1) writeonly buffer VisibleInstances
+{
+	uint visibleInstances[];
+};
+
+struct DrawElementsIndirectCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+// One command per level of detail, the instance counts are reset to 0 before the dispatch
+layout (std430, binding = 2) buffer DrawCommands
+{
+	DrawElementsIndirectCommand commands[];
+};
+
+uniform uint instancesCount;
+uniform bool frustumCulling = true;
+uniform vec4 frustumPlanes[6];
+uniform vec3 cameraPosition;
+// Radius around the instance origin covering every rotation, at scale 1
+uniform float boundingRadius;
+// Instances past this distance are fully faded out, 0 disables the check
+uniform float maxDistance = 0;
+
+// Instances go to the last level whose threshold their projected size is below, see Model::SelectLod
+const int maxLods = 4;
+uniform int lodsCount = 1;
+uniform float lodScreenSizes[maxLods];
+uniform float projectedSizeScale;
+// Half height of an orthographic view like a shadow cascade, 0 for a perspective one
+uniform float orthographicHalfHeight = 0;
+
+// Depth pyramid of an earlier frame, see OcclusionCuller
+uniform bool occlusionCulling = false;
+uniform sampler2D depthPyramid;
+uniform mat4 pyramidViewProjection;
+uniform vec2 pyramidSize;
+uniform int pyramidLevelsCount;
+
+shared uint groupVisibleCount[maxLods];
+shared uint groupOffset[maxLods];
+
+bool isOccluded(vec3 center, float radius)
+{
+	vec2 ndcMin = vec2(1.0);
+	vec2 ndcMax = vec2(-1.0);
+	float nearestDepth = 1.0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = center + radius * vec3((i & 1) == 0 ? -1.0 : 1.0, (i & 2) == 0 ? -1.0 : 1.0, (i & 4) == 0 ? -1.0 : 1.0);
+		vec4 clip = pyramidViewProjection * vec4(corner, 1.0);
+
+		// Reaches behind the camera or past the near plane, can't be hidden
+		if (clip.w <= 0.0 || clip.z < -clip.w)
+			return false;
+
+		vec3 ndc = clip.xyz / clip.w;
+		ndcMin = min(ndcMin, ndc.xy);
+		ndcMax = max(ndcMax, ndc.xy);
+		nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+	}
+
+	// Off screen in the pyramid's view, nothing there to occlude it
+	if (any(lessThan(ndcMax, vec2(-1.0))) || any(greaterThan(ndcMin, vec2(1.0))))
+		return false;
+
+	ivec2 size = ivec2(pyramidSize);
+	ivec2 pixelMin = clamp(ivec2(floor((ndcMin * 0.5 + 0.5) * pyramidSize)), ivec2(0), size - 1);
+	ivec2 pixelMax = clamp(ivec2(floor((ndcMax * 0.5 + 0.5) * pyramidSize)), ivec2(0), size - 1);
+
+	// Lowest level where the rectangle spans at most 2x2 texels
+	ivec2 extent = pixelMax - pixelMin + 1;
+	int level = clamp(int(ceil(log2(float(max(extent.x, extent.y))))), 0, pyramidLevelsCount - 1);
+
+	ivec2 levelSize = max(size >> level, ivec2(1));
+	ivec2 texelMin = min(pixelMin >> level, levelSize - 1);
+	ivec2 texelMax = min(pixelMax >> level, levelSize - 1);
+
+	float farthestDepth = 0.0;
+	for (int y = texelMin.y; y <= texelMax.y; y++)
+	{
+		for (int x = texelMin.x; x <= texelMax.x; x++)
+			farthestDepth = max(farthestDepth, texelFetch(depthPyramid, ivec2(x, y), level).r);
+	}
+
+	return nearestDepth > farthestDepth;
+}
+
+bool isVisible(vec4 instance)
+{
+	float radius = boundingRadius * instance.w;
+
+	if (maxDistance > 0.0 && distance(cameraPosition, instance.xyz) > maxDistance + radius)
+		return false;
+
+	if (frustumCulling)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			if (dot(frustumPlanes[i].xyz, instance.xyz) + frustumPlanes[i].w < -radius)
+				return false;
+		}
+	}
+
+	return !occlusionCulling || !isOccluded(instance.xyz, radius);
+}
+
+int selectLod(vec4 instance)
+{
+	float radius = boundingRadius * instance.w;
+	float screenSize;
+	if (orthographicHalfHeight > 0.0)
+	{
+		screenSize = radius / orthographicHalfHeight;
+	}
+	else
+	{
+		float distanceToCamera = distance(cameraPosition, instance.xyz);
+		if (distanceToCamera <= radius)
+			return 0;
+
+		screenSize = radius / distanceToCamera * projectedSizeScale;
+	}
+
+	int lod = 0;
+	while (lod + 1 < lodsCount && screenSize < lodScreenSizes[lod + 1])
+		lod++;
+
+	return lod;
+}
+
+void main()
+{
+	if (gl_LocalInvocationIndex < maxLods)
+		groupVisibleCount[gl_LocalInvocationIndex] = 0;
+	barrier();
+
+	uint index = gl_GlobalInvocationID.x;
+	bool visible = index < instancesCount && isVisible(instances[index]);
+	int lod = visible ? selectLod(instances[index]) : 0;
+
+	// Compact within the group first so there is a single global atomic per group and level
+	uint localOffset = 0;
+	if (visible)
+		localOffset = atomicAdd(groupVisibleCount[lod], 1);
+	barrier();
+
+	if (gl_LocalInvocationIndex < lodsCount && groupVisibleCount[gl_LocalInvocationIndex] > 0)
+		groupOffset[gl_LocalInvocationIndex] = atomicAdd(commands[gl_LocalInvocationIndex].instanceCount, groupVisibleCount[gl_LocalInvocationIndex]);
+	barrier();
+
+	if (visible)
+		visibleInstances[lod * instancesCount + groupOffset[lod] + localOffset] = index;
+}
@@ -0,0 +1,56 @@
+#version 460 core
+
+// Lights the G-buffer written by fragmentShader.glsl's G-buffer pass, one pixel per fragment
+layout(location = 0) out vec4 FragColor;
+
+in vec2 textureCoords;
+
+// rgb - diffuse strength, a - 1 for colors drawn unlit
+uniform sampler2D albedoTexture;
+// Octahedral encoded world space normal
+uniform sampler2D normalTexture;
+// rgb - specular strength, a - log2(shininess) / 10
+uniform sampler2D specularTexture;
+uniform sampler2D depthTexture;
+
+uniform mat4 inverseViewProjection;
+
+#include "lighting.glsl"
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	float depth = texelFetch(depthTexture, pixel, 0).r;
+
+	// Nothing was drawn here, keep the clear color
+	if (depth >= 1.0)
+		discard;
+
+	vec4 albedo = texelFetch(albedoTexture, pixel, 0);
+	if (albedo.a > 0.5)
+	{
+		FragColor = vec4(albedo.rgb, 1.0);
+		return;
+	}
+
+	vec4 specular = texelFetch(specularTexture, pixel, 0);
+	vec4 clip = vec4(gl_FragCoord.xy / clusterScreenSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	vec4 world = inverseViewProjection * clip;
+
+	Surface surface = Surface(
+		world.xyz / world.w,
+		decodeOctahedral(texelFetch(normalTexture, pixel, 0).xy),
+		albedo.rgb,
+		specular.rgb,
+		exp2(specular.a * 10.0));
+	FragColor = vec4(shade(surface, gl_FragCoord.xy, depth), 1.0);
+}
@@ -0,0 +1,20 @@
+#version 460 core
+
+out vec4 FragColor;
+
+in vec2 textureCoords;
+
+uniform sampler2D depthPyramid;
+uniform int level;
+uniform float nearPlane;
+uniform float farPlane;
+
+void main()
+{
+	float depth = textureLod(depthPyramid, textureCoords, float(level)).r;
+	float ndc = depth * 2.0 - 1.0;
+	float linearDepth = 2.0 * nearPlane * farPlane / (farPlane + nearPlane - ndc * (farPlane - nearPlane));
+
+	// Square root keeps nearby detail visible next to the far plane
+	FragColor = vec4(vec3(sqrt(linearDepth / farPlane)), 1.0);
+}
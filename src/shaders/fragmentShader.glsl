@@ -1,16 +1,18 @@
 #version 460 core
 
+// In the G-buffer pass FragColor takes the albedo, see GBuffer
 layout(location = 0) out vec4 FragColor;
 layout(location = 1) out int EntitiyId;
+layout(location = 2) out vec2 NormalOutput;
+layout(location = 3) out vec4 SpecularOutput;
 
 in vec2 textureCoord;
 in vec3 fragmentPosition;
 in vec3 normalVector;
+in float fade;
 
 uniform int entityId;
 
-uniform vec3 cameraPosition;
-
 struct Material
 {
 	vec3 color;
@@ -22,69 +24,31 @@ struct Material
 };
 uniform Material material;
 
-#define MAX_LIGHTS 10
-
-struct Sun
-{
-	vec3 direction;
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-};
-uniform Sun suns[MAX_LIGHTS];
-uniform int sunsCount = 0;
-
-struct PointLight
-{
-	vec3 position;
-
-	vec3 diffuse;
-	vec3 specular;
+// Writes the surface to the G-buffer instead of lighting it
+uniform bool gBufferPass = false;
 
-	float constant;
-	float linear;
-	float quadratic;
-};
-uniform PointLight pointLights[MAX_LIGHTS];
-uniform int pointLightsCount = 0;
+#include "lighting.glsl"
 
-struct SpotLight
+float ditherThreshold(vec2 pixel)
 {
-	vec3 position;
-	vec3 direction;
-
-	vec3 diffuse;
-	vec3 specular;
-
-	float constant;
-	float linear;
-	float quadratic;
-
-	float innerCutoff;
-	float outerCutoff;
-};
-uniform SpotLight spotLights[MAX_LIGHTS];
-uniform int spotLightsCount = 0;
-
-float getDiffuseLightStrength(vec3 lightDirection) {
-	float dotResult = dot(normalVector, -normalize(lightDirection));
-	return max(dotResult, 0);
-}
-
-float getSpecularLightStrength(vec3 lightDirection) {
-	vec3 viewingDirection = normalize(cameraPosition - fragmentPosition);
-	vec3 reflectDirection = reflect(normalize(lightDirection), normalVector);
-	float specLight = pow(max(dot(viewingDirection, reflectDirection), 0.0), material.shininess);
-	return specLight;
+	return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
 }
 
-float getAttenuation(float dist, float constant, float linear, float quadratic)
+vec2 encodeOctahedral(vec3 n)
 {
-	return 1.0 / (constant + linear * dist + quadratic * dist * dist);
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 encoded = n.xy;
+	if (n.z < 0.0)
+		encoded = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return encoded;
 }
 
 void main()
 {
+	// Distance fade
+	if (fade < 1.0 && fade < ditherThreshold(gl_FragCoord.xy))
+		discard;
+
 	// Sample material
 	vec4 pixelColor = texture(material.diffuseMap, textureCoord);
 	if (pixelColor.w < 0.1)
@@ -95,53 +59,17 @@ void main()
 	vec3 specularMaterialStrength = material.specularOverride ? 
 		vec3(0.5) : vec3(texture(material.specularMap, textureCoord));
 
-	// Sun light
-	vec3 ambientLight = vec3(0);
-	vec3 diffuseLight = vec3(0);
-	vec3 specularLight = vec3(0);
-	for (int i = 0; i < sunsCount && i < MAX_LIGHTS; i++)
-	{
-		ambientLight += suns[i].ambient * diffuseMaterialStrength;
-		diffuseLight += suns[i].diffuse * getDiffuseLightStrength(suns[i].direction) * diffuseMaterialStrength;
-		specularLight += suns[i].specular * getSpecularLightStrength(suns[i].direction) * specularMaterialStrength;
-	}
-
-	// Point light
-	vec3 diffusePointLight = vec3(0);
-	vec3 specularPointLight = vec3(0);
-	for (int i = 0; i < pointLightsCount && i < MAX_LIGHTS; i++)
-	{
-		float distanceToPointLight = distance(fragmentPosition, pointLights[i].position);
-		float pointLightAttenuation = getAttenuation(distanceToPointLight, pointLights[i].constant, pointLights[i].linear, pointLights[i].quadratic);
-		diffusePointLight += pointLights[i].diffuse * pointLightAttenuation * 
-			getDiffuseLightStrength(fragmentPosition - pointLights[i].position) * diffuseMaterialStrength;
-		specularPointLight += pointLights[i].specular * pointLightAttenuation  * 
-			getSpecularLightStrength(fragmentPosition - pointLights[i].position)  * specularMaterialStrength;
-	}
+	EntitiyId = entityId;
 
-	// Spot light
-	vec3 diffuseSpotLight = vec3(0);
-	vec3 specularSpotLight = vec3(0);
-	for (int i = 0; i < spotLightsCount && i < MAX_LIGHTS; i++)
+	if (gBufferPass)
 	{
-		float distanceToSpotLight = distance(fragmentPosition, spotLights[i].position);
-		float spotLightAttenuation = getAttenuation(distanceToSpotLight, spotLights[i].constant, spotLights[i].linear, spotLights[i].quadratic);
-
-		vec3 toSpotLight = normalize(spotLights[i].position - fragmentPosition);
-		float angle = dot(toSpotLight, -normalize(spotLights[i].direction));
-		float spotLighAngleModifier = clamp((angle - spotLights[i].outerCutoff) / (spotLights[i].innerCutoff - spotLights[i].outerCutoff), 0, 1);
-
-		diffuseSpotLight += spotLights[i].diffuse * spotLightAttenuation * 
-			getDiffuseLightStrength(fragmentPosition - spotLights[i].position) * diffuseMaterialStrength * spotLighAngleModifier;
-		specularSpotLight += spotLights[i].specular * spotLightAttenuation * 
-			getSpecularLightStrength(fragmentPosition - spotLights[i].position)  * specularMaterialStrength * spotLighAngleModifier;
+		// Alpha 0 marks lit surfaces, shininess is stored as log2 / 10 to cover 1 to 1024
+		FragColor = vec4(diffuseMaterialStrength, 0.0);
+		NormalOutput = encodeOctahedral(normalize(normalVector));
+		SpecularOutput = vec4(specularMaterialStrength, log2(max(material.shininess, 1.0)) / 10.0);
+		return;
 	}
 
-	// Combine
-	vec3 sunLights = ambientLight + diffuseLight + specularLight;
-	vec3 pointLights = diffusePointLight + specularPointLight;
-	vec3 spotLights = diffuseSpotLight + specularSpotLight;
-
-	FragColor = vec4(sunLights + pointLights + spotLights, 1.0);
-	EntitiyId = entityId;
-}
\ No newline at end of file
+	Surface surface = Surface(fragmentPosition, normalVector, diffuseMaterialStrength, specularMaterialStrength, material.shininess);
+	FragColor = vec4(shade(surface, gl_FragCoord.xy, gl_FragCoord.z), 1.0);
+}
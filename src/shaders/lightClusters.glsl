@@ -0,0 +1,91 @@
+#version 460 core
+
+// One invocation per cluster, the group shares the light bounds it tests in batches
+layout (local_size_x = 64) in;
+
+// Screen tiles times exponential depth slices, see LightClusters
+const uvec3 gridSize = uvec3(16, 9, 24);
+const uint clustersCount = gridSize.x * gridSize.y * gridSize.z;
+const uint maxLightsPerCluster = 128;
+
+// xyz - view space center, w - radius. Point lights first, then spot lights.
+layout (std430, binding = 5) readonly buffer LightBounds
+{
+	vec4 lightBounds[];
+};
+
+// x - point lights, y - spot lights in the cluster
+layout (std430, binding = 6) writeonly buffer LightGrid
+{
+	uvec2 lightGrid[];
+};
+
+// maxLightsPerCluster indices per cluster, its point lights followed by its spot lights
+layout (std430, binding = 7) writeonly buffer LightIndices
+{
+	uint lightIndices[];
+};
+
+uniform uint pointLightsCount;
+uniform uint spotLightsCount;
+// projection[0][0] and projection[1][1] of the symmetric perspective projection
+uniform vec2 projectionScale;
+uniform float nearPlane;
+uniform float farPlane;
+
+shared vec4 groupBounds[gl_WorkGroupSize.x];
+
+float sliceDepth(uint slice)
+{
+	return nearPlane * pow(farPlane / nearPlane, float(slice) / float(gridSize.z));
+}
+
+bool intersects(vec4 sphere, vec3 boundsMin, vec3 boundsMax)
+{
+	vec3 offset = clamp(sphere.xyz, boundsMin, boundsMax) - sphere.xyz;
+	return dot(offset, offset) <= sphere.w * sphere.w;
+}
+
+void main()
+{
+	uint clusterIndex = gl_GlobalInvocationID.x;
+	uvec3 cluster = uvec3(clusterIndex % gridSize.x, (clusterIndex / gridSize.x) % gridSize.y, clusterIndex / (gridSize.x * gridSize.y));
+
+	// View space box around the froxel, a ray through ndc p reaches (p / projectionScale * depth, -depth)
+	float nearDepth = sliceDepth(cluster.z);
+	float farDepth = sliceDepth(cluster.z + 1);
+	vec2 tileMin = (vec2(cluster.xy) / vec2(gridSize.xy) * 2.0 - 1.0) / projectionScale;
+	vec2 tileMax = (vec2(cluster.xy + 1) / vec2(gridSize.xy) * 2.0 - 1.0) / projectionScale;
+	vec3 boundsMin = vec3(min(tileMin * nearDepth, tileMin * farDepth), -farDepth);
+	vec3 boundsMax = vec3(max(tileMax * nearDepth, tileMax * farDepth), -nearDepth);
+
+	uint lightsCount = pointLightsCount + spotLightsCount;
+	uint first = clusterIndex * maxLightsPerCluster;
+	uint pointCount = 0;
+	uint spotCount = 0;
+
+	for (uint batch = 0; batch < lightsCount; batch += gl_WorkGroupSize.x)
+	{
+		uint batchCount = min(gl_WorkGroupSize.x, lightsCount - batch);
+		if (gl_LocalInvocationIndex < batchCount)
+			groupBounds[gl_LocalInvocationIndex] = lightBounds[batch + gl_LocalInvocationIndex];
+		barrier();
+
+		for (uint i = 0; i < batchCount && pointCount + spotCount < maxLightsPerCluster; i++)
+		{
+			if (!intersects(groupBounds[i], boundsMin, boundsMax))
+				continue;
+
+			// Point lights come first, so all of them are listed before the first spot light
+			uint light = batch + i;
+			if (light < pointLightsCount)
+				lightIndices[first + pointCount++] = light;
+			else
+				lightIndices[first + pointCount + spotCount++] = light - pointLightsCount;
+		}
+		barrier();
+	}
+
+	if (clusterIndex < clustersCount)
+		lightGrid[clusterIndex] = uvec2(pointCount, spotCount);
+}
@@ -0,0 +1,275 @@
+// Sun, point and spot light shading shared by fragmentShader.glsl and deferredLighting.glsl,
+// pasted in by readShaderSource
+
+uniform vec3 cameraPosition;
+
+#define MAX_SUNS 10
+
+struct Sun
+{
+	vec3 direction;
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+uniform Sun suns[MAX_SUNS];
+uniform int sunsCount = 0;
+
+// Cascaded shadow maps of the first sun, rendered by ShadowCascades. Each cascade covers the view
+// depth up to its end, the binding matches ShadowCascades::TextureUnit.
+#define SHADOW_CASCADES 4
+layout (binding = 9) uniform sampler2DArrayShadow shadowMap;
+uniform bool sunShadows = false;
+uniform bool showShadowCascades = false;
+// World to shadow map texture space
+uniform mat4 shadowMatrices[SHADOW_CASCADES];
+uniform float cascadeEnds[SHADOW_CASCADES];
+// World size of a shadow map texel, surfaces are offset along their normal by about one
+uniform float shadowTexelSizes[SHADOW_CASCADES];
+
+// Point and spot lights are uploaded every frame by LightClusters. Past its range a light's
+// attenuation is below cutoffAttenuation, which is subtracted so it fades out at the range.
+struct PointLight
+{
+	vec3 position;
+	float range;
+
+	vec3 diffuse;
+	float constant;
+	vec3 specular;
+	float linear;
+	float quadratic;
+
+	float cutoffAttenuation;
+};
+layout (std430, binding = 3) readonly buffer PointLights
+{
+	PointLight pointLights[];
+};
+uniform int pointLightsCount = 0;
+
+struct SpotLight
+{
+	vec3 position;
+	float range;
+	vec3 direction;
+	float constant;
+
+	vec3 diffuse;
+	float linear;
+	vec3 specular;
+	float quadratic;
+
+	float innerCutoff;
+	float outerCutoff;
+
+	float cutoffAttenuation;
+};
+layout (std430, binding = 4) readonly buffer SpotLights
+{
+	SpotLight spotLights[];
+};
+uniform int spotLightsCount = 0;
+
+// Lights per froxel written by lightClusters.glsl, without clustering every light is shaded
+const uvec3 clusterGridSize = uvec3(16, 9, 24);
+const uint maxLightsPerCluster = 128;
+
+// x - point lights, y - spot lights in the cluster
+layout (std430, binding = 6) readonly buffer LightGrid
+{
+	uvec2 lightGrid[];
+};
+
+// maxLightsPerCluster indices per cluster, its point lights followed by its spot lights
+layout (std430, binding = 7) readonly buffer LightIndices
+{
+	uint lightIndices[];
+};
+
+uniform bool clusteredLights = false;
+uniform bool showLightClusters = false;
+uniform vec2 clusterScreenSize = vec2(1);
+uniform float nearPlane;
+uniform float farPlane;
+
+// Lights reaching the entity being drawn, listed on the CPU by EntityLights. Takes over from the
+// clusters for the entities it's enabled on.
+#define MAX_ENTITY_LIGHTS 32
+uniform bool entityLights = false;
+uniform uint entityPointLightsCount = 0;
+uniform uint entitySpotLightsCount = 0;
+// Its point lights followed by its spot lights
+uniform uint entityLightIndices[MAX_ENTITY_LIGHTS];
+
+// What the lights need to know about the point being shaded
+struct Surface
+{
+	vec3 position;
+	vec3 normal;
+	vec3 diffuse;
+	vec3 specular;
+	float shininess;
+};
+
+float getDiffuseLightStrength(Surface surface, vec3 lightDirection) {
+	float dotResult = dot(surface.normal, -normalize(lightDirection));
+	return max(dotResult, 0);
+}
+
+float getSpecularLightStrength(Surface surface, vec3 lightDirection) {
+	vec3 viewingDirection = normalize(cameraPosition - surface.position);
+	vec3 reflectDirection = reflect(normalize(lightDirection), surface.normal);
+	float specLight = pow(max(dot(viewingDirection, reflectDirection), 0.0), surface.shininess);
+	return specLight;
+}
+
+float getAttenuation(float dist, float constant, float linear, float quadratic, float cutoffAttenuation)
+{
+	return max(1.0 / (constant + linear * dist + quadratic * dist * dist) - cutoffAttenuation, 0.0);
+}
+
+// View depth from the depth buffer value of the perspective projection
+float getViewDepth(float windowDepth)
+{
+	return nearPlane * farPlane / (farPlane - windowDepth * (farPlane - nearPlane));
+}
+
+// windowDepth is the depth buffer value of the pixel
+uint getCluster(vec2 pixel, float windowDepth)
+{
+	float depth = getViewDepth(windowDepth);
+	uint slice = uint(max(log(depth / nearPlane) / log(farPlane / nearPlane) * float(clusterGridSize.z), 0.0));
+	uvec2 tile = uvec2(pixel / clusterScreenSize * vec2(clusterGridSize.xy));
+	tile = min(tile, clusterGridSize.xy - 1);
+	slice = min(slice, clusterGridSize.z - 1);
+	return (slice * clusterGridSize.y + tile.y) * clusterGridSize.x + tile.x;
+}
+
+int getShadowCascade(float viewDepth)
+{
+	for (int i = 0; i < SHADOW_CASCADES; i++)
+	{
+		if (viewDepth <= cascadeEnds[i])
+			return i;
+	}
+	return SHADOW_CASCADES;
+}
+
+// 1 where the first sun reaches the surface, 0 in its shadow
+float getSunShadow(Surface surface, int cascade)
+{
+	if (cascade >= SHADOW_CASCADES)
+		return 1.0;
+
+	vec3 position = surface.position + normalize(surface.normal) * shadowTexelSizes[cascade] * 1.5;
+	vec3 coords = (shadowMatrices[cascade] * vec4(position, 1.0)).xyz;
+	if (coords.z >= 1.0)
+		return 1.0;
+
+	// 3x3 filtered taps, each already blending a 2x2 depth comparison
+	vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+	float lit = 0.0;
+	for (int y = -1; y <= 1; y++)
+	{
+		for (int x = -1; x <= 1; x++)
+			lit += texture(shadowMap, vec4(coords.xy + vec2(x, y) * texelSize, float(cascade), coords.z));
+	}
+	return lit / 9.0;
+}
+
+vec3 heatmap(uint lightsCount)
+{
+	if (lightsCount == 0)
+		return vec3(0.0);
+
+	float t = clamp(float(lightsCount) / 32.0, 0.0, 1.0);
+	return t < 0.5 ? mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), t * 2.0) : mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), t * 2.0 - 1.0);
+}
+
+vec3 shadePointLight(uint i, Surface surface)
+{
+	float distanceToPointLight = distance(surface.position, pointLights[i].position);
+	float pointLightAttenuation = getAttenuation(distanceToPointLight, pointLights[i].constant, pointLights[i].linear, pointLights[i].quadratic, pointLights[i].cutoffAttenuation);
+	vec3 diffusePointLight = pointLights[i].diffuse * pointLightAttenuation * 
+		getDiffuseLightStrength(surface, surface.position - pointLights[i].position) * surface.diffuse;
+	vec3 specularPointLight = pointLights[i].specular * pointLightAttenuation  * 
+		getSpecularLightStrength(surface, surface.position - pointLights[i].position)  * surface.specular;
+	return diffusePointLight + specularPointLight;
+}
+
+vec3 shadeSpotLight(uint i, Surface surface)
+{
+	float distanceToSpotLight = distance(surface.position, spotLights[i].position);
+	float spotLightAttenuation = getAttenuation(distanceToSpotLight, spotLights[i].constant, spotLights[i].linear, spotLights[i].quadratic, spotLights[i].cutoffAttenuation);
+
+	vec3 toSpotLight = normalize(spotLights[i].position - surface.position);
+	float angle = dot(toSpotLight, -normalize(spotLights[i].direction));
+	float spotLighAngleModifier = clamp((angle - spotLights[i].outerCutoff) / (spotLights[i].innerCutoff - spotLights[i].outerCutoff), 0, 1);
+
+	vec3 diffuseSpotLight = spotLights[i].diffuse * spotLightAttenuation * 
+		getDiffuseLightStrength(surface, surface.position - spotLights[i].position) * surface.diffuse * spotLighAngleModifier;
+	vec3 specularSpotLight = spotLights[i].specular * spotLightAttenuation * 
+		getSpecularLightStrength(surface, surface.position - spotLights[i].position)  * surface.specular * spotLighAngleModifier;
+	return diffuseSpotLight + specularSpotLight;
+}
+
+// Lit color of the surface seen at the pixel, with the heatmap of its listed lights over it when enabled
+vec3 shade(Surface surface, vec2 pixel, float windowDepth)
+{
+	// Sun light, the first sun casts shadows
+	int cascade = sunShadows ? getShadowCascade(getViewDepth(windowDepth)) : SHADOW_CASCADES;
+	vec3 ambientLight = vec3(0);
+	vec3 diffuseLight = vec3(0);
+	vec3 specularLight = vec3(0);
+	for (int i = 0; i < sunsCount && i < MAX_SUNS; i++)
+	{
+		float shadow = i == 0 && sunShadows ? getSunShadow(surface, cascade) : 1.0;
+		ambientLight += suns[i].ambient * surface.diffuse;
+		diffuseLight += suns[i].diffuse * getDiffuseLightStrength(surface, suns[i].direction) * surface.diffuse * shadow;
+		specularLight += suns[i].specular * getSpecularLightStrength(surface, suns[i].direction) * surface.specular * shadow;
+	}
+
+	// Point and spot lights
+	vec3 pointLighting = vec3(0);
+	vec3 spotLighting = vec3(0);
+	uint listedLightsCount = 0;
+	if (entityLights)
+	{
+		for (uint i = 0; i < entityPointLightsCount; i++)
+			pointLighting += shadePointLight(entityLightIndices[i], surface);
+		for (uint i = 0; i < entitySpotLightsCount; i++)
+			spotLighting += shadeSpotLight(entityLightIndices[entityPointLightsCount + i], surface);
+		listedLightsCount = entityPointLightsCount + entitySpotLightsCount;
+	}
+	else if (clusteredLights)
+	{
+		uint cluster = getCluster(pixel, windowDepth);
+		uvec2 counts = lightGrid[cluster];
+		uint first = cluster * maxLightsPerCluster;
+		for (uint i = 0; i < counts.x; i++)
+			pointLighting += shadePointLight(lightIndices[first + i], surface);
+		for (uint i = 0; i < counts.y; i++)
+			spotLighting += shadeSpotLight(lightIndices[first + counts.x + i], surface);
+		listedLightsCount = counts.x + counts.y;
+	}
+	else
+	{
+		for (int i = 0; i < pointLightsCount; i++)
+			pointLighting += shadePointLight(i, surface);
+		for (int i = 0; i < spotLightsCount; i++)
+			spotLighting += shadeSpotLight(i, surface);
+	}
+
+	// Combine
+	vec3 sunLights = ambientLight + diffuseLight + specularLight;
+	vec3 color = sunLights + pointLighting + spotLighting;
+	if (showLightClusters)
+		color = mix(color, heatmap(listedLightsCount), 0.6);
+	if (showShadowCascades && cascade < SHADOW_CASCADES)
+	{
+		const vec3 cascadeColors[SHADOW_CASCADES] = vec3[](vec3(1, 0.3, 0.3), vec3(0.3, 1, 0.3), vec3(0.3, 0.3, 1), vec3(1, 1, 0.3));
+		color *= cascadeColors[cascade];
+	}
+	return color;
+}
@@ -0,0 +1,15 @@
+#version 460 core
+
+// Depth only pass of ShadowCascades, paired with vertexShader.glsl
+
+in vec2 textureCoord;
+
+// Cut out materials like grass keep the holes of their diffuse map in the shadow
+uniform bool alphaTested = false;
+uniform sampler2D diffuseMap;
+
+void main()
+{
+	if (alphaTested && texture(diffuseMap, textureCoord).a < 0.1)
+		discard;
+}
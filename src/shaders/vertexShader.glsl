@@ -1,24 +1,127 @@
 #version 460 core
 
+// With quantized vertices the position is normalized within the model bounds
+// and the normal is octahedral encoded in xy, see Model::VertexFormat
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec2 uv;
 layout (location = 2) in vec3 normal;
 
+// xyz - world position, w - uniform scale
+layout (std430, binding = 0) readonly buffer Instances
+{
+	vec4 instances[];
+};
+
+// Indices into instances written by the culling pass
+layout (std430, binding = 1) readonly buffer VisibleInstances
+{
+	uint visibleInstances[];
+};
+
 uniform mat4 model = mat4(1);
+uniform mat3 normalMatrix = mat3(1);
 uniform mat4 view = mat4(1);
 uniform mat4 perspective = mat4(1);
 
+uniform bool quantizedVertices = false;
+uniform vec3 positionOffset = vec3(0);
+uniform vec3 positionScale = vec3(1);
+
+uniform vec3 cameraPosition;
+uniform bool billboard = false;
+uniform bool instanced = false;
+uniform bool culledInstances = false;
+// Start of the current level of detail's range in visibleInstances
+uniform uint instanceOffset = 0;
+uniform bool randomYaw = false;
+uniform vec2 fadeDistance = vec2(0);
+
 out vec2 textureCoord;
 out vec3 fragmentPosition;
 out vec3 normalVector;
+out float fade;
+
+vec3 rotateY(vec3 v, float angle)
+{
+	float s = sin(angle);
+	float c = cos(angle);
+	return vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+}
+
+float hash(uint x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return float(x) / 4294967295.0;
+}
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
 
 void main()
 {
 	textureCoord = uv;
 
-	vec4 modelPos = model * vec4(position, 1.0);
+	vec3 modelPosition = position;
+	vec3 modelNormal = normal;
+	if (quantizedVertices)
+	{
+		modelPosition = positionOffset + position * positionScale;
+		modelNormal = decodeOctahedral(normal.xy);
+	}
+
+	vec3 worldOffset = mat3(model) * modelPosition;
+	vec3 worldNormal = normalMatrix * modelNormal;
+	vec3 instancePosition = vec3(model[3]);
+
+	if (instanced)
+	{
+		uint instanceIndex = culledInstances ? visibleInstances[instanceOffset + gl_InstanceID] : uint(gl_InstanceID);
+		vec4 instance = instances[instanceIndex];
+		worldOffset *= instance.w;
+		instancePosition += instance.xyz;
+
+		if (randomYaw)
+		{
+			float yaw = hash(instanceIndex) * 6.2831853;
+			worldOffset = rotateY(worldOffset, yaw);
+			worldNormal = rotateY(worldNormal, yaw);
+		}
+	}
+
+	fade = 1.0;
+	if (fadeDistance.y > 0.0)
+	{
+		fade = 1.0 - smoothstep(fadeDistance.x, fadeDistance.y, distance(cameraPosition, instancePosition));
+		if (fade <= 0.0)
+		{
+			// Collapse the whole instance so it never reaches the rasterizer
+			gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+			return;
+		}
+	}
+
+	if (billboard)
+	{
+		// Yaw the quad around its own origin so it keeps facing the camera
+		vec2 toCamera = cameraPosition.xz - instancePosition.xz;
+		float yaw = dot(toCamera, toCamera) > 0.0001 ? -atan(toCamera.y, toCamera.x) : 0.0;
+		worldOffset = rotateY(worldOffset, yaw);
+		worldNormal = rotateY(worldNormal, yaw);
+	}
+
+	vec4 modelPos = vec4(instancePosition + worldOffset, 1.0);
 	gl_Position = perspective * view * modelPos;
 	fragmentPosition = vec3(modelPos);
 
-	normalVector = normalize(mat3(transpose(inverse(model))) * normal);
-}
\ No newline at end of file
+	normalVector = normalize(worldNormal);
+}
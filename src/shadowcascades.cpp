@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "shadowcascades.h"
+
+namespace
+{
+	// Blend of logarithmic splits, which keep the texel density even in depth, and uniform ones,
+	// which keep the nearest cascade from getting too thin
+	constexpr float splitLogWeight = 0.75f;
+
+	// Far enough that the billboards of the shadow pass face along the light, see Scatter::DrawShadow
+	constexpr float billboardTargetDistance = 1e6f;
+
+	unsigned int createDepthArray(bool compare)
+	{
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F,
+			ShadowCascades::Resolution, ShadowCascades::Resolution, ShadowCascades::CascadesCount);
+
+		// Outside of a cascade is lit
+		const float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+
+		// Linear filtering of a compared texture blends the results of 2x2 depth tests
+		const GLint filter = compare ? GL_LINEAR : GL_NEAREST;
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
+		if (compare)
+		{
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		}
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		return texture;
+	}
+
+	// Level of detail by the size in the cascade, which only changes when the cascade moves
+	unsigned int selectLod(const Scene& scene, EntityHandle handle, const Entity& entity, float extent)
+	{
+		if (!scene.GetLodSelection())
+			return 0;
+
+		const BoundingSphere sphere = scene.GetCuller().Get(scene.IndexOf(handle));
+		return entity.GetModel()->SelectLod(sphere.radius / extent, 0);
+	}
+
+	float splitDepth(float nearPlane, float farPlane, unsigned int split)
+	{
+		const float t = static_cast<float>(split) / static_cast<float>(ShadowCascades::CascadesCount);
+		return glm::mix(glm::mix(nearPlane, farPlane, t), nearPlane * glm::pow(farPlane / nearPlane, t), splitLogWeight);
+	}
+}
+
+ShadowCascades::~ShadowCascades()
+{
+	const unsigned int textures[] = { m_texture, m_cacheTexture };
+	glDeleteTextures(2, textures);
+	glDeleteFramebuffers(1, &m_framebuffer);
+}
+
+ShadowCascades::Cascade ShadowCascades::FitCascade(const Camera& camera, glm::vec3 lightDirection, float start, float end) const
+{
+	// Sphere around the slice, centered on the view axis where it is as far from the near corners
+	// as from the far ones, or at the far plane for slices wider than they are deep
+	const float tanHalfFov = glm::tan(glm::radians(camera.GetFovY()) * 0.5f);
+	const float cornerSlope = tanHalfFov * tanHalfFov * (1.0f + camera.GetAspectRatio() * camera.GetAspectRatio());
+	const float centerDepth = std::min(end, 0.5f * (start + end) * (1.0f + cornerSlope));
+	const float radius = glm::sqrt(std::max(
+		(end - centerDepth) * (end - centerDepth) + end * end * cornerSlope,
+		(centerDepth - start) * (centerDepth - start) + start * start * cornerSlope));
+	const glm::vec3 center = glm::vec3(glm::inverse(camera.GetMatrix()) * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+
+	Cascade cascade;
+	cascade.end = end;
+
+	// Grown so the sphere still fits after snapping, with the step a whole number of texels
+	const float extent = radius / (1.0f - 2.0f * SnapTexels / static_cast<float>(Resolution));
+	cascade.extent = extent;
+	cascade.texelSize = 2.0f * extent / Resolution;
+	const float step = cascade.texelSize * SnapTexels;
+
+	const glm::vec3 up = glm::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	const glm::mat4 rotation = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+	const glm::vec3 snappedCenter = glm::round(glm::vec3(rotation * glm::vec4(center, 1.0f)) / step) * step;
+	cascade.view = glm::translate(glm::mat4(1.0f), -snappedCenter) * rotation;
+
+	// Casters up to the shadow distance towards the sun still shadow the slice
+	cascade.projection = glm::ortho(-extent, extent, -extent, extent, -(extent + m_shadowDistance), extent);
+	return cascade;
+}
+
+void ShadowCascades::BeginLayer(unsigned int texture, unsigned int layer, const Cascade& cascade, glm::vec3 lightDirection)
+{
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, static_cast<int>(layer));
+
+	m_depthShader->Use();
+	m_depthShader->SetMat4("view", cascade.view);
+	m_depthShader->SetMat4("perspective", cascade.projection);
+	m_depthShader->SetVector3("cameraPosition", -lightDirection * billboardTargetDistance);
+}
+
+void ShadowCascades::Render(const Camera& camera, const std::vector<Sun>& suns, const Scene& scene, const std::vector<const Scatter*>& scatters)
+{
+	m_active = false;
+	m_cachedCascadesRendered = 0;
+	m_dynamicCastersDrawn = 0;
+	if (!m_enabled || suns.empty() || glm::dot(suns[0].direction, suns[0].direction) == 0.0f ||
+		!m_depthShader || m_depthShader->GetId() == 0)
+		return;
+
+	if (m_framebuffer == 0)
+	{
+		m_texture = createDepthArray(true);
+		m_cacheTexture = createDepthArray(false);
+		glGenFramebuffers(1, &m_framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+
+	m_active = true;
+	const glm::vec3 lightDirection = glm::normalize(suns[0].direction);
+	const bool staticGeometryChanged = m_invalidated || scene.GetStaticGeometryVersion() != m_staticGeometryVersion;
+	m_invalidated = false;
+	m_staticGeometryVersion = scene.GetStaticGeometryVersion();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, Resolution, Resolution);
+	// Keeps surfaces from shadowing themselves where the depth is rounded differently
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1.5f, 2.0f);
+
+	const float farPlane = std::min(m_shadowDistance, Camera::GetFarPlane());
+	for (unsigned int i = 0; i < CascadesCount; i++)
+	{
+		Cascade cascade = FitCascade(camera, lightDirection,
+			splitDepth(Camera::GetNearPlane(), farPlane, i), splitDepth(Camera::GetNearPlane(), farPlane, i + 1));
+		Cascade& previous = m_cascades[i];
+		const bool moved = cascade.view != previous.view || cascade.projection != previous.projection;
+
+		const Frustum frustum = Frustum::FromMatrix(cascade.projection * cascade.view);
+		m_casters.clear();
+		scene.QueryFrustum(frustum, m_casters);
+		m_dynamicCasters.clear();
+		for (const EntityHandle handle : m_casters)
+		{
+			const Entity* entity = scene.Get(handle);
+			if (entity && entity->GetModel() && scene.GetIsDynamic(handle))
+				m_dynamicCasters.push_back(handle);
+		}
+
+		const bool renderCache = staticGeometryChanged || moved;
+		if (renderCache)
+		{
+			BeginLayer(m_cacheTexture, i, cascade, lightDirection);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			for (const EntityHandle handle : m_casters)
+			{
+				const Entity* entity = scene.Get(handle);
+				if (entity && entity->GetModel() && !scene.GetIsDynamic(handle))
+					entity->DrawShadow(*m_depthShader, selectLod(scene, handle, *entity, cascade.extent));
+			}
+
+			for (const Scatter* scatter : scatters)
+				scatter->DrawShadow(frustum, cascade.extent, lightDirection, *m_depthShader);
+
+			m_cachedCascadesRendered++;
+		}
+
+		// Layers without dynamic casters now or last frame are still what the cache holds
+		if (renderCache || !m_dynamicCasters.empty() || previous.hasDynamicCasters)
+		{
+			glCopyImageSubData(
+				m_cacheTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<int>(i),
+				m_texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<int>(i),
+				Resolution, Resolution, 1);
+
+			if (!m_dynamicCasters.empty())
+			{
+				BeginLayer(m_texture, i, cascade, lightDirection);
+				for (const EntityHandle handle : m_dynamicCasters)
+				{
+					const Entity& entity = *scene.Get(handle);
+					entity.DrawShadow(*m_depthShader, selectLod(scene, handle, entity, cascade.extent));
+				}
+				m_dynamicCastersDrawn += static_cast<unsigned int>(m_dynamicCasters.size());
+			}
+		}
+
+		cascade.hasDynamicCasters = !m_dynamicCasters.empty();
+		previous = cascade;
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+}
+
+void ShadowCascades::Apply(ShaderProgram& shader) const
+{
+	shader.Use();
+	shader.SetInt("sunShadows", m_active);
+	shader.SetInt("showShadowCascades", m_active && m_showCascades);
+	if (!m_active)
+		return;
+
+	glActiveTexture(GL_TEXTURE0 + TextureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+	glActiveTexture(GL_TEXTURE0);
+
+	// From clip space to the texture's [0, 1] range
+	const glm::mat4 toTexture = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)), glm::vec3(0.5f));
+	for (unsigned int i = 0; i < CascadesCount; i++)
+	{
+		const Cascade& cascade = m_cascades[i];
+		const std::string index = std::to_string(i);
+		shader.SetMat4("shadowMatrices[" + index + "]", toTexture * cascade.projection * cascade.view);
+		shader.SetFloat("cascadeEnds[" + index + "]", cascade.end);
+		shader.SetFloat("shadowTexelSizes[" + index + "]", cascade.texelSize);
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "scatter.h"
+#include "scene.h"
+#include "shaderprogram.h"
+#include "sun.h"
+
+// Cascaded shadow maps of the first sun. The camera frustum up to the shadow distance is split
+// into slices, each covered by an orthographic view from the sun rendered into one layer of a
+// depth texture array, so nearby shadows get as many texels as far away ones.
+//
+// Every cascade is fitted to a sphere around its slice, whose size doesn't change as the camera
+// turns, and its center is snapped to a grid of SnapTexels texels in the sun's view. A cascade
+// only moves once the camera crossed a grid cell, and its static casters, the scatters and the
+// entities neither updating themselves nor moved by an ancestor that does, see Scene::GetIsDynamic,
+// are cached in a second texture array until it moves, the sun turns or the scene's static
+// geometry changes. Dynamic entities are drawn every frame onto a copy of the cached layer. Casters
+// draw the level of detail matching their size in the cascade rather than the camera's, so a
+// cached layer stays valid however the camera moves within a grid cell. The casters of a cascade
+// are culled against its view with the scene's BVH and the scatters rerun their GPU culling for it.
+class ShadowCascades
+{
+public:
+	// Match SHADOW_CASCADES and the shadow map binding of lighting.glsl
+	static constexpr unsigned int CascadesCount = 4;
+	static constexpr int TextureUnit = 9;
+
+	static constexpr int Resolution = 2048;
+	// Cascades move in steps of this many texels, the cascade grows by as much to still cover its slice
+	static constexpr int SnapTexels = 64;
+
+	explicit ShadowCascades(ShaderProgram* depthShader) : m_depthShader(depthShader) {}
+	~ShadowCascades();
+
+	ShadowCascades(const ShadowCascades&) = delete;
+	ShadowCascades& operator=(const ShadowCascades&) = delete;
+
+	// Renders the cascades that moved or hold dynamic casters. Call after the scene's Update and
+	// before drawing it. Can leave the shadow framebuffer and viewport bound.
+	void Render(const Camera& camera, const std::vector<Sun>& suns, const Scene& scene, const std::vector<const Scatter*>& scatters);
+
+	// Sets the shadow uniforms of a program built from fragmentShader.glsl or deferredLighting.glsl
+	void Apply(ShaderProgram& shader) const;
+
+	// Redraws the cached casters on the next Render, e.g. after a scatter was generated again
+	void Invalidate() { m_invalidated = true; }
+
+	void SetEnabled(bool enabled) { m_enabled = enabled; }
+	[[nodiscard]] bool GetEnabled() const { return m_enabled; }
+
+	// How far from the camera the cascades reach, past it suns don't cast shadows
+	void SetShadowDistance(float shadowDistance) { m_shadowDistance = shadowDistance; }
+	[[nodiscard]] float GetShadowDistance() const { return m_shadowDistance; }
+
+	// Tints the image by the cascade each pixel samples
+	void SetShowCascades(bool showCascades) { m_showCascades = showCascades; }
+	[[nodiscard]] bool GetShowCascades() const { return m_showCascades; }
+
+	// Counters of the last Render
+	[[nodiscard]] unsigned int GetCachedCascadesRendered() const { return m_cachedCascadesRendered; }
+	[[nodiscard]] unsigned int GetDynamicCastersDrawn() const { return m_dynamicCastersDrawn; }
+
+private:
+	struct Cascade
+	{
+		glm::mat4 view = glm::mat4(1.0f);
+		glm::mat4 projection = glm::mat4(1.0f);
+		float end = 0.0f;
+		// Half the width and height of the view
+		float extent = 0.0f;
+		float texelSize = 0.0f;
+		// Whether the layer sampled holds dynamic casters on top of the cache
+		bool hasDynamicCasters = false;
+	};
+
+	[[nodiscard]] Cascade FitCascade(const Camera& camera, glm::vec3 lightDirection, float start, float end) const;
+	void BeginLayer(unsigned int texture, unsigned int layer, const Cascade& cascade, glm::vec3 lightDirection);
+
+	ShaderProgram* m_depthShader;
+	bool m_enabled = true;
+	bool m_showCascades = false;
+	float m_shadowDistance = 250.0f;
+	// Active while the last Render had a sun to cast shadows
+	bool m_active = false;
+
+	std::array<Cascade, CascadesCount> m_cascades{};
+	bool m_invalidated = true;
+	unsigned long long m_staticGeometryVersion = 0;
+	unsigned int m_cachedCascadesRendered = 0;
+	unsigned int m_dynamicCastersDrawn = 0;
+
+	unsigned int m_framebuffer = 0;
+	// Sampled by the shaders
+	unsigned int m_texture = 0;
+	// Static casters only, copied into m_texture before the dynamic casters are drawn
+	unsigned int m_cacheTexture = 0;
+
+	std::vector<EntityHandle> m_casters;
+	std::vector<EntityHandle> m_dynamicCasters;
+};
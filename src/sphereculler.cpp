@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cstring>
+
+#include "sphereculler.h"
+#include "threadpool.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ENTITIES_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define ENTITIES_TARGET_AVX2
+#else
+#define ENTITIES_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+	// Padding spheres sit behind every plane
+	constexpr float paddingRadius = -1e30f;
+
+	bool CpuSupportsAvx2()
+	{
+#if defined(ENTITIES_X86) && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		__cpuid(info, 1);
+		const bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+		__cpuidex(info, 7, 0);
+		return osSavesYmm && (info[1] & (1 << 5));
+#elif defined(ENTITIES_X86)
+		return __builtin_cpu_supports("avx2");
+#else
+		return false;
+#endif
+	}
+
+	void AppendMask(unsigned int mask, unsigned int firstIndex, std::vector<unsigned int>& visible)
+	{
+		while (mask)
+		{
+#if defined(_MSC_VER)
+			unsigned long bit;
+			_BitScanForward(&bit, mask);
+#else
+			const unsigned int bit = __builtin_ctz(mask);
+#endif
+			visible.push_back(firstIndex + bit);
+			mask &= mask - 1;
+		}
+	}
+
+	void CullScalar(const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius,
+		size_t begin, size_t end, std::vector<unsigned int>& visible)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			bool inside = true;
+			for (const glm::vec4& plane : frustum.planes)
+				inside &= plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w >= -radius[i];
+
+			if (inside)
+				visible.push_back(static_cast<unsigned int>(i));
+		}
+	}
+
+#if defined(ENTITIES_X86)
+	void CullSse(const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius,
+		size_t begin, size_t end, std::vector<unsigned int>& visible)
+	{
+		__m128 planeX[Frustum::PlanesCount], planeY[Frustum::PlanesCount], planeZ[Frustum::PlanesCount], planeW[Frustum::PlanesCount];
+		for (int p = 0; p < Frustum::PlanesCount; p++)
+		{
+			planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+			planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+			planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+			planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+		}
+
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		for (size_t i = begin; i < end; i += 4)
+		{
+			const __m128 sx = _mm_loadu_ps(x + i);
+			const __m128 sy = _mm_loadu_ps(y + i);
+			const __m128 sz = _mm_loadu_ps(z + i);
+			const __m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(radius + i), signMask);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < Frustum::PlanesCount; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_mul_ps(planeX[p], sx), planeW[p]);
+				distance = _mm_add_ps(_mm_mul_ps(planeY[p], sy), distance);
+				distance = _mm_add_ps(_mm_mul_ps(planeZ[p], sz), distance);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+			}
+
+			AppendMask(static_cast<unsigned int>(_mm_movemask_ps(inside)), static_cast<unsigned int>(i), visible);
+		}
+	}
+
+	ENTITIES_TARGET_AVX2
+	void CullAvx2(const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius,
+		size_t begin, size_t end, std::vector<unsigned int>& visible)
+	{
+		__m256 planeX[Frustum::PlanesCount], planeY[Frustum::PlanesCount], planeZ[Frustum::PlanesCount], planeW[Frustum::PlanesCount];
+		for (int p = 0; p < Frustum::PlanesCount; p++)
+		{
+			planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+			planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+			planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+			planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+		}
+
+		const __m256 signMask = _mm256_set1_ps(-0.0f);
+		for (size_t i = begin; i < end; i += 8)
+		{
+			const __m256 sx = _mm256_loadu_ps(x + i);
+			const __m256 sy = _mm256_loadu_ps(y + i);
+			const __m256 sz = _mm256_loadu_ps(z + i);
+			const __m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(radius + i), signMask);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < Frustum::PlanesCount; p++)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(planeX[p], sx), planeW[p]);
+				distance = _mm256_add_ps(_mm256_mul_ps(planeY[p], sy), distance);
+				distance = _mm256_add_ps(_mm256_mul_ps(planeZ[p], sz), distance);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+			}
+
+			AppendMask(static_cast<unsigned int>(_mm256_movemask_ps(inside)), static_cast<unsigned int>(i), visible);
+		}
+	}
+#endif
+}
+
+SphereCuller::SphereCuller()
+{
+	if (IsKernelSupported(Kernel::Avx2))
+		m_kernel = Kernel::Avx2;
+	else if (IsKernelSupported(Kernel::Sse))
+		m_kernel = Kernel::Sse;
+}
+
+void SphereCuller::Resize(size_t count)
+{
+	const size_t paddedCount = (count + BlockSize - 1) / BlockSize * BlockSize;
+
+	m_x.resize(paddedCount, 0.0f);
+	m_y.resize(paddedCount, 0.0f);
+	m_z.resize(paddedCount, 0.0f);
+	m_radius.resize(paddedCount, paddingRadius);
+
+	// Shrinking leaves stale spheres in the padding of the last block
+	std::fill(m_radius.begin() + count, m_radius.end(), paddingRadius);
+
+	m_count = count;
+}
+
+void SphereCuller::Set(size_t index, const BoundingSphere& sphere)
+{
+	m_x[index] = sphere.center.x;
+	m_y[index] = sphere.center.y;
+	m_z[index] = sphere.center.z;
+	m_radius[index] = sphere.radius;
+}
+
+BoundingSphere SphereCuller::Get(size_t index) const
+{
+	return { glm::vec3(m_x[index], m_y[index], m_z[index]), m_radius[index] };
+}
+
+void SphereCuller::Cull(const Frustum& frustum, std::vector<unsigned int>& visible, ThreadPool* threadPool)
+{
+	visible.clear();
+
+	const size_t blocksCount = m_x.size() / BlockSize;
+	const size_t tasksCount = threadPool ?
+		std::min<size_t>((threadPool->GetWorkersCount() + 1) * 4, (blocksCount + MinBlocksPerTask - 1) / MinBlocksPerTask) : 1;
+
+	if (tasksCount <= 1)
+	{
+		CullRange(frustum, 0, blocksCount, visible);
+		return;
+	}
+
+	// Every task compacts into its own list, they're stitched together in order afterwards
+	if (m_taskResults.size() < tasksCount)
+		m_taskResults.resize(tasksCount);
+
+	const size_t blocksPerTask = (blocksCount + tasksCount - 1) / tasksCount;
+	threadPool->ParallelFor(tasksCount, 1, [&](size_t begin, size_t end) {
+		for (size_t task = begin; task < end; task++)
+		{
+			std::vector<unsigned int>& result = m_taskResults[task];
+			result.clear();
+			CullRange(frustum, task * blocksPerTask, std::min((task + 1) * blocksPerTask, blocksCount), result);
+		}
+	});
+
+	size_t total = 0;
+	for (size_t task = 0; task < tasksCount; task++)
+		total += m_taskResults[task].size();
+
+	visible.resize(total);
+	size_t offset = 0;
+	for (size_t task = 0; task < tasksCount; task++)
+	{
+		const std::vector<unsigned int>& result = m_taskResults[task];
+		if (!result.empty())
+			std::memcpy(visible.data() + offset, result.data(), result.size() * sizeof(unsigned int));
+		offset += result.size();
+	}
+}
+
+void SphereCuller::CullRange(const Frustum& frustum, size_t firstBlock, size_t lastBlock, std::vector<unsigned int>& visible) const
+{
+	if (firstBlock >= lastBlock)
+		return;
+
+	const size_t begin = firstBlock * BlockSize;
+	const size_t end = lastBlock * BlockSize;
+
+	switch (m_kernel)
+	{
+#if defined(ENTITIES_X86)
+	case Kernel::Avx2:
+		CullAvx2(frustum, m_x.data(), m_y.data(), m_z.data(), m_radius.data(), begin, end, visible);
+		break;
+	case Kernel::Sse:
+		CullSse(frustum, m_x.data(), m_y.data(), m_z.data(), m_radius.data(), begin, end, visible);
+		break;
+#endif
+	default:
+		CullScalar(frustum, m_x.data(), m_y.data(), m_z.data(), m_radius.data(), begin, end, visible);
+		break;
+	}
+}
+
+void SphereCuller::SetKernel(Kernel kernel)
+{
+	if (IsKernelSupported(kernel))
+		m_kernel = kernel;
+}
+
+bool SphereCuller::IsKernelSupported(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::Scalar:
+		return true;
+#if defined(ENTITIES_X86)
+	case Kernel::Sse:
+		return true;
+	case Kernel::Avx2:
+	{
+		static const bool supported = CpuSupportsAvx2();
+		return supported;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+const char* SphereCuller::GetKernelName(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::Sse:
+		return "SSE";
+	case Kernel::Avx2:
+		return "AVX2";
+	default:
+		return "Scalar";
+	}
+}
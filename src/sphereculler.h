@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+#include "bounds.h"
+#include "frustum.h"
+
+class ThreadPool;
+
+// Frustum culling over bounding spheres stored as structure of arrays, so the planes can be
+// tested against 4 (SSE) or 8 (AVX2) spheres at once. The widest kernel supported by the
+// CPU is picked at runtime.
+class SphereCuller
+{
+public:
+	enum class Kernel { Scalar, Sse, Avx2 };
+
+	SphereCuller();
+
+	void Resize(size_t count);
+	[[nodiscard]] size_t Size() const { return m_count; }
+
+	void Set(size_t index, const BoundingSphere& sphere);
+	[[nodiscard]] BoundingSphere Get(size_t index) const;
+
+	// Writes indices of the spheres intersecting the frustum in increasing order
+	void Cull(const Frustum& frustum, std::vector<unsigned int>& visible, ThreadPool* threadPool = nullptr);
+
+	void SetKernel(Kernel kernel);
+	[[nodiscard]] Kernel GetKernel() const { return m_kernel; }
+	[[nodiscard]] static bool IsKernelSupported(Kernel kernel);
+	[[nodiscard]] static const char* GetKernelName(Kernel kernel);
+
+private:
+	// Spheres are processed in blocks of this many, padding is never visible
+	static constexpr size_t BlockSize = 8;
+	// Keep tasks large enough to hide the scheduling cost
+	static constexpr size_t MinBlocksPerTask = 512;
+
+	void CullRange(const Frustum& frustum, size_t firstBlock, size_t lastBlock, std::vector<unsigned int>& visible) const;
+
+	size_t m_count = 0;
+	std::vector<float> m_x;
+	std::vector<float> m_y;
+	std::vector<float> m_z;
+	std::vector<float> m_radius;
+
+	Kernel m_kernel = Kernel::Scalar;
+
+	std::vector<std::vector<unsigned int>> m_taskResults;
+};
@@ -0,0 +1,128 @@
+#include <algorithm>
+
+#include "threadpool.h"
+
+namespace
+{
+	// Pool whose chunks the current thread is running, the caller of ParallelFor or a worker
+	thread_local const ThreadPool* runningPool = nullptr;
+}
+
+ThreadPool::ThreadPool(unsigned int workersCount)
+{
+	m_workers.reserve(workersCount);
+	for (unsigned int i = 0; i < workersCount; i++)
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stopping = true;
+	}
+	m_workAvailable.notify_all();
+
+	for (std::thread& worker : m_workers)
+		worker.join();
+}
+
+ThreadPool& ThreadPool::Shared()
+{
+	static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+	return pool;
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t minChunkSize, const RangeFunc& func)
+{
+	if (count == 0)
+		return;
+
+	const size_t threadsCount = m_workers.size() + 1;
+	// A few chunks per thread so uneven chunks still balance out
+	const size_t chunkSize = std::max(std::max(minChunkSize, size_t(1)), (count + threadsCount * 4 - 1) / (threadsCount * 4));
+	const size_t chunksCount = (count + chunkSize - 1) / chunkSize;
+
+	// Nested loops run inline, the workers are busy with the outer loop
+	if (m_workers.empty() || chunksCount == 1 || runningPool == this)
+	{
+		func(0, count);
+		return;
+	}
+
+	// Only one loop at a time can own the workers
+	std::lock_guard callLock(m_callMutex);
+
+	{
+		std::lock_guard lock(m_mutex);
+		m_job = &func;
+		m_jobCount = count;
+		m_chunkSize = chunkSize;
+		m_chunksCount = chunksCount;
+		m_nextChunk = 0;
+		m_finishedChunks = 0;
+		m_jobGeneration++;
+	}
+	m_workAvailable.notify_all();
+
+	RunChunks();
+
+	std::unique_lock lock(m_mutex);
+	m_workDone.wait(lock, [this] { return m_finishedChunks == m_chunksCount && m_activeWorkers == 0; });
+	m_job = nullptr;
+}
+
+void ThreadPool::RunChunks()
+{
+	const ThreadPool* const outerPool = runningPool;
+	runningPool = this;
+
+	while (true)
+	{
+		const size_t chunk = m_nextChunk.fetch_add(1);
+		if (chunk >= m_chunksCount)
+			break;
+
+		const size_t begin = chunk * m_chunkSize;
+		const size_t end = std::min(begin + m_chunkSize, m_jobCount);
+		(*m_job)(begin, end);
+
+		if (m_finishedChunks.fetch_add(1) + 1 == m_chunksCount)
+		{
+			std::lock_guard lock(m_mutex);
+			m_workDone.notify_all();
+		}
+	}
+
+	runningPool = outerPool;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	unsigned long long seenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock lock(m_mutex);
+			m_workAvailable.wait(lock, [&] { return m_stopping || m_jobGeneration != seenGeneration; });
+			if (m_stopping)
+				return;
+
+			seenGeneration = m_jobGeneration;
+			// The job may have already been finished by the other threads
+			if (!m_job)
+				continue;
+
+			m_activeWorkers++;
+		}
+
+		RunChunks();
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_activeWorkers--;
+		}
+		m_workDone.notify_all();
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data parallel loops. The calling thread always
+// takes part in the work, so a pool with zero workers simply runs serially.
+class ThreadPool
+{
+public:
+	using RangeFunc = std::function<void(size_t begin, size_t end)>;
+
+	explicit ThreadPool(unsigned int workersCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Splits [0, count) into chunks of at least minChunkSize and blocks until all of them ran.
+	// Called from inside a chunk of the same pool it runs the whole range inline.
+	void ParallelFor(size_t count, size_t minChunkSize, const RangeFunc& func);
+
+	[[nodiscard]] unsigned int GetWorkersCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+	// Pool shared by the engine systems, one worker per hardware thread besides the main one
+	static ThreadPool& Shared();
+
+private:
+	void WorkerLoop();
+	void RunChunks();
+
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_workDone;
+	unsigned long long m_jobGeneration = 0;
+	bool m_stopping = false;
+
+	const RangeFunc* m_job = nullptr;
+	size_t m_jobCount = 0;
+	size_t m_chunkSize = 0;
+	size_t m_chunksCount = 0;
+	std::atomic<size_t> m_nextChunk = 0;
+	std::atomic<size_t> m_finishedChunks = 0;
+	unsigned int m_activeWorkers = 0;
+
+	std::mutex m_callMutex;
+};
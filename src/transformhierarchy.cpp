@@ -0,0 +1,240 @@
+#include <algorithm>
+
+#include "transformhierarchy.h"
+#include "threadpool.h"
+
+void TransformHierarchy::Add(unsigned int node)
+{
+	if (node >= m_links.size())
+		m_links.resize(node + 1);
+
+	// New nodes go to the end as roots, no need to rebuild the whole order
+	const unsigned int position = static_cast<unsigned int>(m_order.size());
+	const unsigned int root = static_cast<unsigned int>(m_rootRanges.size());
+
+	m_links[node] = Links{ .position = position, .alive = true };
+	m_order.push_back(node);
+	m_parentPosition.push_back(NoPosition);
+	m_rootOf.push_back(root);
+	m_local.emplace_back(1.0f);
+	m_world.emplace_back(1.0f);
+	m_dirty.push_back(1);
+	m_updated.push_back(0);
+
+	m_rootRanges.push_back({ position, position + 1 });
+	m_rootDirty.push_back(1);
+	m_dirtyRoots.push_back(root);
+}
+
+void TransformHierarchy::Remove(unsigned int node)
+{
+	if (node >= m_links.size() || !m_links[node].alive)
+		return;
+
+	const unsigned int parent = m_links[node].parent;
+	const glm::mat4 local = m_local[m_links[node].position];
+
+	unsigned int child = m_links[node].firstChild;
+	while (child != NoParent)
+	{
+		const unsigned int next = m_links[child].nextSibling;
+		// The rebuild marks every node dirty, no need to go through SetLocal
+		m_local[m_links[child].position] = local * m_local[m_links[child].position];
+		Unlink(child);
+		Link(child, parent);
+		child = next;
+	}
+
+	Unlink(node);
+	m_links[node].firstChild = NoParent;
+	m_links[node].alive = false;
+	m_structureChanged = true;
+}
+
+bool TransformHierarchy::SetParent(unsigned int node, unsigned int parent)
+{
+	for (unsigned int ancestor = parent; ancestor != NoParent; ancestor = m_links[ancestor].parent)
+	{
+		if (ancestor == node)
+			return false;
+	}
+
+	if (m_links[node].parent == parent)
+		return true;
+
+	Unlink(node);
+	Link(node, parent);
+
+	m_structureChanged = true;
+	return true;
+}
+
+unsigned int TransformHierarchy::GetParent(unsigned int node) const
+{
+	return node < m_links.size() ? m_links[node].parent : NoParent;
+}
+
+void TransformHierarchy::SetLocal(unsigned int node, const glm::mat4& local)
+{
+	const unsigned int position = m_links[node].position;
+	m_local[position] = local;
+	m_dirty[position] = 1;
+
+	const unsigned int root = m_rootOf[position];
+	if (!m_rootDirty[root])
+	{
+		m_rootDirty[root] = 1;
+		m_dirtyRoots.push_back(root);
+	}
+}
+
+const glm::mat4& TransformHierarchy::GetLocal(unsigned int node) const
+{
+	return m_local[m_links[node].position];
+}
+
+const glm::mat4& TransformHierarchy::GetWorld(unsigned int node) const
+{
+	return m_world[m_links[node].position];
+}
+
+bool TransformHierarchy::WasUpdated(unsigned int node) const
+{
+	return m_updated[m_links[node].position];
+}
+
+void TransformHierarchy::Update(ThreadPool* threadPool)
+{
+	std::fill(m_updated.begin(), m_updated.end(), 0);
+
+	if (m_structureChanged)
+		Rebuild();
+
+	const auto updateRoots = [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			const RootRange& range = m_rootRanges[m_dirtyRoots[i]];
+			UpdateSubtree(range.begin, range.end);
+		}
+	};
+
+	// Most roots are single nodes, so hand out plenty of them per task
+	if (threadPool)
+		threadPool->ParallelFor(m_dirtyRoots.size(), 64, updateRoots);
+	else
+		updateRoots(0, m_dirtyRoots.size());
+
+	for (unsigned int root : m_dirtyRoots)
+		m_rootDirty[root] = 0;
+	m_dirtyRoots.clear();
+}
+
+void TransformHierarchy::UpdateSubtree(unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin; i < end; i++)
+	{
+		const unsigned int parent = m_parentPosition[i];
+		const bool parentUpdated = parent != NoPosition && m_updated[parent];
+		if (!m_dirty[i] && !parentUpdated)
+			continue;
+
+		m_world[i] = parent != NoPosition ? m_world[parent] * m_local[i] : m_local[i];
+		m_dirty[i] = 0;
+		m_updated[i] = 1;
+	}
+}
+
+void TransformHierarchy::Rebuild()
+{
+	const size_t nodesCount = std::count_if(m_links.begin(), m_links.end(),
+		[](const Links& links) { return links.alive; });
+
+	std::vector<unsigned int> order;
+	std::vector<unsigned int> parentPosition;
+	std::vector<unsigned int> rootOf;
+	std::vector<glm::mat4> local;
+	std::vector<RootRange> rootRanges;
+	order.reserve(nodesCount);
+	parentPosition.reserve(nodesCount);
+	rootOf.reserve(nodesCount);
+	local.reserve(nodesCount);
+
+	std::vector<unsigned int> stack;
+	for (unsigned int root = 0; root < m_links.size(); root++)
+	{
+		if (!m_links[root].alive || m_links[root].parent != NoParent)
+			continue;
+
+		const unsigned int rootBegin = static_cast<unsigned int>(order.size());
+		const unsigned int rootIndex = static_cast<unsigned int>(rootRanges.size());
+
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			const unsigned int node = stack.back();
+			stack.pop_back();
+
+			const unsigned int parent = m_links[node].parent;
+
+			local.push_back(m_local[m_links[node].position]);
+			m_links[node].position = static_cast<unsigned int>(order.size());
+			order.push_back(node);
+			// Parents are always visited first so their new position is already known
+			parentPosition.push_back(parent != NoParent ? m_links[parent].position : NoPosition);
+			rootOf.push_back(rootIndex);
+
+			for (unsigned int child = m_links[node].firstChild; child != NoParent; child = m_links[child].nextSibling)
+				stack.push_back(child);
+		}
+
+		rootRanges.push_back({ rootBegin, static_cast<unsigned int>(order.size()) });
+	}
+
+	for (Links& links : m_links)
+	{
+		if (!links.alive)
+			links.position = NoPosition;
+	}
+
+	m_order = std::move(order);
+	m_parentPosition = std::move(parentPosition);
+	m_rootOf = std::move(rootOf);
+	m_local = std::move(local);
+	m_world.resize(m_order.size());
+	// Anything could have been moved under a new parent, recompute everything once
+	m_dirty.assign(m_order.size(), 1);
+	m_updated.assign(m_order.size(), 0);
+
+	m_rootRanges = std::move(rootRanges);
+	m_rootDirty.assign(m_rootRanges.size(), 1);
+	m_dirtyRoots.resize(m_rootRanges.size());
+	for (unsigned int root = 0; root < m_rootRanges.size(); root++)
+		m_dirtyRoots[root] = root;
+
+	m_structureChanged = false;
+}
+
+void TransformHierarchy::Unlink(unsigned int node)
+{
+	const unsigned int parent = m_links[node].parent;
+	if (parent == NoParent)
+		return;
+
+	unsigned int* link = &m_links[parent].firstChild;
+	while (*link != node)
+		link = &m_links[*link].nextSibling;
+	*link = m_links[node].nextSibling;
+
+	m_links[node].nextSibling = NoParent;
+	m_links[node].parent = NoParent;
+}
+
+void TransformHierarchy::Link(unsigned int node, unsigned int parent)
+{
+	if (parent == NoParent)
+		return;
+
+	m_links[node].parent = parent;
+	m_links[node].nextSibling = m_links[parent].firstChild;
+	m_links[parent].firstChild = node;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class ThreadPool;
+
+// Parent/child transforms for nodes identified by small integer ids.
+// Transforms are stored in depth-first order so world matrices are computed in one linear pass
+// where a parent is always processed before its children. Root subtrees are independent
+// and get processed in parallel; subtrees without changes are skipped entirely.
+class TransformHierarchy
+{
+public:
+	static constexpr unsigned int NoParent = ~0u;
+
+	void Add(unsigned int node);
+	// Children of a removed node are attached to its parent, with the removed node's local
+	// transform folded into theirs so they stay in place
+	void Remove(unsigned int node);
+
+	// Returns false when the new parent would create a cycle
+	bool SetParent(unsigned int node, unsigned int parent);
+	[[nodiscard]] unsigned int GetParent(unsigned int node) const;
+
+	template<typename Function>
+	void ForEachChild(unsigned int node, Function function) const
+	{
+		for (unsigned int child = m_links[node].firstChild; child != NoParent; child = m_links[child].nextSibling)
+			function(child);
+	}
+
+	void SetLocal(unsigned int node, const glm::mat4& local);
+	[[nodiscard]] const glm::mat4& GetLocal(unsigned int node) const;
+	[[nodiscard]] const glm::mat4& GetWorld(unsigned int node) const;
+	// True when the world matrix changed in the last Update
+	[[nodiscard]] bool WasUpdated(unsigned int node) const;
+
+	void Update(ThreadPool* threadPool = nullptr);
+
+	[[nodiscard]] size_t Size() const { return m_order.size(); }
+
+private:
+	static constexpr unsigned int NoPosition = ~0u;
+
+	void Rebuild();
+	void UpdateSubtree(unsigned int begin, unsigned int end);
+	void Unlink(unsigned int node);
+	void Link(unsigned int node, unsigned int parent);
+
+	// Tree structure by node id, only walked when the order is rebuilt
+	struct Links
+	{
+		unsigned int parent = NoParent;
+		unsigned int firstChild = NoParent;
+		unsigned int nextSibling = NoParent;
+		unsigned int position = NoPosition;
+		bool alive = false;
+	};
+	std::vector<Links> m_links;
+	bool m_structureChanged = false;
+
+	// Depth-first ordered data
+	std::vector<unsigned int> m_order;
+	std::vector<unsigned int> m_parentPosition;
+	std::vector<unsigned int> m_rootOf;
+	std::vector<glm::mat4> m_local;
+	std::vector<glm::mat4> m_world;
+	std::vector<unsigned char> m_dirty;
+	std::vector<unsigned char> m_updated;
+
+	// Position ranges of root subtrees
+	struct RootRange
+	{
+		unsigned int begin;
+		unsigned int end;
+	};
+	std::vector<RootRange> m_rootRanges;
+	std::vector<unsigned char> m_rootDirty;
+	std::vector<unsigned int> m_dirtyRoots;
+};
@@ -0,0 +1,145 @@
+// Checks of the light ranges and spot light bounds the light culling relies on.
+// Returns non-zero when one fails, so ctest can run it.
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <glm/glm.hpp>
+
+#include "lightrange.h"
+
+namespace
+{
+	int s_failures = 0;
+
+	void check(bool passed, const char* description)
+	{
+		std::cout << (passed ? "passed: " : "FAILED: ") << description << '\n';
+		if (!passed)
+			s_failures++;
+	}
+
+	bool nearlyEqual(float a, float b)
+	{
+		return std::abs(a - b) <= 1e-4f * std::max(std::abs(a), std::abs(b));
+	}
+
+	PointLight pointLight(float constant, float linear, float quadratic)
+	{
+		return {
+			.position = glm::vec3(0.0f),
+			.diffuse = glm::vec3(0.8f, 0.5f, 0.2f),
+			.specular = glm::vec3(1.0f),
+			.constant = constant,
+			.linear = linear,
+			.quadratic = quadratic,
+		};
+	}
+
+	SpotLight spotLight(float outerAngle)
+	{
+		return {
+			.position = glm::vec3(1.0f, 2.0f, 3.0f),
+			.direction = glm::normalize(glm::vec3(1.0f, -1.0f, 0.5f)),
+			.diffuse = glm::vec3(1.0f),
+			.specular = glm::vec3(1.0f),
+			.constant = 1.0f,
+			.linear = 0.09f,
+			.quadratic = 0.032f,
+			.innerCutoff = std::cos(glm::radians(outerAngle * 0.8f)),
+			.outerCutoff = std::cos(glm::radians(outerAngle)),
+		};
+	}
+
+	// Brightest channel of the light attenuated at the distance
+	float attenuated(const PointLight& light, float distance)
+	{
+		return 1.0f / (light.constant + light.linear * distance + light.quadratic * distance * distance);
+	}
+
+	bool contains(const BoundingSphere& sphere, glm::vec3 point)
+	{
+		return glm::distance(sphere.center, point) <= sphere.radius * (1.0f + 1e-4f);
+	}
+
+	// Any direction perpendicular to the spot light's
+	glm::vec3 perpendicular(const SpotLight& light)
+	{
+		return glm::normalize(glm::cross(light.direction, glm::vec3(0.0f, 1.0f, 0.0f)));
+	}
+
+	void checkBounds(const SpotLight& light, float range, const char* apexDescription, const char* rimDescription)
+	{
+		const BoundingSphere bounds = GetSpotLightBounds(light, range);
+		const float sine = std::sqrt(1.0f - light.outerCutoff * light.outerCutoff);
+		const glm::vec3 across = perpendicular(light);
+		const glm::vec3 otherAcross = glm::cross(light.direction, across);
+
+		check(contains(bounds, light.position), apexDescription);
+
+		bool rimContained = contains(bounds, light.position + light.direction * range);
+		for (int i = 0; i < 16; i++)
+		{
+			const float angle = glm::radians(22.5f * static_cast<float>(i));
+			const glm::vec3 side = light.outerCutoff * light.direction
+				+ sine * (std::cos(angle) * across + std::sin(angle) * otherAcross);
+			rimContained = rimContained && contains(bounds, light.position + side * range);
+		}
+		check(rimContained, rimDescription);
+	}
+
+	void checkCulling(const SpotLight& light, float range, const char* outsideDescription,
+		const char* insideDescription, const char* behindDescription, const char* touchingApexDescription)
+	{
+		constexpr float radius = 0.5f;
+		const float sine = std::sqrt(1.0f - light.outerCutoff * light.outerCutoff);
+		const glm::vec3 across = perpendicular(light);
+
+		// Halfway along the cone's side, pushed out along its normal
+		const glm::vec3 side = light.outerCutoff * light.direction + sine * across;
+		const glm::vec3 outward = light.outerCutoff * across - sine * light.direction;
+		const glm::vec3 onSide = light.position + side * (range * 0.5f);
+		check(!IntersectsSpotLight(light, range, { onSide + outward * (radius * 1.01f), radius }), outsideDescription);
+		check(IntersectsSpotLight(light, range, { onSide + outward * (radius * 0.99f), radius }), insideDescription);
+
+		check(!IntersectsSpotLight(light, range, { light.position - light.direction * (radius * 1.01f), radius }), behindDescription);
+		check(IntersectsSpotLight(light, range, { light.position - light.direction * (radius * 0.99f), radius }), touchingApexDescription);
+	}
+}
+
+int main()
+{
+	constexpr float cutoff = DefaultLightIntensityCutoff;
+
+	const PointLight quadratic = pointLight(1.0f, 0.09f, 0.032f);
+	const LightRange quadraticRange = GetLightRange(quadratic, cutoff);
+	check(nearlyEqual(attenuated(quadratic, quadraticRange.range), cutoff), "quadratic falloff ends at the cutoff");
+	check(nearlyEqual(quadraticRange.cutoffAttenuation, cutoff), "quadratic falloff reports the attenuation at its range");
+
+	const PointLight linear = pointLight(1.0f, 0.5f, 0.0f);
+	const LightRange linearRange = GetLightRange(linear, cutoff);
+	check(nearlyEqual(attenuated(linear, linearRange.range), cutoff), "linear falloff ends at the cutoff");
+	check(nearlyEqual(linearRange.cutoffAttenuation, cutoff), "linear falloff reports the attenuation at its range");
+
+	const LightRange constantRange = GetLightRange(pointLight(1.0f, 0.0f, 0.0f), cutoff);
+	check(constantRange.range > 1e9f && constantRange.cutoffAttenuation == 0.0f, "constant attenuation above the cutoff never ends");
+	check(GetLightRange(pointLight(1.0f / cutoff, 0.0f, 0.0f), cutoff).range == 0.0f, "constant attenuation at the cutoff has no range");
+
+	SpotLight spot = spotLight(30.0f);
+	const LightRange spotRange = GetLightRange(spot, cutoff);
+	check(nearlyEqual(spotRange.range, quadraticRange.range), "spot lights attenuate like point lights");
+
+	checkBounds(spot, spotRange.range, "narrow cone bounds hold the apex", "narrow cone bounds hold the cap");
+	checkCulling(spot, spotRange.range, "sphere just outside a narrow cone's side is culled",
+		"sphere just inside a narrow cone's side is kept", "sphere just behind a narrow cone's apex is culled",
+		"sphere touching a narrow cone's apex is kept");
+
+	spot = spotLight(60.0f);
+	checkBounds(spot, spotRange.range, "wide cone bounds hold the apex", "wide cone bounds hold the cap");
+	checkCulling(spot, spotRange.range, "sphere just outside a wide cone's side is culled",
+		"sphere just inside a wide cone's side is kept", "sphere just behind a wide cone's apex is culled",
+		"sphere touching a wide cone's apex is kept");
+
+	return s_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+// Checks of the vertex cache model MeshOptimizer tunes its orders for and reports them with.
+// Returns non-zero when one fails, so ctest can run it.
+
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "meshoptimizer.h"
+
+namespace
+{
+	int s_failures = 0;
+
+	void check(bool passed, const char* description)
+	{
+		std::cout << (passed ? "passed: " : "FAILED: ") << description << '\n';
+		if (!passed)
+			s_failures++;
+	}
+
+	// Every vertex of [0, count) once, then the first one again
+	VertexCacheStats revisitFirst(unsigned int count)
+	{
+		std::vector<unsigned int> indices(count);
+		std::iota(indices.begin(), indices.end(), 0);
+		indices.push_back(0);
+		return MeshOptimizer::AnalyzeVertexCache(indices, count);
+	}
+}
+
+int main()
+{
+	constexpr unsigned int cacheSize = MeshOptimizer::CacheSize;
+
+	// ATVR is 1 when the revisit hits, it's one transform more otherwise
+	check(revisitFirst(cacheSize).atvr == 1.0f, "a vertex followed by CacheSize - 1 others is still cached");
+	check(revisitFirst(cacheSize + 1).atvr > 1.0f, "a vertex followed by CacheSize others was evicted");
+
+	std::vector<unsigned int> indices(2 * cacheSize);
+	std::iota(indices.begin(), indices.begin() + cacheSize, 0);
+	std::iota(indices.begin() + cacheSize, indices.end(), 0);
+	check(MeshOptimizer::AnalyzeVertexCache(indices, cacheSize).atvr == 1.0f, "CacheSize vertices all stay cached");
+
+	return s_failures == 0 ? 0 : 1;
+}
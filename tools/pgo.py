@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""Profile guided optimization of the CMake build, trained on the benchmark scenes.
+
+Builds a plain release baseline, an instrumented build that runs the headless scene benchmark and
+the model loading microbenchmarks to collect profiles, and an optimized build from those profiles.
+Baseline and optimized builds are then measured the same way and compared in a markdown report.
+
+Usage: tools/pgo.py [--build-dir build-pgo] [--frames 300] [--training-frames 60] [--scenes filter]
+                    [--runs 3] [--lto] [--report pgo-report.md]
+
+Needs GCC or Clang (with llvm-profdata), and a GPU or Mesa for the headless EGL or GLFW context.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+TARGETS = ["scenebenchmark", "microbenchmarks"]
+LOAD_FILTER = "ObjParser::LoadFromFile"
+
+
+def run(command, cwd=None):
+    print("+ " + " ".join(str(part) for part in command), flush=True)
+    subprocess.run([str(part) for part in command], cwd=cwd, check=True)
+
+
+def configure_and_build(build_dir, pgo, args):
+    command = ["cmake", "-S", ROOT, "-B", build_dir, "-DCMAKE_BUILD_TYPE=Release", f"-DENTITIES_PGO={pgo}",
+               f"-DENTITIES_LTO={'ON' if args.lto else 'OFF'}"]
+    run(command)
+    run(["cmake", "--build", build_dir, "-j", str(os.cpu_count() or 1), "--target", *TARGETS])
+
+
+def compiler_id(build_dir):
+    for line in (build_dir / "CMakeCache.txt").read_text().splitlines():
+        if line.startswith("CMAKE_CXX_COMPILER_ID:"):
+            return line.split("=", 1)[1]
+    return ""
+
+
+def run_workload(build_dir, output_dir, frames, scenes):
+    """Runs the scene benchmark and the model loading benchmarks, returns their parsed results."""
+    bin_dir = build_dir / "bin"
+    output_dir.mkdir(parents=True, exist_ok=True)
+    scene_json = output_dir / "scenes.json"
+    load_json = output_dir / "load.json"
+    run([bin_dir / "scenebenchmark", scene_json, frames, scenes], cwd=bin_dir)
+    run([bin_dir / "microbenchmarks", LOAD_FILTER, 0.5, load_json], cwd=bin_dir)
+    return json.loads(scene_json.read_text()), json.loads(load_json.read_text())
+
+
+def measure(build_dir, output_dir, args):
+    return [run_workload(build_dir, output_dir / f"run{i}", args.frames, args.scenes) for i in range(args.runs)]
+
+
+def merge_clang_profiles(profile_dir):
+    profdata = shutil.which("llvm-profdata")
+    if not profdata:
+        sys.exit("llvm-profdata is needed to merge Clang profiles")
+    raw = sorted(profile_dir.glob("*.profraw"))
+    if not raw:
+        sys.exit(f"No profiles were written to {profile_dir}")
+    run([profdata, "merge", "-o", profile_dir / "default.profdata", *raw])
+
+
+def median_of(runs, pick):
+    return statistics.median(pick(run) for run in runs)
+
+
+def change(before, after):
+    return f"{(after - before) / before * 100.0:+.1f}%" if before > 0 else "n/a"
+
+
+def write_report(path, baseline, optimized, args):
+    scene_names = [scene["name"] for scene in baseline[0][0]["scenes"]]
+    load_names = [benchmark["name"] for benchmark in baseline[0][1]["benchmarks"]]
+
+    def scene(run, name):
+        return next(s for s in run[0]["scenes"] if s["name"] == name)
+
+    def load(run, name):
+        return next(b for b in run[1]["benchmarks"] if b["name"] == name)
+
+    lines = [
+        "# Profile guided optimization",
+        "",
+        f"Renderer: {baseline[0][0]['renderer']}, {baseline[0][0]['width']}x{baseline[0][0]['height']}, "
+        f"{args.frames} frames per scene, median of {args.runs} runs, trained on {args.training_frames} frames per scene."
+        f" LTO {'on' if args.lto else 'off'} in both builds.",
+        "",
+        "## Frame time",
+        "",
+        "| Scene | CPU mean ms | PGO | Change | CPU p95 ms | PGO | Change | GPU mean ms | PGO | Change |",
+        "|---|---|---|---|---|---|---|---|---|---|",
+    ]
+    for name in scene_names:
+        row = [name]
+        for summary, statistic in (("cpuFrameMs", "mean"), ("cpuFrameMs", "p95"), ("gpuFrameMs", "mean")):
+            before = median_of(baseline, lambda run: scene(run, name)[summary][statistic])
+            after = median_of(optimized, lambda run: scene(run, name)[summary][statistic])
+            row += [f"{before:.3f}", f"{after:.3f}", change(before, after)]
+        lines.append("| " + " | ".join(row) + " |")
+
+    lines += [
+        "",
+        "## Load time",
+        "",
+        "| Workload | Baseline ms | PGO ms | Change |",
+        "|---|---|---|---|",
+    ]
+    before = median_of(baseline, lambda run: run[0]["loadSeconds"] * 1000.0)
+    after = median_of(optimized, lambda run: run[0]["loadSeconds"] * 1000.0)
+    lines.append(f"| Scene benchmark assets | {before:.1f} | {after:.1f} | {change(before, after)} |")
+    for name in load_names:
+        before = median_of(baseline, lambda run: load(run, name)["nanoseconds"] / 1e6)
+        after = median_of(optimized, lambda run: load(run, name)["nanoseconds"] / 1e6)
+        lines.append(f"| {name.split('/', 1)[-1]} | {before:.3f} | {after:.3f} | {change(before, after)} |")
+
+    report = "\n".join(lines) + "\n"
+    path.write_text(report)
+    print(report)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Profile guided optimization trained on the benchmark scenes")
+    parser.add_argument("--build-dir", type=Path, default=ROOT / "build-pgo")
+    parser.add_argument("--frames", type=int, default=300, help="frames per scene when measuring")
+    parser.add_argument("--training-frames", type=int, default=60, help="frames per scene when collecting profiles")
+    parser.add_argument("--scenes", default="", help="only scenes with this in their name")
+    parser.add_argument("--runs", type=int, default=3, help="measured runs per build, the median is reported")
+    parser.add_argument("--lto", action="store_true", help="link time optimization in both builds")
+    parser.add_argument("--report", type=Path, default=ROOT / "pgo-report.md")
+    args = parser.parse_args()
+
+    build_dir = args.build_dir.resolve()
+    baseline_dir = build_dir / "baseline"
+    # GCC finds profiles by object path, so the optimized build reuses the instrumented build's directory
+    optimized_dir = build_dir / "optimized"
+    profile_dir = optimized_dir / "pgo"
+    results_dir = build_dir / "results"
+
+    configure_and_build(baseline_dir, "OFF", args)
+    baseline = measure(baseline_dir, results_dir / "baseline", args)
+
+    if profile_dir.exists():
+        shutil.rmtree(profile_dir)
+    configure_and_build(optimized_dir, "GENERATE", args)
+    run_workload(optimized_dir, results_dir / "training", args.training_frames, args.scenes)
+    if "Clang" in compiler_id(optimized_dir):
+        merge_clang_profiles(profile_dir)
+
+    configure_and_build(optimized_dir, "USE", args)
+    optimized = measure(optimized_dir, results_dir / "optimized", args)
+
+    write_report(args.report.resolve(), baseline, optimized, args)
+
+
+if __name__ == "__main__":
+    main()